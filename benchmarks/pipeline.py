@@ -0,0 +1,105 @@
+# -*- coding: utf-8 -*-
+"""行情分发流水线的基准测试，不需要连接 CTP 前置。
+
+合成的深度行情由后台线程直接送入 MdSpi（`bench_market_data`，不持有 GIL），
+主线程用 `poll` 分发到 Python 回调，各阶段的延迟来自 `latency_stats`：
+
+    spi       OnRtnDepthMarketData -> 入队（合成分钟线等）
+    queue     入队 -> 出队
+    gil       出队 -> 取得 GIL
+    callback  Python 回调
+    total     OnRtnDepthMarketData -> 回调返回
+
+    python benchmarks/pipeline.py --instruments 100 --updates 200000
+"""
+import argparse
+import threading
+from pyctpclient import CtpClient, EM_MARKET_DATA, EM_TICK, EM_1MIN, EM_1MIN_TICK, EM_DEPTH_TICKS, EM_QUOTE
+
+
+EVENTS = {
+    'market_data': EM_MARKET_DATA,
+    'tick': EM_TICK,
+    '1min': EM_1MIN | EM_1MIN_TICK,
+    'depth_ticks': EM_DEPTH_TICKS,
+    'quote': EM_QUOTE,
+}
+
+
+class Client(CtpClient):
+    count = 0
+
+    def on_rtn_market_data(self, data):
+        self.count += 1
+
+    def on_tick(self, data):
+        self.count += 1
+
+    def on_1min(self, data):
+        self.count += 1
+
+    def on_1min_tick(self, data):
+        self.count += 1
+
+    def on_depth_ticks(self, data):
+        self.count += 1
+
+    def on_quote(self, data):
+        self.count += 1
+
+    def on_idle(self):
+        pass
+
+
+def summary(name, s):
+    return "%-10s n=%-8d p50=%8.2f p90=%8.2f p99=%8.2f p999=%8.2f max=%9.2f us" % (
+        name, s['count'], s['p50'] / 1e3, s['p90'] / 1e3, s['p99'] / 1e3, s['p999'] / 1e3, s['max'] / 1e3)
+
+
+def run(events, args):
+    c = Client("", "", "", "", "")
+    c.log.setLevel('WARNING')
+    c.event_mask = EVENTS[events]
+    c.conflate_market_data = args.conflate
+    c.fixed_point_prices = args.fixed_point
+    c.latency_enabled = True
+
+    result = {}
+    feeder = threading.Thread(target=lambda: result.update(c.bench_market_data(args.instruments, args.updates, args.rate)))
+    feeder.start()
+    while feeder.is_alive():
+        c.poll()
+    while c.poll() > 0:
+        pass
+    feeder.join()
+
+    print("[%s] %d updates in %.3f s, %.0f updates/s, %d callbacks" % (
+        events, args.updates, result['seconds'], result['rate'], c.count))
+    print(summary('enqueue', result))
+    stats = c.latency_stats()
+    for stage in ('spi', 'queue', 'gil', 'callback', 'total'):
+        print(summary(stage, stats[stage]))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('--instruments', type=int, default=100)
+    parser.add_argument('--updates', type=int, default=200000)
+    parser.add_argument('--rate', type=float, default=0.0, help="updates per second, 0 for as fast as possible")
+    parser.add_argument('--events', nargs='*', default=sorted(EVENTS), choices=sorted(EVENTS))
+    parser.add_argument('--conflate', action='store_true')
+    parser.add_argument('--fixed-point', action='store_true')
+    parser.add_argument('--orders', type=int, default=100000)
+    args = parser.parse_args()
+
+    for events in args.events:
+        run(events, args)
+
+    c = Client("", "", "", "", "")
+    result = c.bench_order_insert(orders=args.orders)
+    print("[order] %d orders in %.3f s, %.0f orders/s" % (args.orders, result['seconds'], result['rate']))
+    print(summary('fill', result))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,79 @@
+# -*- coding: utf-8 -*-
+"""从“前置推送行情”到“ReqOrderInsert 发出”的端到端延迟，使用进程内的回环前置。
+
+地址为 `loopback://` 时 CtpClient 使用模拟的 MdApi/TraderApi：登录、结算确认和查询
+立即应答，行情由独立线程注入（`start_loopback`）。参考策略对每个 tick 以最新价报单，
+注入时刻随事件传递，每笔报单从触发它的那笔行情的注入时刻起计入 tick-to-order 延迟
+（`loopback_stats`）。
+
+对比的配置：
+    dispatch   poll（Python 循环调用 poll）或 join（阻塞分发）
+    conflate   逐条回调或合并行情（conflate_market_data）
+    strategy   python（on_tick 中 insert_order）或 native（不经过 Python）
+
+    python benchmarks/tick_to_order.py --instruments 10 --updates 50000 --rate 5000
+"""
+import argparse
+import itertools
+from pyctpclient import CtpClient, D_BUY, OF_OPEN, EM_TICK, SS_READY
+
+
+class Strategy(CtpClient):
+    args = None
+    started = False
+    finished = False
+
+    def on_session_state(self, session, state, attempt):
+        # 两个会话都就绪后开始注入行情
+        if not self.started and self.md_session_state == SS_READY and self.td_session_state == SS_READY:
+            self.started = True
+            self.start_loopback(self.args.instruments, self.args.updates, self.args.rate)
+
+    def on_tick(self, data):
+        self.insert_order(data.instrument_id, D_BUY, OF_OPEN, data.price, 1)
+
+    def on_idle(self):
+        if self.started and not self.loopback_running:
+            self.finished = True
+            self.exit()
+
+
+def run(dispatch, conflate, strategy, args):
+    c = Strategy("loopback://md", "loopback://td", "9999", "bench", "")
+    c.log.setLevel('WARNING')
+    c.args = args
+    c.auto_session = True
+    c.event_mask = EM_TICK
+    c.idle_delay = 10
+    c.conflate_market_data = conflate
+    c.loopback_native_strategy = strategy == 'native'
+
+    c.init()
+    if dispatch == 'join':
+        c.join()
+    else:
+        while not c.finished:
+            c.poll()
+    c.remove_flow_path()
+
+    s = c.loopback_stats()
+    print("%-5s %-9s %-7s n=%-7d p50=%8.2f p90=%8.2f p99=%8.2f p999=%9.2f max=%9.2f us  %.0f ticks/s" % (
+        dispatch, 'conflate' if conflate else 'per-event', strategy, s['count'],
+        s['p50'] / 1e3, s['p90'] / 1e3, s['p99'] / 1e3, s['p999'] / 1e3, s['max'] / 1e3, s['rate']))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('--instruments', type=int, default=10)
+    parser.add_argument('--updates', type=int, default=50000)
+    parser.add_argument('--rate', type=float, default=5000.0, help="updates per second, 0 for as fast as possible")
+    parser.add_argument('--dispatch', nargs='*', default=['poll', 'join'], choices=['poll', 'join'])
+    parser.add_argument('--strategy', nargs='*', default=['python', 'native'], choices=['python', 'native'])
+    args = parser.parse_args()
+
+    for dispatch, conflate, strategy in itertools.product(args.dispatch, (False, True), args.strategy):
+        run(dispatch, conflate, strategy, args)
+
+
+if __name__ == '__main__':
+    main()
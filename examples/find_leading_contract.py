@@ -1,7 +1,6 @@
 # -*- coding: utf-8 -*-
 import re
 from pyctpclient import CtpClient
-from datetime import datetime
 
 
 class Client(CtpClient):
@@ -10,6 +9,10 @@ class Client(CtpClient):
     counter = 0
 
     def on_settlement_info_confirm(self, confirm, rsp_info):
+        # 合约列表来自 ReqQryInstrument，同一交易日内从缓存读取
+        self.load_instruments()
+
+    def on_instruments_ready(self, count):
         contract_prefix = [
             "IF", "IC", "IH",
             "a",  "ag", "al", "au",  "b", "bu",  "c", "cu", "cs",
@@ -17,16 +20,10 @@ class Client(CtpClient):
              "p", "pp", "pb", "ru", "rb", "sn", "sp", "sc", "wr", "zn",
         ]
         for c in contract_prefix:
-            today = datetime.today()
-            year = today.year % 2000
-            for m in range(12):
-                month = today.month + m
-                instrument_id = "%s%02d%02d" % (c, year, month % 12 if month % 12 > 0 else 12)
+            for instrument_id in self.instruments(c):
                 self.log.info("query %s" % instrument_id)
                 self.query_market_data(instrument_id)
                 self.counter += 1
-                if month % 12 == 0:
-                    year += 1
 
     def on_rsp_market_data(self, data, rsp_info, request_id, is_last):
         if data is not None:
@@ -78,6 +75,8 @@ if __name__ == "__main__":
     c.instrument_ids = ['IF1906']
     # 设置 on_idle 的最小间隔（毫秒），默认为 1 秒
     c.idle_delay = 1000
+    # 合约列表缓存目录，每个交易日只查询一次
+    c.catalog_path = "."
     # 初始化 CTP
     c.init()
     # 进入消息循环（必须执行）
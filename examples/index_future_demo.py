@@ -17,13 +17,13 @@ from pyctpclient import (
     OSS_INSERT_REJECTED,
     OSS_CANCEL_REJECTED
 )
+import os
 from datetime import datetime
 
 
 class Client(CtpClient):
     available = 0.0
     move = 0.4
-    m1 = []
     position = dict()
     direction = None
     order = None
@@ -74,7 +74,9 @@ class Client(CtpClient):
 
         :type data: pyctpclient.ctpclient.M1Bar
         """
-        self.m1.append(data)
+        # 最近的分钟线由 track_history 在本地保存，例如最近 20 根的收盘价：
+        # self.bar_history(data.instrument_id, 20)['close']
+        pass
 
     def on_1min_tick(self, data):
         if data.update_time.endswith('00'):
@@ -207,6 +209,10 @@ if __name__ == "__main__":
     )
     # 订阅要交易的品种, 请在初始化之前指定
     c.instrument_ids = ['IF1906']
+    # 在本地保存最近 240 根分钟线
+    c.track_history('IF1906', bars=240)
+    # 用上次保存的分钟线预热，指标和历史在连接前就已就绪
+    c.warm_up('history')
     # 设置 on_idle 的最小间隔（毫秒），默认为 1 秒
     c.idle_delay = 1000
     # 初始化 CTP
@@ -214,4 +220,6 @@ if __name__ == "__main__":
     # 进入消息循环（必须执行）
     c.join()
     # 善后工作
+    os.makedirs('history', exist_ok=True)
+    c.save_history('history')
     c.remove_flow_path()
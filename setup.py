@@ -36,7 +36,28 @@ ctpclient_ext = Extension(
         'src/ctpclient_ext/binding.cpp',
         'src/ctpclient_ext/ctpclient.cpp',
         'src/ctpclient_ext//mdspi.cpp',
-        'src/ctpclient_ext//traderspi.cpp'
+        'src/ctpclient_ext/aggregator.cpp',
+        'src/ctpclient_ext//traderspi.cpp',
+        'src/ctpclient_ext/subscription.cpp',
+        'src/ctpclient_ext/catalog.cpp',
+        'src/ctpclient_ext/maincontract.cpp',
+        'src/ctpclient_ext/composite.cpp',
+        'src/ctpclient_ext/spread.cpp',
+        'src/ctpclient_ext/latency.cpp',
+        'src/ctpclient_ext/feed.cpp',
+        'src/ctpclient_ext/flowcontrol.cpp',
+        'src/ctpclient_ext/conflator.cpp',
+        'src/ctpclient_ext/ticks.cpp',
+        'src/ctpclient_ext/symbols.cpp',
+        'src/ctpclient_ext/quote.cpp',
+        'src/ctpclient_ext/dispatcher.cpp',
+        'src/ctpclient_ext/router.cpp',
+        'src/ctpclient_ext/arbiter.cpp',
+        'src/ctpclient_ext/session.cpp',
+        'src/ctpclient_ext/indicators.cpp',
+        'src/ctpclient_ext/history.cpp',
+        'src/ctpclient_ext/bench.cpp',
+        'src/ctpclient_ext/loopback.cpp'
     ],
     include_dirs=[
         os.path.abspath('./pybind11/include'),
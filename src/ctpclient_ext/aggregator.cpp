@@ -0,0 +1,164 @@
+/*
+ * Copyright 2019 Holmes Conan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <cstring>
+#include "aggregator.h"
+#include "ticks.h"
+
+void M1Aggregator::Update(const CThostFtdcDepthMarketDataField *pDepthMarketData, uint32_t symbolId, double tick, M1Bar &m1Bar, bool emitCompleted)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    Aggregate(pDepthMarketData, symbolId, tick, m1Bar, emitCompleted, false);
+}
+
+void M1Aggregator::MarkStale()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    size_t count = 0;
+    for (auto &kv : _bars) {
+        if (kv.second.restart) continue;
+        kv.second.stale = true;
+        count++;
+    }
+    _staleCount.store(count, std::memory_order_release);
+}
+
+void M1Aggregator::Recover(const CThostFtdcDepthMarketDataField *pDepthMarketData, uint32_t symbolId, double tick, bool emitCompleted)
+{
+    if (GetStaleCount() == 0) return;
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto iter = _bars.find(symbolId);
+    if (iter == _bars.end() || !iter->second.stale) return;
+
+    // 快照早于重连后已收到的行情时忽略，由行情完成对齐
+    auto &prev = iter->second.bar;
+    if (strcmp(prev.TradingDay, pDepthMarketData->TradingDay) == 0 && pDepthMarketData->Volume < prev.TickVolume) return;
+
+    M1Bar m1Bar;
+    Aggregate(pDepthMarketData, symbolId, tick, m1Bar, emitCompleted, true);
+}
+
+void M1Aggregator::FinishRecovery(bool emitCompleted)
+{
+    if (GetStaleCount() == 0) return;
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (auto &kv : _bars) {
+        auto &state = kv.second;
+        if (!state.stale) continue;
+
+        if (emitCompleted && _onCompleted) {
+            _onCompleted(state.bar);
+        }
+        state.stale = false;
+        state.restart = true;
+    }
+    _staleCount.store(0, std::memory_order_release);
+}
+
+bool M1Aggregator::Rebase(const CThostFtdcDepthMarketDataField *pDepthMarketData, State &state, bool emitCompleted, bool snapshot)
+{
+    auto &prev = state.bar;
+    bool sameDay = strcmp(prev.TradingDay, pDepthMarketData->TradingDay) == 0;
+
+    MarketDataRecovery recovery;
+    memset(&recovery, 0, sizeof recovery);
+    memcpy(recovery.InstrumentID, pDepthMarketData->InstrumentID, sizeof recovery.InstrumentID);
+    recovery.SymbolId = prev.SymbolId;
+    memcpy(recovery.TradingDay, pDepthMarketData->TradingDay, sizeof recovery.TradingDay);
+    memcpy(recovery.LastUpdateTime, prev.UpdateTime, sizeof recovery.LastUpdateTime);
+    memcpy(recovery.UpdateTime, pDepthMarketData->UpdateTime, sizeof recovery.UpdateTime);
+    recovery.Volume = sameDay && pDepthMarketData->Volume >= prev.TickVolume ? pDepthMarketData->Volume - prev.TickVolume : pDepthMarketData->Volume;
+    recovery.Turnover = sameDay && pDepthMarketData->Turnover >= prev.TickTurnover ? pDepthMarketData->Turnover - prev.TickTurnover : pDepthMarketData->Turnover;
+    recovery.Snapshot = snapshot;
+
+    // 仍在同一分钟内时缺口中的成交本就属于这根K线；否则无法分到各分钟，
+    // 上一根K线照常结束，新K线以本次的累计量为基准
+    recovery.Rebased = !sameDay || strncmp(prev.UpdateTime, pDepthMarketData->UpdateTime, 5) != 0;
+    if (recovery.Rebased && emitCompleted && _onCompleted) {
+        _onCompleted(prev);
+    }
+
+    state.stale = false;
+    _staleCount.fetch_sub(1, std::memory_order_acq_rel);
+    if (_onRecovery) {
+        _onRecovery(recovery);
+    }
+    return recovery.Rebased;
+}
+
+void M1Aggregator::Aggregate(const CThostFtdcDepthMarketDataField *pDepthMarketData, uint32_t symbolId, double tick, M1Bar &m1Bar, bool emitCompleted, bool snapshot)
+{
+    memset(&m1Bar, 0, sizeof m1Bar);
+    memcpy(m1Bar.InstrumentID, pDepthMarketData->InstrumentID, sizeof m1Bar.InstrumentID);
+    m1Bar.SymbolId = symbolId;
+    memcpy(m1Bar.TradingDay, pDepthMarketData->TradingDay, sizeof m1Bar.TradingDay);
+    memcpy(m1Bar.ActionDay, pDepthMarketData->ActionDay, sizeof m1Bar.ActionDay);
+    memcpy(m1Bar.UpdateTime, pDepthMarketData->UpdateTime, 5);
+
+    auto price = pDepthMarketData->LastPrice;
+    auto iter = _bars.find(symbolId);
+    bool rebased = iter != _bars.end()
+        && (iter->second.restart || (iter->second.stale && Rebase(pDepthMarketData, iter->second, emitCompleted, snapshot)));
+
+    if (iter == _bars.end() || rebased) {
+        // 中途开始的K线，只统计之后的成交；启动后的第一根沿用当日累计量
+        m1Bar.OpenPrice = m1Bar.HighestPrice = m1Bar.LowestPrice = m1Bar.ClosePrice = price;
+        m1Bar.BaseVolume = pDepthMarketData->Volume;
+        m1Bar.BaseTurnover = pDepthMarketData->Turnover;
+        m1Bar.TickVolume = pDepthMarketData->Volume;
+        m1Bar.TickTurnover = pDepthMarketData->Turnover;
+        m1Bar.Volume = rebased ? 0 : pDepthMarketData->Volume;
+        m1Bar.Turnover = rebased ? 0 : pDepthMarketData->Turnover;
+        m1Bar.Position = pDepthMarketData->OpenInterest;
+        m1Bar.Partial = true;
+        ToTicks(m1Bar, tick);
+
+        auto &state = _bars[symbolId];
+        state.bar = m1Bar;
+        state.restart = false;
+    } else {
+        auto &prev = iter->second.bar;
+        if (strcmp(m1Bar.UpdateTime, prev.UpdateTime) == 0) {
+            m1Bar.OpenPrice = prev.OpenPrice;
+            m1Bar.HighestPrice = price > prev.HighestPrice ? price : prev.HighestPrice;
+            m1Bar.LowestPrice = price < prev.LowestPrice ? price : prev.LowestPrice;
+            m1Bar.ClosePrice = price;
+            m1Bar.BaseVolume = prev.BaseVolume;
+            m1Bar.BaseTurnover = prev.BaseTurnover;
+            m1Bar.Partial = prev.Partial;
+        } else {
+            m1Bar.OpenPrice = m1Bar.HighestPrice = m1Bar.LowestPrice = m1Bar.ClosePrice = price;
+            m1Bar.BaseVolume = prev.TickVolume;
+            m1Bar.BaseTurnover = prev.TickTurnover;
+
+            if (emitCompleted && _onCompleted) {
+                _onCompleted(prev);
+            }
+        }
+
+        m1Bar.TickVolume = pDepthMarketData->Volume;
+        m1Bar.TickTurnover = pDepthMarketData->Turnover;
+        m1Bar.Position = pDepthMarketData->OpenInterest;
+        m1Bar.Volume = m1Bar.TickVolume >= m1Bar.BaseVolume ? m1Bar.TickVolume - m1Bar.BaseVolume : m1Bar.TickVolume;
+        m1Bar.Turnover = m1Bar.TickTurnover >= m1Bar.BaseTurnover ? m1Bar.TickTurnover - m1Bar.BaseTurnover : m1Bar.TickTurnover;
+        ToTicks(m1Bar, tick);
+
+        memcpy(&prev, &m1Bar, sizeof m1Bar);
+    }
+
+    memcpy(m1Bar.UpdateTime, pDepthMarketData->UpdateTime, sizeof m1Bar.UpdateTime);
+}
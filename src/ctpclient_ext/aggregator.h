@@ -0,0 +1,83 @@
+/*
+ * Copyright 2019 Holmes Conan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include "ThostFtdcUserApiStruct.h"
+#include "bar.h"
+
+/*
+ * 1 minute bars built from the depth updates, one per instrument.
+ *
+ * When the feed is lost the bars are marked stale, and the first update after
+ * the gap, live or from a ReqQryDepthMarketData snapshot, realigns each bar.
+ * Inside the same minute the bar continues and counts the gap's volume.
+ * Otherwise the bar is completed and the next one is rebased: its BaseVolume/
+ * BaseTurnover are the cumulative values of the realigning update, so it
+ * starts at zero and only counts what is traded after that update, even when
+ * it starts in the middle of the minute. The gap's volume is reported in the
+ * MarketDataRecovery instead. Rebased bars, and the first bar after startup,
+ * which counts the day's volume so far, do not cover their whole minute and
+ * are marked Partial.
+ * The market data thread and the dispatch thread (snapshots) both update the
+ * bars, every call takes the lock and the sinks are called under it, so the
+ * completed bars and recoveries keep their order.
+ */
+class M1Aggregator
+{
+public:
+    using BarSink = std::function<void(const M1Bar&)>;
+    using RecoverySink = std::function<void(const MarketDataRecovery&)>;
+
+private:
+    struct State {
+        M1Bar bar;
+        // 断线期间可能错过了行情
+        bool stale = false;
+        // 快照中没有对齐的K线，下一笔行情开始新K线
+        bool restart = false;
+    };
+
+    std::mutex _mutex;
+    std::unordered_map<uint32_t, State> _bars;
+    std::atomic<size_t> _staleCount{0};
+    BarSink _onCompleted;
+    RecoverySink _onRecovery;
+
+    // Realigns a stale bar with the first update after the gap; true if the bar has to start afresh.
+    bool Rebase(const CThostFtdcDepthMarketDataField *pDepthMarketData, State &state, bool emitCompleted, bool snapshot);
+    void Aggregate(const CThostFtdcDepthMarketDataField *pDepthMarketData, uint32_t symbolId, double tick, M1Bar &m1Bar, bool emitCompleted, bool snapshot);
+
+public:
+    M1Aggregator() = default;
+    M1Aggregator(const M1Aggregator&) = delete;
+    M1Aggregator& operator=(const M1Aggregator&) = delete;
+
+    inline void SetSinks(BarSink onCompleted, RecoverySink onRecovery) { _onCompleted = onCompleted; _onRecovery = onRecovery; }
+
+    // Updates the instrument's bar and copies it to `m1Bar`; the bar ended by this update goes to the sink if `emitCompleted`.
+    void Update(const CThostFtdcDepthMarketDataField *pDepthMarketData, uint32_t symbolId, double tick, M1Bar &m1Bar, bool emitCompleted);
+    // Marks all bars as stale after the feed was lost.
+    void MarkStale();
+    // Realigns a stale bar with a snapshot; snapshots of other bars, or older than the bar, are ignored.
+    void Recover(const CThostFtdcDepthMarketDataField *pDepthMarketData, uint32_t symbolId, double tick, bool emitCompleted);
+    // End of the snapshot: bars still stale are completed as they are and start afresh with their next update.
+    void FinishRecovery(bool emitCompleted);
+    inline size_t GetStaleCount() const { return _staleCount.load(std::memory_order_acquire); }
+};
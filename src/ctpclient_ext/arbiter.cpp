@@ -0,0 +1,116 @@
+/*
+ * Copyright 2019 Holmes Conan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <cstdio>
+#include <cstring>
+#include "arbiter.h"
+
+namespace {
+
+uint64_t UpdateKey(const CThostFtdcDepthMarketDataField *pDepthMarketData)
+{
+    int hh = 0, mm = 0, ss = 0;
+    sscanf(pDepthMarketData->UpdateTime, "%d:%d:%d", &hh, &mm, &ss);
+    uint64_t ms = ((hh * 60 + mm) * 60 + ss) * 1000ULL + pDepthMarketData->UpdateMillisec;
+    // 0 marks an empty history slot
+    return ((ms + 1) << 32) | static_cast<uint32_t>(pDepthMarketData->Volume);
+}
+
+}
+
+void FrontArbiter::SetFronts(const std::vector<std::string> &addresses)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _fronts.clear();
+    _fronts.resize(addresses.size());
+    for (size_t i = 0; i < addresses.size(); i++) {
+        _fronts[i].address = addresses[i];
+    }
+    _history.clear();
+}
+
+bool FrontArbiter::Accept(const CThostFtdcDepthMarketDataField *pDepthMarketData, uint32_t symbolId, size_t front)
+{
+    uint64_t key = UpdateKey(pDepthMarketData);
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    _fronts[front].received++;
+    if (symbolId >= _history.size()) {
+        _history.resize(symbolId + 1);
+    }
+
+    auto &history = _history[symbolId];
+    for (auto k : history.keys) {
+        if (k == key) return false;
+    }
+
+    // 成交量在交易日内只增不减，量减少的是落后前置的旧行情
+    bool sameDay = strcmp(history.tradingDay, pDepthMarketData->TradingDay) == 0;
+    if (sameDay && pDepthMarketData->Volume < history.volume) return false;
+    if (!sameDay) {
+        strncpy(history.tradingDay, pDepthMarketData->TradingDay, sizeof history.tradingDay);
+    }
+
+    history.keys[history.next] = key;
+    history.next = (history.next + 1) % HISTORY;
+    history.volume = pDepthMarketData->Volume;
+    _fronts[front].wins++;
+    return true;
+}
+
+void FrontArbiter::SetConnected(size_t front, bool connected)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (front < _fronts.size()) {
+        _fronts[front].connected = connected;
+    }
+}
+
+bool FrontArbiter::IsAnyConnected() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (auto &front : _fronts) {
+        if (front.connected) return true;
+    }
+    return false;
+}
+
+std::map<std::string, std::map<std::string, double>> FrontArbiter::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    uint64_t forwarded = 0;
+    for (auto &front : _fronts) {
+        forwarded += front.wins;
+    }
+
+    std::map<std::string, std::map<std::string, double>> result;
+    for (auto &front : _fronts) {
+        auto &stats = result[front.address];
+        stats["connected"] = front.connected ? 1 : 0;
+        stats["received"] = double(front.received);
+        stats["wins"] = double(front.wins);
+        stats["win_rate"] = forwarded > 0 ? double(front.wins) / forwarded : 0.0;
+    }
+    return result;
+}
+
+void FrontArbiter::Reset()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (auto &front : _fronts) {
+        front.received = 0;
+        front.wins = 0;
+    }
+}
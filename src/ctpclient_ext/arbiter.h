@@ -0,0 +1,73 @@
+/*
+ * Copyright 2019 Holmes Conan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "ThostFtdcUserApiStruct.h"
+
+/*
+ * Merges the depth streams of several MD fronts subscribed to the same
+ * instruments. An update is identified by UpdateTime, UpdateMillisec and
+ * Volume; the first arrival is forwarded and its copies from the other fronts
+ * are dropped, as are updates older than the last forwarded one.
+ *
+ * Front 0 is the primary front (`md_address`), the others are the redundant
+ * fronts in the order they were configured.
+ */
+class FrontArbiter
+{
+    // Recent updates per instrument, so late copies behind newer updates are still recognised.
+    static const size_t HISTORY = 8;
+
+    struct History {
+        uint64_t keys[HISTORY] = {0};
+        size_t next = 0;
+        TThostFtdcDateType tradingDay = {0};
+        TThostFtdcVolumeType volume = 0;
+    };
+
+    struct Front {
+        std::string address;
+        bool connected = false;
+        uint64_t received = 0;
+        uint64_t wins = 0;
+    };
+
+    mutable std::mutex _mutex;
+    std::vector<Front> _fronts;
+    // indexed by symbol id
+    std::vector<History> _history;
+
+public:
+    FrontArbiter() = default;
+    FrontArbiter(const FrontArbiter&) = delete;
+    FrontArbiter& operator=(const FrontArbiter&) = delete;
+
+    void SetFronts(const std::vector<std::string> &addresses);
+    inline bool IsEnabled() const { return _fronts.size() > 1; }
+
+    // True if `pDepthMarketData` is the first arrival of this update.
+    bool Accept(const CThostFtdcDepthMarketDataField *pDepthMarketData, uint32_t symbolId, size_t front);
+    void SetConnected(size_t front, bool connected);
+    bool IsAnyConnected() const;
+
+    std::map<std::string, std::map<std::string, double>> GetStats() const;
+    void Reset();
+};
@@ -14,9 +14,27 @@
  * limitations under the License.
  */
 #pragma once
+#include <cfloat>
+#include <cstdint>
+
+// CTP 用 DBL_MAX 表示无效价格
+inline bool IsValidPrice(double price)
+{
+    return price > 0.0 && price < DBL_MAX;
+}
+
+// "HH:MM:SS" + 毫秒 -> 当天的毫秒数
+inline int ParseUpdateTime(const char *updateTime, int millisec)
+{
+    int h = (updateTime[0] - '0') * 10 + (updateTime[1] - '0');
+    int m = (updateTime[3] - '0') * 10 + (updateTime[4] - '0');
+    int s = (updateTime[6] - '0') * 10 + (updateTime[7] - '0');
+    return ((h * 60 + m) * 60 + s) * 1000 + millisec;
+}
 
 struct M1Bar {
 	TThostFtdcInstrumentIDType InstrumentID;
+	uint32_t SymbolId;
 	TThostFtdcDateType  TradingDay;
 	TThostFtdcDateType  ActionDay;
 	TThostFtdcTimeType  UpdateTime;
@@ -31,10 +49,19 @@ struct M1Bar {
 	TThostFtdcMoneyType	BaseTurnover;
 	TThostFtdcMoneyType	Turnover;
 	TThostFtdcLargeVolumeType Position;
+	// 定点价格，未启用 fixed_point_prices 时为 PRICE_ABSENT
+	TThostFtdcPriceType PriceTick;
+	int64_t OpenTicks;
+	int64_t HighestTicks;
+	int64_t LowestTicks;
+	int64_t CloseTicks;
+	// 中途开始的K线：启动或行情缺口后的第一根，没有覆盖整分钟
+	bool Partial;
 };
 
 struct TickBar {
 	TThostFtdcInstrumentIDType InstrumentID;
+	uint32_t SymbolId;
 	TThostFtdcDateType  TradingDay;
 	TThostFtdcDateType  ActionDay;
 	char UpdateTime[16];
@@ -42,4 +69,24 @@ struct TickBar {
 	TThostFtdcMoneyType	Turnover;
 	TThostFtdcVolumeType Volume;
 	TThostFtdcLargeVolumeType Position;
+	TThostFtdcPriceType PriceTick;
+	int64_t PriceTicks;
+};
+
+// 推送给 on_rtn_market_data 的深度行情，带上行情线程分配的合约编号
+struct MarketDataEvent : CThostFtdcDepthMarketDataField {
+	uint32_t SymbolId;
+};
+
+// 断线期间错过的行情，分钟线状态在恢复时重新对齐
+struct MarketDataRecovery {
+	TThostFtdcInstrumentIDType InstrumentID;
+	uint32_t SymbolId;
+	TThostFtdcDateType  TradingDay;
+	TThostFtdcTimeType  LastUpdateTime;
+	TThostFtdcTimeType  UpdateTime;
+	TThostFtdcVolumeType Volume;
+	TThostFtdcMoneyType	Turnover;
+	bool Snapshot;
+	bool Rebased;
 };
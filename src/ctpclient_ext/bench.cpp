@@ -0,0 +1,73 @@
+/*
+ * Copyright 2019 Holmes Conan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <cstdio>
+#include <cstring>
+#include "bench.h"
+
+namespace {
+
+const double PRICE_TICK = 0.2;
+const int VOLUME_MULTIPLE = 300;
+
+}
+
+DepthStream::DepthStream(size_t instruments, uint32_t seed)
+: _instruments(instruments > 0 ? instruments : 1), _rng(seed)
+{
+    for (size_t i = 0; i < _instruments.size(); i++) {
+        auto &depth = _instruments[i];
+        memset(&depth, 0, sizeof depth);
+        snprintf(depth.InstrumentID, sizeof depth.InstrumentID, "BENCH%04u", static_cast<unsigned>(i));
+        strncpy(depth.ExchangeID, "BENCH", sizeof depth.ExchangeID - 1);
+        strncpy(depth.TradingDay, BENCH_TRADING_DAY, sizeof depth.TradingDay - 1);
+        strncpy(depth.ActionDay, BENCH_TRADING_DAY, sizeof depth.ActionDay - 1);
+        depth.PreSettlementPrice = depth.PreClosePrice = depth.OpenPrice = depth.LastPrice = 3800.0;
+        depth.HighestPrice = depth.LowestPrice = depth.LastPrice;
+        depth.UpperLimitPrice = depth.PreSettlementPrice * 1.1;
+        depth.LowerLimitPrice = depth.PreSettlementPrice * 0.9;
+        depth.OpenInterest = depth.PreOpenInterest = 50000;
+    }
+}
+
+void DepthStream::Next(CThostFtdcDepthMarketDataField &depth)
+{
+    auto &state = _instruments[_next];
+    if (++_next == _instruments.size()) {
+        _next = 0;
+        _time += 500;
+    }
+
+    std::uniform_int_distribution<int> step(-2, 2);
+    std::uniform_int_distribution<int> volume(0, 20);
+
+    int traded = volume(_rng);
+    state.LastPrice += step(_rng) * PRICE_TICK;
+    state.HighestPrice = state.LastPrice > state.HighestPrice ? state.LastPrice : state.HighestPrice;
+    state.LowestPrice = state.LastPrice < state.LowestPrice ? state.LastPrice : state.LowestPrice;
+    state.Volume += traded;
+    state.Turnover += traded * state.LastPrice * VOLUME_MULTIPLE;
+    state.OpenInterest += step(_rng);
+    state.BidPrice1 = state.LastPrice - PRICE_TICK;
+    state.AskPrice1 = state.LastPrice;
+    state.BidVolume1 = volume(_rng) + 1;
+    state.AskVolume1 = volume(_rng) + 1;
+
+    int seconds = _time / 1000;
+    snprintf(state.UpdateTime, sizeof state.UpdateTime, "%02d:%02d:%02d", seconds / 3600 % 24, seconds / 60 % 60, seconds % 60);
+    state.UpdateMillisec = _time % 1000;
+
+    memcpy(&depth, &state, sizeof depth);
+}
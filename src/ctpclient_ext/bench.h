@@ -0,0 +1,43 @@
+/*
+ * Copyright 2019 Holmes Conan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+#include <random>
+#include <vector>
+#include "ThostFtdcUserApiStruct.h"
+
+const char BENCH_TRADING_DAY[] = "20190603";
+
+/*
+ * Synthetic depth stream for benchmarks: instruments `BENCH0000`... are
+ * updated round-robin with a random walk of the last price, growing
+ * volume/turnover and a one-level book; each round advances the clock by
+ * 500 ms from 09:00:00, so 1 minute bars roll as they do live.
+ */
+class DepthStream
+{
+    std::vector<CThostFtdcDepthMarketDataField> _instruments;
+    std::mt19937 _rng;
+    size_t _next = 0;
+    int _time = 9 * 3600 * 1000;
+
+public:
+    DepthStream(size_t instruments, uint32_t seed);
+    DepthStream(const DepthStream&) = delete;
+    DepthStream& operator=(const DepthStream&) = delete;
+
+    // Writes the next update into `depth`.
+    void Next(CThostFtdcDepthMarketDataField &depth);
+};
@@ -16,8 +16,10 @@
 #include <string>
 #include <vector>
 #include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
 #include "ctpclient.h"
 #include "mdspi.h"
+#include "dispatcher.h"
 
 using namespace pybind11::literals;
 namespace py = pybind11;
@@ -342,11 +344,135 @@ OrderActionStatus toenum_OrderActionStatus(T const* this_)
   }
 }
 
+template<class T>
+const char* tostr_ProductClass(T const *this_)
+{
+  switch(this_->ProductClass) {
+    case THOST_FTDC_PC_Futures: return "futures";
+    case THOST_FTDC_PC_Options: return "options";
+    case THOST_FTDC_PC_Combination: return "combination";
+    case THOST_FTDC_PC_Spot: return "spot";
+    case THOST_FTDC_PC_EFP: return "EFP";
+    case THOST_FTDC_PC_SpotOption: return "spot_option";
+    default: return "unknown";
+  }
+}
+
+template<class T>
+const char* tostr_OptionsType(T const *this_)
+{
+  switch(this_->OptionsType) {
+    case THOST_FTDC_CP_CallOptions: return "call";
+    case THOST_FTDC_CP_PutOptions: return "put";
+    default: return "";
+  }
+}
+
 #pragma endregion // Getters
 
+#pragma region Symbols
+
+// 每个合约只创建一个 Python str，只在持有 GIL 时调用
+py::object symbol_name(uint32_t id, const char *fallback)
+{
+  if (id == 0) return py::str(fallback);
+
+  // 不析构，解释器退出后不能再释放 Python 对象
+  static auto *names = new std::vector<py::object>();
+  if (id >= names->size()) names->resize(id + 1);
+  auto &name = (*names)[id];
+  if (!name) name = py::str(SymbolTable::Instance().GetName(id));
+  return name;
+}
+
+// 无锁查找，只在读取 symbol_id 时进行
+template<class T>
+uint32_t symbol_id(T const *this_)
+{
+  return SymbolTable::Instance().Find(this_->InstrumentID);
+}
+
+// 不带合约编号的结构体直接构造 str，不查符号表
+template<class T>
+py::object instrument_id(T const *this_)
+{
+  return py::str(this_->InstrumentID);
+}
+
+template<class T>
+py::object interned_instrument_id(T const *this_)
+{
+  return symbol_name(this_->SymbolId, this_->InstrumentID);
+}
+
+#pragma endregion // Symbols
+
+#pragma region History
+
+// 默认返回指向环形缓冲区的只读视图，直到下一次追加前有效；copy 时返回独立的数组
+template<class T>
+py::object history_view(CtpClient &self, const T *records, size_t n, bool copy)
+{
+  if (copy) {
+    return py::array_t<T>(static_cast<py::ssize_t>(n), records);
+  }
+
+  py::array_t<T> view(static_cast<py::ssize_t>(n), records, py::cast(&self, py::return_value_policy::reference));
+  view.attr("setflags")(false);
+  return view;
+}
+
+#pragma endregion // History
+
 PYBIND11_MODULE(ctpclient, m) {
 #pragma region Enums
 
+  py::enum_<OverflowPolicy>(m, "OverflowPolicy")
+    .value("BLOCK", OverflowPolicy::Block)
+    .value("DROP_OLDEST", OverflowPolicy::DropOldest)
+    .value("CONFLATE", OverflowPolicy::Conflate);
+
+  py::enum_<SessionState>(m, "SessionState")
+    .value("DISCONNECTED", SessionState::Disconnected)
+    .value("CONNECTED", SessionState::Connected)
+    .value("AUTHENTICATING", SessionState::Authenticating)
+    .value("LOGGING_IN", SessionState::LoggingIn)
+    .value("CONFIRMING", SessionState::Confirming)
+    .value("SYNCING", SessionState::Syncing)
+    .value("READY", SessionState::Ready)
+    .value("FAILED", SessionState::Failed);
+
+  py::enum_<AccountStatus>(m, "AccountStatus")
+    .value("DISCONNECTED", AccountStatus::Disconnected)
+    .value("CONNECTED", AccountStatus::Connected)
+    .value("AUTHENTICATED", AccountStatus::Authenticated)
+    .value("LOGGED_IN", AccountStatus::LoggedIn)
+    .value("READY", AccountStatus::Ready);
+
+  PYBIND11_NUMPY_DTYPE_EX(TickRecord,
+    TradingDay, "trading_day", ActionDay, "action_day", Time, "time", Volume, "volume",
+    Price, "price", Turnover, "turnover", Position, "position");
+  PYBIND11_NUMPY_DTYPE_EX(BarRecord,
+    TradingDay, "trading_day", ActionDay, "action_day", Time, "time", Volume, "volume",
+    Open, "open", High, "high", Low, "low", Close, "close", Turnover, "turnover", Position, "position");
+
+  py::enum_<IndicatorType>(m, "IndicatorType")
+    .value("EMA", IndicatorType::EMA)
+    .value("ATR", IndicatorType::ATR)
+    .value("VWAP", IndicatorType::VWAP)
+    .value("BOLLINGER", IndicatorType::Bollinger)
+    .value("RSI", IndicatorType::RSI);
+
+  py::enum_<EventMask>(m, "EventMask", py::arithmetic())
+    .value("MARKET_DATA", EventMask::EM_MarketData)
+    .value("TICK", EventMask::EM_Tick)
+    .value("ONE_MIN", EventMask::EM_1Min)
+    .value("ONE_MIN_TICK", EventMask::EM_1MinTick)
+    .value("DEPTH_TICKS", EventMask::EM_DepthTicks)
+    .value("QUOTE", EventMask::EM_Quote)
+    .value("ALL", EventMask::EM_All)
+    .value("AUTO", EventMask::EM_Auto);
+
   py::enum_<Direction>(m, "Direction")
     .value("BUY", Direction::D_Buy)
     .value("SELL", Direction::D_Sell);
@@ -446,6 +572,10 @@ PYBIND11_MODULE(ctpclient, m) {
 
 #pragma endregion
 
+  m.def("symbol_id", [](const std::string &instrumentId) { return SymbolTable::Instance().Find(instrumentId); }, "instrument_id"_a);
+  m.def("symbol_name", [](uint32_t symbolId) { return symbol_name(symbolId, ""); }, "symbol_id"_a);
+  m.def("intern_symbol", [](const std::string &instrumentId) { return SymbolTable::Instance().Intern(instrumentId.c_str()); }, "instrument_id"_a);
+
 #pragma region Structs
 
   py::class_<CThostFtdcRspInfoField>(m, "ResponseInfo")
@@ -483,11 +613,13 @@ PYBIND11_MODULE(ctpclient, m) {
     ;
 
   py::class_<CThostFtdcSpecificInstrumentField>(m, "SpecificInstrument")
-    .def_readonly("instrument_id", &CThostFtdcSpecificInstrumentField::InstrumentID)
+    .def_property_readonly("instrument_id", instrument_id<CThostFtdcSpecificInstrumentField>)
+    .def_property_readonly("symbol_id", symbol_id<CThostFtdcSpecificInstrumentField>)
     ;
 
   py::class_<M1Bar, std::shared_ptr<M1Bar>>(m, "M1Bar")
-    .def_readonly("instrument_id", &M1Bar::InstrumentID)
+    .def_readonly("symbol_id", &M1Bar::SymbolId)
+    .def_property_readonly("instrument_id", interned_instrument_id<M1Bar>)
     .def_readonly("trading_day", &M1Bar::TradingDay)
     .def_readonly("action_day", &M1Bar::ActionDay)
     .def_readonly("update_time", &M1Bar::UpdateTime)
@@ -498,10 +630,17 @@ PYBIND11_MODULE(ctpclient, m) {
     .def_readonly("volume", &M1Bar::Volume)
     .def_readonly("turnover", &M1Bar::Turnover)
     .def_readonly("position", &M1Bar::Position)
+    .def_readonly("price_tick", &M1Bar::PriceTick)
+    .def_readonly("open_ticks", &M1Bar::OpenTicks)
+    .def_readonly("high_ticks", &M1Bar::HighestTicks)
+    .def_readonly("low_ticks", &M1Bar::LowestTicks)
+    .def_readonly("close_ticks", &M1Bar::CloseTicks)
+    .def_readonly("partial", &M1Bar::Partial)
     ;
 
   py::class_<TickBar, std::shared_ptr<TickBar>>(m, "TickBar")
-    .def_readonly("instrument_id", &TickBar::InstrumentID)
+    .def_readonly("symbol_id", &TickBar::SymbolId)
+    .def_property_readonly("instrument_id", interned_instrument_id<TickBar>)
     .def_readonly("trading_day", &TickBar::TradingDay)
     .def_readonly("action_day", &TickBar::ActionDay)
     .def_readonly("update_time", &TickBar::UpdateTime)
@@ -509,11 +648,108 @@ PYBIND11_MODULE(ctpclient, m) {
     .def_readonly("volume", &TickBar::Volume)
     .def_readonly("turnover", &TickBar::Turnover)
     .def_readonly("position", &TickBar::Position)
+    .def_readonly("price_tick", &TickBar::PriceTick)
+    .def_readonly("price_ticks", &TickBar::PriceTicks)
+    ;
+
+  py::class_<Quote>(m, "Quote")
+    .def_readonly("symbol_id", &Quote::SymbolId)
+    .def_property_readonly("instrument_id", [](const Quote *this_) { return symbol_name(this_->SymbolId, ""); })
+    .def_readonly("trading_day", &Quote::TradingDay)
+    .def_readonly("update_time", &Quote::UpdateTime)
+    .def_readonly("last_price", &Quote::LastPrice)
+    .def_readonly("volume", &Quote::Volume)
+    .def_readonly("turnover", &Quote::Turnover)
+    .def_readonly("open_interest", &Quote::OpenInterest)
+    .def_readonly("upper_limit_price", &Quote::UpperLimitPrice)
+    .def_readonly("lower_limit_price", &Quote::LowerLimitPrice)
+    .def_property_readonly("bid_price", [](const Quote *this_) { return this_->BidPrice[0]; })
+    .def_property_readonly("bid_volume", [](const Quote *this_) { return this_->BidVolume[0]; })
+    .def_property_readonly("ask_price", [](const Quote *this_) { return this_->AskPrice[0]; })
+    .def_property_readonly("ask_volume", [](const Quote *this_) { return this_->AskVolume[0]; })
+    .def_property_readonly("bid_prices", [](const Quote *this_) { return py::make_tuple(this_->BidPrice[0], this_->BidPrice[1], this_->BidPrice[2], this_->BidPrice[3], this_->BidPrice[4]); })
+    .def_property_readonly("bid_volumes", [](const Quote *this_) { return py::make_tuple(this_->BidVolume[0], this_->BidVolume[1], this_->BidVolume[2], this_->BidVolume[3], this_->BidVolume[4]); })
+    .def_property_readonly("ask_prices", [](const Quote *this_) { return py::make_tuple(this_->AskPrice[0], this_->AskPrice[1], this_->AskPrice[2], this_->AskPrice[3], this_->AskPrice[4]); })
+    .def_property_readonly("ask_volumes", [](const Quote *this_) { return py::make_tuple(this_->AskVolume[0], this_->AskVolume[1], this_->AskVolume[2], this_->AskVolume[3], this_->AskVolume[4]); })
+    ;
+
+  py::class_<DepthTicks>(m, "DepthTicks")
+    .def_readonly("symbol_id", &DepthTicks::SymbolId)
+    .def_property_readonly("instrument_id", interned_instrument_id<DepthTicks>)
+    .def_readonly("trading_day", &DepthTicks::TradingDay)
+    .def_readonly("update_time", &DepthTicks::UpdateTime)
+    .def_readonly("update_millisec", &DepthTicks::UpdateMillisec)
+    .def_readonly("price_tick", &DepthTicks::PriceTick)
+    .def_readonly("last_price", &DepthTicks::LastPrice)
+    .def_readonly("upper_limit_price", &DepthTicks::UpperLimitPrice)
+    .def_readonly("lower_limit_price", &DepthTicks::LowerLimitPrice)
+    .def_readonly("bid_price1", &DepthTicks::BidPrice1)
+    .def_readonly("bid_volume1", &DepthTicks::BidVolume1)
+    .def_readonly("ask_price1", &DepthTicks::AskPrice1)
+    .def_readonly("ask_volume1", &DepthTicks::AskVolume1)
+    .def_readonly("bid_price2", &DepthTicks::BidPrice2)
+    .def_readonly("bid_volume2", &DepthTicks::BidVolume2)
+    .def_readonly("ask_price2", &DepthTicks::AskPrice2)
+    .def_readonly("ask_volume2", &DepthTicks::AskVolume2)
+    .def_readonly("bid_price3", &DepthTicks::BidPrice3)
+    .def_readonly("bid_volume3", &DepthTicks::BidVolume3)
+    .def_readonly("ask_price3", &DepthTicks::AskPrice3)
+    .def_readonly("ask_volume3", &DepthTicks::AskVolume3)
+    .def_readonly("bid_price4", &DepthTicks::BidPrice4)
+    .def_readonly("bid_volume4", &DepthTicks::BidVolume4)
+    .def_readonly("ask_price4", &DepthTicks::AskPrice4)
+    .def_readonly("ask_volume4", &DepthTicks::AskVolume4)
+    .def_readonly("bid_price5", &DepthTicks::BidPrice5)
+    .def_readonly("bid_volume5", &DepthTicks::BidVolume5)
+    .def_readonly("ask_price5", &DepthTicks::AskPrice5)
+    .def_readonly("ask_volume5", &DepthTicks::AskVolume5)
+    .def_readonly("volume", &DepthTicks::Volume)
+    .def_readonly("open_interest", &DepthTicks::OpenInterest)
+    ;
+
+  py::class_<MarketDataRecovery>(m, "MarketDataRecovery")
+    .def_readonly("symbol_id", &MarketDataRecovery::SymbolId)
+    .def_property_readonly("instrument_id", interned_instrument_id<MarketDataRecovery>)
+    .def_readonly("trading_day", &MarketDataRecovery::TradingDay)
+    .def_readonly("last_update_time", &MarketDataRecovery::LastUpdateTime)
+    .def_readonly("update_time", &MarketDataRecovery::UpdateTime)
+    .def_readonly("volume", &MarketDataRecovery::Volume)
+    .def_readonly("turnover", &MarketDataRecovery::Turnover)
+    .def_readonly("snapshot", &MarketDataRecovery::Snapshot)
+    .def_readonly("rebased", &MarketDataRecovery::Rebased)
+    ;
+
+  py::class_<MainContractRoll>(m, "MainContractRoll")
+    .def_readonly("product_id", &MainContractRoll::ProductID)
+    .def_property_readonly("instrument_id", instrument_id<MainContractRoll>)
+    .def_property_readonly("symbol_id", symbol_id<MainContractRoll>)
+    .def_readonly("old_instrument_id", &MainContractRoll::OldInstrumentID)
+    .def_readonly("new_instrument_id", &MainContractRoll::NewInstrumentID)
+    .def_readonly("trading_day", &MainContractRoll::TradingDay)
+    .def_readonly("update_time", &MainContractRoll::UpdateTime)
+    .def_readonly("price_gap", &MainContractRoll::PriceGap)
+    ;
+
+  py::class_<SpreadQuote>(m, "SpreadQuote")
+    .def_readonly("spread_id", &SpreadQuote::SpreadID)
+    .def_property_readonly("instrument_id", instrument_id<SpreadQuote>)
+    .def_property_readonly("symbol_id", symbol_id<SpreadQuote>)
+    .def_readonly("trading_day", &SpreadQuote::TradingDay)
+    .def_readonly("update_time", &SpreadQuote::UpdateTime)
+    .def_readonly("update_millisec", &SpreadQuote::UpdateMillisec)
+    .def_readonly("last_price", &SpreadQuote::LastPrice)
+    .def_readonly("bid_price", &SpreadQuote::BidPrice)
+    .def_readonly("bid_volume", &SpreadQuote::BidVolume)
+    .def_readonly("ask_price", &SpreadQuote::AskPrice)
+    .def_readonly("ask_volume", &SpreadQuote::AskVolume)
+    .def_readonly("skew", &SpreadQuote::Skew)
+    .def_readonly("stale", &SpreadQuote::Stale)
     ;
 
   py::class_<CThostFtdcDepthMarketDataField, std::shared_ptr<CThostFtdcDepthMarketDataField>>(m, "MarketData")
     .def_readonly("trading_day", &CThostFtdcDepthMarketDataField::TradingDay)
-    .def_readonly("instrument_id", &CThostFtdcDepthMarketDataField::InstrumentID)
+    .def_property_readonly("instrument_id", instrument_id<CThostFtdcDepthMarketDataField>)
+    .def_property_readonly("symbol_id", symbol_id<CThostFtdcDepthMarketDataField>)
     .def_readonly("exchange_id", &CThostFtdcDepthMarketDataField::ExchangeID)
     .def_readonly("exchange_inst_id", &CThostFtdcDepthMarketDataField::ExchangeInstID)
     .def_readonly("last_price", &CThostFtdcDepthMarketDataField::LastPrice)
@@ -558,6 +794,56 @@ PYBIND11_MODULE(ctpclient, m) {
     .def_readonly("action_day", &CThostFtdcDepthMarketDataField::ActionDay)
     ;
 
+  // 推送的行情带有合约编号，读取 instrument_id 时不再查表
+  py::class_<MarketDataEvent, CThostFtdcDepthMarketDataField, std::shared_ptr<MarketDataEvent>>(m, "MarketDataEvent")
+    .def_property_readonly("instrument_id", interned_instrument_id<MarketDataEvent>)
+    .def_readonly("symbol_id", &MarketDataEvent::SymbolId)
+    ;
+
+  py::class_<CThostFtdcProductField>(m, "Product")
+    .def_readonly("product_id", &CThostFtdcProductField::ProductID)
+    .def_property_readonly("product_name", [](CThostFtdcProductField const *this_) { return py::bytes(this_->ProductName); })
+    .def_readonly("exchange_id", &CThostFtdcProductField::ExchangeID)
+    .def_property_readonly("product_class", tostr_ProductClass<CThostFtdcProductField>)
+    .def_readonly("volume_multiple", &CThostFtdcProductField::VolumeMultiple)
+    .def_readonly("price_tick", &CThostFtdcProductField::PriceTick)
+    .def_readonly("max_market_order_volume", &CThostFtdcProductField::MaxMarketOrderVolume)
+    .def_readonly("min_market_order_volume", &CThostFtdcProductField::MinMarketOrderVolume)
+    .def_readonly("max_limit_order_volume", &CThostFtdcProductField::MaxLimitOrderVolume)
+    .def_readonly("min_limit_order_volume", &CThostFtdcProductField::MinLimitOrderVolume)
+    .def_readonly("exchange_product_id", &CThostFtdcProductField::ExchangeProductID)
+    ;
+
+  py::class_<CThostFtdcInstrumentField>(m, "Instrument")
+    .def_readonly("instrument_id", &CThostFtdcInstrumentField::InstrumentID)
+    .def_property_readonly("symbol_id", symbol_id<CThostFtdcInstrumentField>)
+    .def_readonly("exchange_id", &CThostFtdcInstrumentField::ExchangeID)
+    .def_property_readonly("instrument_name", [](CThostFtdcInstrumentField const *this_) { return py::bytes(this_->InstrumentName); })
+    .def_readonly("exchange_inst_id", &CThostFtdcInstrumentField::ExchangeInstID)
+    .def_readonly("product_id", &CThostFtdcInstrumentField::ProductID)
+    .def_property_readonly("product_class", tostr_ProductClass<CThostFtdcInstrumentField>)
+    .def_readonly("delivery_year", &CThostFtdcInstrumentField::DeliveryYear)
+    .def_readonly("delivery_month", &CThostFtdcInstrumentField::DeliveryMonth)
+    .def_readonly("max_market_order_volume", &CThostFtdcInstrumentField::MaxMarketOrderVolume)
+    .def_readonly("min_market_order_volume", &CThostFtdcInstrumentField::MinMarketOrderVolume)
+    .def_readonly("max_limit_order_volume", &CThostFtdcInstrumentField::MaxLimitOrderVolume)
+    .def_readonly("min_limit_order_volume", &CThostFtdcInstrumentField::MinLimitOrderVolume)
+    .def_readonly("volume_multiple", &CThostFtdcInstrumentField::VolumeMultiple)
+    .def_readonly("price_tick", &CThostFtdcInstrumentField::PriceTick)
+    .def_readonly("create_date", &CThostFtdcInstrumentField::CreateDate)
+    .def_readonly("open_date", &CThostFtdcInstrumentField::OpenDate)
+    .def_readonly("expire_date", &CThostFtdcInstrumentField::ExpireDate)
+    .def_readonly("start_deliv_date", &CThostFtdcInstrumentField::StartDelivDate)
+    .def_readonly("end_deliv_date", &CThostFtdcInstrumentField::EndDelivDate)
+    .def_property_readonly("is_trading", [](CThostFtdcInstrumentField const *this_) { return this_->IsTrading != 0; })
+    .def_readonly("long_margin_ratio", &CThostFtdcInstrumentField::LongMarginRatio)
+    .def_readonly("short_margin_ratio", &CThostFtdcInstrumentField::ShortMarginRatio)
+    .def_readonly("underlying_instr_id", &CThostFtdcInstrumentField::UnderlyingInstrID)
+    .def_readonly("strike_price", &CThostFtdcInstrumentField::StrikePrice)
+    .def_property_readonly("options_type", tostr_OptionsType<CThostFtdcInstrumentField>)
+    .def_readonly("underlying_multiple", &CThostFtdcInstrumentField::UnderlyingMultiple)
+    ;
+
   py::class_<CThostFtdcSettlementInfoField>(m, "SettlementInfo")
     .def_readonly("trading_day", &CThostFtdcSettlementInfoField::TradingDay)
     .def_readonly("settlement_id", &CThostFtdcSettlementInfoField::SettlementID)
@@ -630,7 +916,8 @@ PYBIND11_MODULE(ctpclient, m) {
     ;
 
   py::class_<CThostFtdcInvestorPositionField>(m, "InvestorPosition")
-    .def_readonly("instrument_id", &CThostFtdcInvestorPositionField::InstrumentID)
+    .def_property_readonly("instrument_id", instrument_id<CThostFtdcInvestorPositionField>)
+    .def_property_readonly("symbol_id", symbol_id<CThostFtdcInvestorPositionField>)
     .def_readonly("broker_id", &CThostFtdcInvestorPositionField::BrokerID)
     .def_readonly("investor_id", &CThostFtdcInvestorPositionField::InvestorID)
     .def_property_readonly("position_direction", tostr_PositionDirection<CThostFtdcInvestorPositionField>)
@@ -679,7 +966,8 @@ PYBIND11_MODULE(ctpclient, m) {
     ;
 
   py::class_<CThostFtdcInvestorPositionDetailField>(m, "InvestorPositionDetail")
-    .def_readonly("instrument_id", &CThostFtdcInvestorPositionDetailField::InstrumentID)
+    .def_property_readonly("instrument_id", instrument_id<CThostFtdcInvestorPositionDetailField>)
+    .def_property_readonly("symbol_id", symbol_id<CThostFtdcInvestorPositionDetailField>)
     .def_readonly("broker_id", &CThostFtdcInvestorPositionDetailField::BrokerID)
     .def_readonly("investor_id", &CThostFtdcInvestorPositionDetailField::InvestorID)
     .def_property_readonly("hedge_flag", tostr_HedgeFlag<CThostFtdcInvestorPositionDetailField>)
@@ -711,7 +999,8 @@ PYBIND11_MODULE(ctpclient, m) {
   py::class_<CThostFtdcInputOrderField>(m, "InputOrder")
     .def_readonly("broker_id", &CThostFtdcInputOrderField::BrokerID)
     .def_readonly("investor_id", &CThostFtdcInputOrderField::InvestorID)
-    .def_readonly("instrument_id", &CThostFtdcInputOrderField::InstrumentID)
+    .def_property_readonly("instrument_id", instrument_id<CThostFtdcInputOrderField>)
+    .def_property_readonly("symbol_id", symbol_id<CThostFtdcInputOrderField>)
     .def_readonly("order_ref", &CThostFtdcInputOrderField::OrderRef)
     .def_readonly("user_id", &CThostFtdcInputOrderField::UserID)
     .def_property_readonly("order_price_type", tostr_OrderPriceType<CThostFtdcInputOrderField>)
@@ -755,7 +1044,8 @@ PYBIND11_MODULE(ctpclient, m) {
     .def_readonly("limit_price", &CThostFtdcInputOrderActionField::LimitPrice)
     .def_readonly("volume_change", &CThostFtdcInputOrderActionField::VolumeChange)
     .def_readonly("user_id", &CThostFtdcInputOrderActionField::UserID)
-    .def_readonly("instrument_id", &CThostFtdcInputOrderActionField::InstrumentID)
+    .def_property_readonly("instrument_id", instrument_id<CThostFtdcInputOrderActionField>)
+    .def_property_readonly("symbol_id", symbol_id<CThostFtdcInputOrderActionField>)
     .def_readonly("invest_unit_id", &CThostFtdcInputOrderActionField::InvestUnitID)
     .def_readonly("ip_address", &CThostFtdcInputOrderActionField::IPAddress)
     .def_readonly("mac_address", &CThostFtdcInputOrderActionField::MacAddress)
@@ -764,7 +1054,8 @@ PYBIND11_MODULE(ctpclient, m) {
   py::class_<CThostFtdcOrderField, std::shared_ptr<CThostFtdcOrderField>>(m, "Order")
     .def_readonly("broker_id", &CThostFtdcOrderField::BrokerID)
     .def_readonly("investor_id", &CThostFtdcOrderField::InvestorID)
-    .def_readonly("instrument_id", &CThostFtdcOrderField::InstrumentID)
+    .def_property_readonly("instrument_id", instrument_id<CThostFtdcOrderField>)
+    .def_property_readonly("symbol_id", symbol_id<CThostFtdcOrderField>)
     .def_readonly("order_ref", &CThostFtdcOrderField::OrderRef)
     .def_property_readonly("price_type", tostr_OrderPriceType<CThostFtdcOrderField>)
     .def_property_readonly("direction", tostr_Direction<CThostFtdcOrderField>)
@@ -826,7 +1117,8 @@ PYBIND11_MODULE(ctpclient, m) {
   py::class_<CThostFtdcTradeField>(m, "Trade")
     .def_readonly("broker_id", &CThostFtdcTradeField::BrokerID)
     .def_readonly("investor_id", &CThostFtdcTradeField::InvestorID)
-    .def_readonly("instrument_id", &CThostFtdcTradeField::InstrumentID)
+    .def_property_readonly("instrument_id", instrument_id<CThostFtdcTradeField>)
+    .def_property_readonly("symbol_id", symbol_id<CThostFtdcTradeField>)
     .def_readonly("order_ref", &CThostFtdcTradeField::OrderRef)
     .def_readonly("user_id", &CThostFtdcTradeField::UserID)
     .def_readonly("exchange_id", &CThostFtdcTradeField::ExchangeID)
@@ -881,7 +1173,8 @@ PYBIND11_MODULE(ctpclient, m) {
     .def_property_readonly("order_action_status", toenum_OrderActionStatus<CThostFtdcOrderActionField>)
     .def_readonly("user_id", &CThostFtdcOrderActionField::UserID)
     .def_property_readonly("status_msg", [](CThostFtdcOrderActionField const *this_) { return py::bytes(this_->StatusMsg); })
-    .def_readonly("instrument_id", &CThostFtdcOrderActionField::InstrumentID)
+    .def_property_readonly("instrument_id", instrument_id<CThostFtdcOrderActionField>)
+    .def_property_readonly("symbol_id", symbol_id<CThostFtdcOrderActionField>)
     .def_readonly("branch_id", &CThostFtdcOrderActionField::BranchID)
     .def_readonly("invest_unit_id", &CThostFtdcOrderActionField::InvestUnitID)
     .def_readonly("ip_address", &CThostFtdcOrderActionField::IPAddress)
@@ -896,6 +1189,7 @@ PYBIND11_MODULE(ctpclient, m) {
     .def_property_readonly_static("__version__", &CtpClient::GetApiVersion)
     .def_property("flow_path", &CtpClient::GetFlowPath, &CtpClient::SetFlowPath)
     .def_property("md_address", &CtpClient::GetMdAddr, &CtpClient::SetMdAddr)
+    .def_property("redundant_md_addresses", &CtpClient::GetRedundantMdAddrs, &CtpClient::SetRedundantMdAddrs)
     .def_property("td_address", &CtpClient::GetTdAddr, &CtpClient::SetTdAddr)
     .def_property("broker_id", &CtpClient::GetBrokerId, &CtpClient::SetBrokerId)
     .def_property("user_id", &CtpClient::GetUserId, &CtpClient::SetUserId)
@@ -904,13 +1198,101 @@ PYBIND11_MODULE(ctpclient, m) {
     .def_property("app_id", &CtpClient::GetAppId, &CtpClient::SetAppId)
     .def_property("instrument_ids", &CtpClient::GetInstrumentIds, &CtpClient::SetInstrumentIds)
     .def_property("idle_delay", &CtpClient::GetIdleDelay, &CtpClient::SetIdleDelay)
+    .def_property("catalog_path", &CtpClient::GetCatalogPath, &CtpClient::SetCatalogPath)
+    .def_property("latency_enabled", &CtpClient::IsLatencyEnabled, &CtpClient::SetLatencyEnabled)
+    .def_property("feed_monitor_enabled", &CtpClient::IsFeedMonitorEnabled, &CtpClient::SetFeedMonitorEnabled)
+    .def_property("feed_gap_threshold", &CtpClient::GetFeedGapThreshold, &CtpClient::SetFeedGapThreshold)
+    .def_property("feed_stall_timeout", &CtpClient::GetFeedStallTimeout, &CtpClient::SetFeedStallTimeout)
+    .def_property("feed_utc_offset", &CtpClient::GetFeedUtcOffset, &CtpClient::SetFeedUtcOffset)
+    .def_property("queue_limit", &CtpClient::GetQueueLimit, &CtpClient::SetQueueLimit)
+    .def_property("overflow_policy", &CtpClient::GetOverflowPolicy, &CtpClient::SetOverflowPolicy)
+    .def_property("event_mask", &CtpClient::GetEventMask, &CtpClient::SetEventMask)
+    .def_property("fixed_point_prices", &CtpClient::IsFixedPointPrices, &CtpClient::SetFixedPointPrices)
+    .def_property("auto_session", &CtpClient::IsAutoSession, &CtpClient::SetAutoSession)
+    .def_property("session_timeout", &CtpClient::GetSessionTimeout, &CtpClient::SetSessionTimeout)
+    .def_property("session_retry_delay", &CtpClient::GetSessionRetryDelay, &CtpClient::SetSessionRetryDelay)
+    .def_property("session_attempts", &CtpClient::GetSessionAttempts, &CtpClient::SetSessionAttempts)
+    .def_property_readonly("md_session_state", &CtpClient::GetMdSessionState)
+    .def_property_readonly("td_session_state", &CtpClient::GetTdSessionState)
+    .def_property("conflate_market_data", &CtpClient::IsConflating, &CtpClient::SetConflating)
+    .def_property("subscribe_chunk_size", &CtpClient::GetSubscribeChunkSize, &CtpClient::SetSubscribeChunkSize)
+    .def_property_readonly("subscribed_instrument_ids", &CtpClient::GetSubscribedInstrumentIds)
+    .def_property_readonly("pending_instrument_ids", &CtpClient::GetPendingInstrumentIds)
+    .def_property_readonly("composites", &CtpClient::GetCompositeIds)
+    .def_property_readonly("spread_quotes", &CtpClient::GetSpreadQuotes)
     .def("init", &CtpClient::Init)
-    .def("join", &CtpClient::Join)
+    .def("join", &CtpClient::Join, py::call_guard<py::gil_scoped_release>())
     .def("exit", &CtpClient::Exit)
+    .def("poll", &CtpClient::Poll, "max_events"_a=0, py::call_guard<py::gil_scoped_release>())
+    .def_property_readonly("exited", &CtpClient::IsExited)
+    .def("latency_stats", &CtpClient::GetLatencyStats)
+    .def("reset_latency_stats", &CtpClient::ResetLatencyStats)
+    .def("feed_stats", &CtpClient::GetFeedStats)
+    .def("feed_instrument_stats", &CtpClient::GetFeedInstrumentStats, "instrument_id"_a)
+    .def("stalled_instruments", &CtpClient::GetStalledInstruments)
+    .def("reset_feed_stats", &CtpClient::ResetFeedStats)
+    .def("md_front_stats", &CtpClient::GetMdFrontStats)
+    .def("reset_md_front_stats", &CtpClient::ResetMdFrontStats)
+    .def("queue_stats", &CtpClient::GetQueueStats)
+    .def("reset_queue_stats", &CtpClient::ResetQueueStats)
+
+    .def("bench_market_data", &CtpClient::BenchmarkMarketData,
+         "instruments"_a=100, "updates"_a=100000, "rate"_a=0.0, py::call_guard<py::gil_scoped_release>())
+    .def("bench_order_insert", &CtpClient::BenchmarkOrderInsert, "instrument_id"_a="BENCH0000", "orders"_a=100000)
+    .def_property("loopback_native_strategy", &CtpClient::IsLoopbackNativeStrategy, &CtpClient::SetLoopbackNativeStrategy)
+    .def_property_readonly("loopback_running", &CtpClient::IsLoopbackRunning)
+    .def("start_loopback", &CtpClient::StartLoopback, "instruments"_a=10, "updates"_a=100000, "rate"_a=10000.0)
+    .def("stop_loopback", &CtpClient::StopLoopback, py::call_guard<py::gil_scoped_release>())
+    .def("loopback_stats", &CtpClient::GetLoopbackStats)
+    .def("reset_loopback_stats", &CtpClient::ResetLoopbackStats)
 
     .def("md_login", &CtpClient::MdLogin)
     .def("subscribe_market_data", &CtpClient::SubscribeMarketData)
     .def("unsubscribe_market_data", &CtpClient::UnsubscribeMarketData)
+    .def("set_subscriptions", &CtpClient::SetSubscriptions)
+    .def("add_main_contract", &CtpClient::AddMainContract,
+         "product_id"_a, "instrument_id"_a="", "adjust"_a=false, "threshold"_a=1.0, "main_id"_a="")
+    .def("main_contract", &CtpClient::GetMainContract, "product_id"_a)
+    .def("main_contract_ranking", &CtpClient::GetMainContractRanking, "product_id"_a)
+    .def("add_composite", &CtpClient::AddComposite, "instrument_id"_a, "legs"_a, "open_interest_weighted"_a=false)
+    .def("remove_composite", &CtpClient::RemoveComposite, "instrument_id"_a)
+    .def("composite_legs", &CtpClient::GetCompositeLegs, "instrument_id"_a)
+    .def("add_spread", &CtpClient::AddSpread, "spread_id"_a, "legs"_a, "max_skew"_a=500)
+    .def("remove_spread", &CtpClient::RemoveSpread, "spread_id"_a)
+    .def("spread_quote", &CtpClient::GetSpreadQuote, "spread_id"_a)
+    .def("add_indicator", &CtpClient::AddIndicator,
+         "instrument_id"_a, "name"_a, "type"_a, "period"_a=14, "k"_a=2.0)
+    .def("remove_indicators", &CtpClient::RemoveIndicators, "instrument_id"_a)
+    .def("indicators", &CtpClient::GetIndicators, "instrument_id"_a)
+    .def("indicator_names", &CtpClient::GetIndicatorNames, "instrument_id"_a)
+    .def("indicator_values", [](CtpClient &self, const std::string &instrumentId, bool copy) -> py::object {
+        // 只读视图，与 indicator_names 一一对应，在 on_1min/on_1min_tick 前就地刷新
+        // 视图的长度在创建时确定，之后添加的指标需要重新取视图
+        size_t width = 0;
+        const double *values = self.GetIndicatorBuffer(instrumentId, width);
+        if (values == nullptr) return py::none();
+        if (copy) return py::array_t<double>(static_cast<py::ssize_t>(width), values);
+
+        py::array_t<double> view(static_cast<py::ssize_t>(width), values, py::cast(&self, py::return_value_policy::reference));
+        view.attr("setflags")(false);
+        return view;
+    }, "instrument_id"_a, "copy"_a=false)
+    .def("track_history", &CtpClient::TrackHistory, "instrument_id"_a, "ticks"_a=0, "bars"_a=240)
+    .def("warm_up", &CtpClient::WarmUp, "dir"_a, "instrument_ids"_a=std::vector<std::string>(), "bars"_a=240)
+    .def("save_history", &CtpClient::SaveHistory, "dir"_a)
+    .def("tick_history", [](CtpClient &self, const std::string &instrumentId, size_t n, bool copy) -> py::object {
+        const TickRecord *records = self.GetTickHistory(instrumentId, n);
+        if (records == nullptr) return py::none();
+        return history_view(self, records, n, copy);
+    }, "instrument_id"_a, "n"_a=0, "copy"_a=false)
+    .def("bar_history", [](CtpClient &self, const std::string &instrumentId, size_t n, bool copy) -> py::object {
+        const BarRecord *records = self.GetBarHistory(instrumentId, n);
+        if (records == nullptr) return py::none();
+        return history_view(self, records, n, copy);
+    }, "instrument_id"_a, "n"_a=0, "copy"_a=false)
+    .def("quote", &CtpClient::GetQuote, "instrument_id"_a)
+    .def("price_tick", &CtpClient::GetPriceTick, "instrument_id"_a)
+    .def("set_price_tick", &CtpClient::SetPriceTick, "instrument_id"_a, "tick"_a)
     .def("on_md_front_connected", &CtpClient::OnMdFrontConnected)
     .def("on_md_front_disconnected", &CtpClient::OnMdFrontDisconnected)
     .def("on_md_user_login", &CtpClient::OnMdUserLogin)
@@ -921,6 +1303,11 @@ PYBIND11_MODULE(ctpclient, m) {
     .def("on_tick", &CtpClient::OnTick)
     .def("on_1min", &CtpClient::On1Min)
     .def("on_1min_tick", &CtpClient::On1MinTick)
+    .def("on_main_contract_roll", &CtpClient::OnMainContractRoll)
+    .def("on_spread_quote", &CtpClient::OnSpreadQuote)
+    .def("on_market_data_recovery", &CtpClient::OnMarketDataRecovery)
+    .def("on_depth_ticks", &CtpClient::OnDepthTicks)
+    .def("on_quote", &CtpClient::OnQuote)
 
     .def("td_authenticate", &CtpClient::TdAuthenticate)
     .def("td_login", &CtpClient::TdLogin)
@@ -931,9 +1318,19 @@ PYBIND11_MODULE(ctpclient, m) {
     .def("query_investor_position", &CtpClient::QueryInvestorPosition)
     .def("query_investor_position_detail", &CtpClient::QueryInvestorPositionDetail)
     .def("query_market_data", &CtpClient::QueryMarketData, "instrument_id"_a, "request_id"_a=0)
+    .def("load_instruments", &CtpClient::LoadInstruments)
+    .def("instrument", &CtpClient::GetInstrument, "instrument_id"_a)
+    .def("product", &CtpClient::GetProduct, "product_id"_a)
+    .def("instruments", &CtpClient::ListInstruments, "product_id"_a="")
+    .def("products", &CtpClient::ListProducts)
     .def("insert_order", &CtpClient::InsertOrder)
     .def("order_action", &CtpClient::OrderAction)
     .def("delete_order", &CtpClient::DeleteOrder)
+    .def_property_readonly("accounts", &CtpClient::GetAccounts)
+    .def("add_account", &CtpClient::AddAccount,
+         "user_id"_a, "password"_a, "broker_id"_a="", "app_id"_a="", "auth_code"_a="", "td_address"_a="")
+    .def("account_status", &CtpClient::GetAccountStatus, "user_id"_a)
+    .def("allocate", &CtpClient::Allocate, "instrument_id"_a, "direction"_a, "offset_flag"_a, "price"_a, "volumes"_a)
     .def("on_td_front_connected", &CtpClient::OnTdFrontConnected)
     .def("on_td_authenticate", &CtpClient::OnTdAuthenticate)
     .def("on_td_user_login", &CtpClient::OnTdUserLogin)
@@ -943,13 +1340,26 @@ PYBIND11_MODULE(ctpclient, m) {
     .def("on_err_order_action", &CtpClient::OnErrOrderAction)
     .def("on_rtn_order", &CtpClient::OnRtnOrder)
     .def("on_rtn_trade", &CtpClient::OnRtnTrade)
+    .def("on_account_status", &CtpClient::OnAccountStatus)
     .def("on_rsp_order", &CtpClient::OnRspQryOrder)
     .def("on_rsp_trade", &CtpClient::OnRspQryTrade)
     .def("on_rsp_trading_account", &CtpClient::OnRspQryTradingAccount)
     .def("on_rsp_investor_position", &CtpClient::OnRspQryInvestorPosition)
     .def("on_rsp_investor_position_detail", &CtpClient::OnRspQryInvestorPositionDetail)
     .def("on_rsp_market_data", &CtpClient::OnRspQryDepthMarketData)
+    .def("on_instruments_ready", &CtpClient::OnInstrumentsReady)
     .def("on_idle", &CtpClient::OnIdle)
+    .def("on_session_state", &CtpClient::OnSessionState)
     .def("on_exception", &CtpClient::OnException)
     ;
+
+  py::class_<Dispatcher>(m, "Dispatcher")
+    .def(py::init<>())
+    .def_property_readonly("count", &Dispatcher::GetCount)
+    .def_property("max_events", &Dispatcher::GetMaxEvents, &Dispatcher::SetMaxEvents)
+    .def("add", &Dispatcher::Add, "client"_a, py::keep_alive<1, 2>())
+    .def("remove", &Dispatcher::Remove, "client"_a)
+    .def("run", &Dispatcher::Run, "threads"_a=1, py::call_guard<py::gil_scoped_release>())
+    .def("stop", &Dispatcher::Stop)
+    ;
 };
@@ -0,0 +1,272 @@
+/*
+ * Copyright 2019 Holmes Conan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <atomic>
+#include <fstream>
+#include "catalog.h"
+#include "symbols.h"
+
+namespace {
+
+// The cache stores the CTP structs as they are, so it is only valid for the
+// same API version; the record sizes in the header guard against that.
+struct CacheHeader {
+    char magic[8];
+    char tradingDay[12];
+    uint32_t instrumentSize;
+    uint32_t productSize;
+    uint32_t instrumentCount;
+    uint32_t productCount;
+};
+
+const char CACHE_MAGIC[8] = "CTPCAT1";
+
+}
+
+InstrumentCatalog::InstrumentCatalog()
+: _snapshot(std::make_shared<Snapshot>())
+{
+    //
+}
+
+void InstrumentCatalog::Intern(const Snapshot &snapshot)
+{
+    auto &symbols = SymbolTable::Instance();
+    for (auto &kv : snapshot.instruments) {
+        symbols.Intern(kv.first.c_str());
+    }
+}
+
+bool InstrumentCatalog::Begin(const std::string &tradingDay)
+{
+    bool loading = false;
+    if (!_loading.compare_exchange_strong(loading, true, std::memory_order_acq_rel)) {
+        return false;
+    }
+    Stage(tradingDay);
+    return true;
+}
+
+void InstrumentCatalog::Stage(const std::string &tradingDay)
+{
+    _staging = std::make_shared<Snapshot>();
+    _staging->tradingDay = tradingDay;
+    _aborted = false;
+}
+
+void InstrumentCatalog::Add(const CThostFtdcProductField &product)
+{
+    if (_aborted) return;
+    if (!_staging) Stage("");
+    _staging->products[product.ProductID] = product;
+}
+
+void InstrumentCatalog::Add(const CThostFtdcInstrumentField &instrument)
+{
+    if (_aborted) return;
+    if (!_staging) Stage("");
+    _staging->instruments[instrument.InstrumentID] = instrument;
+}
+
+void InstrumentCatalog::Abort()
+{
+    _staging.reset();
+    _aborted = true;
+}
+
+bool InstrumentCatalog::Commit()
+{
+    bool aborted = _aborted;
+    _aborted = false;
+    if (aborted || !_staging || _staging->instruments.empty()) {
+        _staging.reset();
+        _loading.store(false, std::memory_order_release);
+        return false;
+    }
+
+    Intern(*_staging);
+    std::shared_ptr<const Snapshot> snapshot = std::move(_staging);
+    std::atomic_store(&_snapshot, snapshot);
+    _loading.store(false, std::memory_order_release);
+    return true;
+}
+
+void InstrumentCatalog::Cancel()
+{
+    Abort();
+    _loading.store(false, std::memory_order_release);
+}
+
+std::string InstrumentCatalog::CacheFile(const std::string &dir, const std::string &tradingDay)
+{
+#ifdef WIN32
+    return dir + "\\instruments-" + tradingDay + ".dat";
+#else
+    return dir + "/instruments-" + tradingDay + ".dat";
+#endif
+}
+
+bool InstrumentCatalog::Load(const std::string &path, const std::string &tradingDay)
+{
+    std::ifstream ifs(path, std::ios::binary);
+    if (!ifs) return false;
+
+    CacheHeader header;
+    if (!ifs.read(reinterpret_cast<char*>(&header), sizeof header)) return false;
+    if (memcmp(header.magic, CACHE_MAGIC, sizeof header.magic) != 0
+        || header.instrumentSize != sizeof(CThostFtdcInstrumentField)
+        || header.productSize != sizeof(CThostFtdcProductField)
+        || tradingDay != header.tradingDay) {
+        return false;
+    }
+
+    auto snapshot = std::make_shared<Snapshot>();
+    snapshot->tradingDay = tradingDay;
+    snapshot->products.reserve(header.productCount);
+    snapshot->instruments.reserve(header.instrumentCount);
+
+    CThostFtdcProductField product;
+    for (uint32_t i = 0; i < header.productCount; i++) {
+        if (!ifs.read(reinterpret_cast<char*>(&product), sizeof product)) return false;
+        snapshot->products[product.ProductID] = product;
+    }
+
+    CThostFtdcInstrumentField instrument;
+    for (uint32_t i = 0; i < header.instrumentCount; i++) {
+        if (!ifs.read(reinterpret_cast<char*>(&instrument), sizeof instrument)) return false;
+        snapshot->instruments[instrument.InstrumentID] = instrument;
+    }
+
+    Intern(*snapshot);
+    std::shared_ptr<const Snapshot> published = std::move(snapshot);
+    std::atomic_store(&_snapshot, published);
+    return true;
+}
+
+bool InstrumentCatalog::Save(const std::string &path) const
+{
+    auto snapshot = Current();
+
+    CacheHeader header;
+    memset(&header, 0, sizeof header);
+    memcpy(header.magic, CACHE_MAGIC, sizeof header.magic);
+    strncpy(header.tradingDay, snapshot->tradingDay.c_str(), sizeof header.tradingDay - 1);
+    header.instrumentSize = sizeof(CThostFtdcInstrumentField);
+    header.productSize = sizeof(CThostFtdcProductField);
+    header.instrumentCount = static_cast<uint32_t>(snapshot->instruments.size());
+    header.productCount = static_cast<uint32_t>(snapshot->products.size());
+
+    // 先写临时文件再改名，避免留下不完整的缓存
+    std::string tmpPath = path + ".tmp";
+    {
+        std::ofstream ofs(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!ofs) return false;
+
+        ofs.write(reinterpret_cast<const char*>(&header), sizeof header);
+        for (auto &kv : snapshot->products) {
+            ofs.write(reinterpret_cast<const char*>(&kv.second), sizeof kv.second);
+        }
+        for (auto &kv : snapshot->instruments) {
+            ofs.write(reinterpret_cast<const char*>(&kv.second), sizeof kv.second);
+        }
+        if (!ofs) return false;
+    }
+
+    std::remove(path.c_str());
+    return std::rename(tmpPath.c_str(), path.c_str()) == 0;
+}
+
+bool InstrumentCatalog::FindInstrument(const std::string &instrumentId, CThostFtdcInstrumentField &instrument) const
+{
+    auto snapshot = Current();
+    auto iter = snapshot->instruments.find(instrumentId);
+    if (iter == snapshot->instruments.end()) return false;
+
+    instrument = iter->second;
+    return true;
+}
+
+bool InstrumentCatalog::FindProduct(const std::string &productId, CThostFtdcProductField &product) const
+{
+    auto snapshot = Current();
+    auto iter = snapshot->products.find(productId);
+    if (iter == snapshot->products.end()) return false;
+
+    product = iter->second;
+    return true;
+}
+
+double InstrumentCatalog::GetPriceTick(const std::string &instrumentId) const
+{
+    auto snapshot = Current();
+    auto iter = snapshot->instruments.find(instrumentId);
+    return iter == snapshot->instruments.end() ? 0.0 : iter->second.PriceTick;
+}
+
+int InstrumentCatalog::GetVolumeMultiple(const std::string &instrumentId) const
+{
+    auto snapshot = Current();
+    auto iter = snapshot->instruments.find(instrumentId);
+    return iter == snapshot->instruments.end() ? 0 : iter->second.VolumeMultiple;
+}
+
+std::string InstrumentCatalog::GetProductId(const std::string &instrumentId) const
+{
+    auto snapshot = Current();
+    auto iter = snapshot->instruments.find(instrumentId);
+    return iter == snapshot->instruments.end() ? std::string() : std::string(iter->second.ProductID);
+}
+
+std::string InstrumentCatalog::GetExchangeId(const std::string &instrumentId) const
+{
+    auto snapshot = Current();
+    auto iter = snapshot->instruments.find(instrumentId);
+    return iter == snapshot->instruments.end() ? std::string() : std::string(iter->second.ExchangeID);
+}
+
+std::vector<std::string> InstrumentCatalog::GetInstrumentIds(const std::string &productId) const
+{
+    auto snapshot = Current();
+    std::vector<std::string> v;
+    for (auto &kv : snapshot->instruments) {
+        if (productId.empty() || productId == kv.second.ProductID) {
+            v.push_back(kv.first);
+        }
+    }
+    return v;
+}
+
+std::vector<std::string> InstrumentCatalog::GetProductIds() const
+{
+    auto snapshot = Current();
+    std::vector<std::string> v;
+    for (auto &kv : snapshot->products) {
+        v.push_back(kv.first);
+    }
+    return v;
+}
+
+size_t InstrumentCatalog::GetInstrumentCount() const
+{
+    return Current()->instruments.size();
+}
+
+std::string InstrumentCatalog::GetTradingDay() const
+{
+    return Current()->tradingDay;
+}
@@ -0,0 +1,89 @@
+/*
+ * Copyright 2019 Holmes Conan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "ThostFtdcUserApiStruct.h"
+
+/*
+ * Instruments and products returned by ReqQryInstrument/ReqQryProduct.
+ *
+ * Pages are collected into a staging snapshot and published at once when the
+ * last page arrives, so lookups from any thread see a complete catalog and
+ * never block the loader.
+ *
+ * Only one load is in flight at a time: `Begin` claims it and `Commit` or
+ * `Cancel` ends it, since the staging snapshot is filled without locking.
+ */
+class InstrumentCatalog
+{
+    struct Snapshot {
+        std::string tradingDay;
+        std::unordered_map<std::string, CThostFtdcInstrumentField> instruments;
+        std::unordered_map<std::string, CThostFtdcProductField> products;
+    };
+
+    std::shared_ptr<const Snapshot> _snapshot;
+    std::shared_ptr<Snapshot> _staging;
+    bool _aborted = false;
+    std::atomic_bool _loading{false};
+
+    inline std::shared_ptr<const Snapshot> Current() const { return std::atomic_load(&_snapshot); }
+    // Assigns symbol ids to all instruments of the catalog.
+    static void Intern(const Snapshot &snapshot);
+    void Stage(const std::string &tradingDay);
+
+public:
+    InstrumentCatalog();
+    InstrumentCatalog(const InstrumentCatalog&) = delete;
+    InstrumentCatalog& operator=(const InstrumentCatalog&) = delete;
+
+    // Starts a load, false if another one is still in flight. The pages are
+    // then added and committed from the dispatch thread only.
+    bool Begin(const std::string &tradingDay);
+    inline bool IsLoading() const { return _loading.load(std::memory_order_acquire); }
+    void Add(const CThostFtdcProductField &product);
+    void Add(const CThostFtdcInstrumentField &instrument);
+    // Drops the staging snapshot after an error response, pages arriving
+    // afterwards are ignored until the next `Begin`.
+    void Abort();
+    // Publishes the staging snapshot and ends the load, false if it was
+    // aborted or holds no instrument, in which case the current catalog is kept.
+    bool Commit();
+    // Ends a load whose remaining pages will never arrive, e.g. after the
+    // front disconnected; the current catalog is kept.
+    void Cancel();
+
+    // Cache file of one trading day, written with `Save` and read back with `Load`.
+    static std::string CacheFile(const std::string &dir, const std::string &tradingDay);
+    bool Load(const std::string &path, const std::string &tradingDay);
+    bool Save(const std::string &path) const;
+
+    // Lookups
+    bool FindInstrument(const std::string &instrumentId, CThostFtdcInstrumentField &instrument) const;
+    bool FindProduct(const std::string &productId, CThostFtdcProductField &product) const;
+    double GetPriceTick(const std::string &instrumentId) const;
+    int GetVolumeMultiple(const std::string &instrumentId) const;
+    std::string GetProductId(const std::string &instrumentId) const;
+    std::string GetExchangeId(const std::string &instrumentId) const;
+    std::vector<std::string> GetInstrumentIds(const std::string &productId) const;
+    std::vector<std::string> GetProductIds() const;
+    size_t GetInstrumentCount() const;
+    std::string GetTradingDay() const;
+};
@@ -0,0 +1,156 @@
+/*
+ * Copyright 2019 Holmes Conan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <cfloat>
+#include <cstring>
+#include "composite.h"
+#include "symbols.h"
+
+void CompositeEngine::Add(const std::string &instrumentId, const std::vector<std::pair<std::string, double>> &legs, bool weightedByOpenInterest)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto &composite = _composites[instrumentId];
+    composite = Composite();
+    composite.instrumentId = instrumentId;
+    composite.symbolId = SymbolTable::Instance().Intern(instrumentId.c_str());
+    composite.weightedByOpenInterest = weightedByOpenInterest;
+    for (auto &leg : legs) {
+        composite.legs[leg.first].weight = leg.second;
+    }
+    composite.pending = composite.legs.size();
+
+    Index();
+    _enabled.store(!_composites.empty(), std::memory_order_release);
+}
+
+void CompositeEngine::Remove(const std::string &instrumentId)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _composites.erase(instrumentId);
+
+    Index();
+    _enabled.store(!_composites.empty(), std::memory_order_release);
+}
+
+void CompositeEngine::Index()
+{
+    _legs.clear();
+    for (auto &kv : _composites) {
+        for (auto &leg : kv.second.legs) {
+            _legs[leg.first].emplace_back(&kv.second, &leg.second);
+        }
+    }
+}
+
+void CompositeEngine::Update(const CThostFtdcDepthMarketDataField *pDepthMarketData, std::vector<MarketDataEvent> &out)
+{
+    out.clear();
+    if (!_enabled.load(std::memory_order_acquire)) return;
+    if (!IsValidPrice(pDepthMarketData->LastPrice)) return;
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto iter = _legs.find(pDepthMarketData->InstrumentID);
+    if (iter == _legs.end()) return;
+
+    for (auto &ref : iter->second) {
+        auto &composite = *ref.first;
+        auto &leg = *ref.second;
+
+        // 先减去该腿上一次的贡献，再加上这一次的
+        if (leg.ready) {
+            composite.sumPrice -= leg.factor * leg.price;
+            composite.sumFactor -= leg.factor;
+            composite.volume -= leg.volume;
+            composite.turnover -= leg.turnover;
+            composite.openInterest -= leg.openInterest;
+        } else {
+            leg.ready = true;
+            composite.pending--;
+        }
+
+        leg.factor = composite.weightedByOpenInterest ? leg.weight * pDepthMarketData->OpenInterest : leg.weight;
+        leg.price = pDepthMarketData->LastPrice;
+        leg.volume = pDepthMarketData->Volume;
+        leg.turnover = pDepthMarketData->Turnover;
+        leg.openInterest = pDepthMarketData->OpenInterest;
+
+        composite.sumPrice += leg.factor * leg.price;
+        composite.sumFactor += leg.factor;
+        composite.volume += leg.volume;
+        composite.turnover += leg.turnover;
+        composite.openInterest += leg.openInterest;
+
+        if (composite.pending > 0) continue;
+
+        double price = composite.sumPrice;
+        if (composite.weightedByOpenInterest) {
+            if (composite.sumFactor <= 0) continue;
+            price /= composite.sumFactor;
+        }
+
+        if (composite.tradingDay != pDepthMarketData->TradingDay) {
+            composite.tradingDay = pDepthMarketData->TradingDay;
+            composite.openPrice = composite.highestPrice = composite.lowestPrice = price;
+        } else {
+            if (price > composite.highestPrice) composite.highestPrice = price;
+            if (price < composite.lowestPrice) composite.lowestPrice = price;
+        }
+
+        out.emplace_back();
+        auto &r = out.back();
+        memset(&r, 0, sizeof r);
+        strncpy(r.InstrumentID, composite.instrumentId.c_str(), sizeof r.InstrumentID - 1);
+        r.SymbolId = composite.symbolId;
+        memcpy(r.TradingDay, pDepthMarketData->TradingDay, sizeof r.TradingDay);
+        memcpy(r.ActionDay, pDepthMarketData->ActionDay, sizeof r.ActionDay);
+        memcpy(r.UpdateTime, pDepthMarketData->UpdateTime, sizeof r.UpdateTime);
+        r.UpdateMillisec = pDepthMarketData->UpdateMillisec;
+        r.LastPrice = price;
+        r.OpenPrice = composite.openPrice;
+        r.HighestPrice = composite.highestPrice;
+        r.LowestPrice = composite.lowestPrice;
+        r.Volume = composite.volume;
+        r.Turnover = composite.turnover;
+        r.OpenInterest = composite.openInterest;
+        // 合成合约没有这些价格
+        r.PreSettlementPrice = r.PreClosePrice = r.ClosePrice = r.SettlementPrice = DBL_MAX;
+        r.UpperLimitPrice = r.LowerLimitPrice = DBL_MAX;
+        r.BidPrice1 = r.AskPrice1 = r.BidPrice2 = r.AskPrice2 = r.BidPrice3 = r.AskPrice3 = DBL_MAX;
+        r.BidPrice4 = r.AskPrice4 = r.BidPrice5 = r.AskPrice5 = DBL_MAX;
+    }
+}
+
+std::vector<std::string> CompositeEngine::GetInstrumentIds() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::vector<std::string> v;
+    for (auto &kv : _composites) {
+        v.push_back(kv.first);
+    }
+    return v;
+}
+
+std::vector<std::pair<std::string, double>> CompositeEngine::GetLegs(const std::string &instrumentId) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::vector<std::pair<std::string, double>> v;
+    auto iter = _composites.find(instrumentId);
+    if (iter == _composites.end()) return v;
+
+    for (auto &kv : iter->second.legs) {
+        v.emplace_back(kv.first, kv.second.weight);
+    }
+    return v;
+}
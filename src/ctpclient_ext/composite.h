@@ -0,0 +1,85 @@
+/*
+ * Copyright 2019 Holmes Conan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <utility>
+#include <unordered_map>
+#include "ThostFtdcUserApiStruct.h"
+#include "bar.h"
+
+/*
+ * Synthetic instruments defined as weighted legs, e.g. a spread (weights 1
+ * and -1) or a product index weighted by open interest.
+ *
+ * Each composite keeps running sums of its legs' contributions; a leg tick
+ * replaces that leg's contribution only, and the composite's depth record is
+ * produced once every leg has a price.
+ */
+class CompositeEngine
+{
+    struct Leg {
+        double weight = 1.0;
+        double factor = 0;
+        double price = 0;
+        TThostFtdcVolumeType volume = 0;
+        TThostFtdcMoneyType turnover = 0;
+        TThostFtdcLargeVolumeType openInterest = 0;
+        bool ready = false;
+    };
+
+    struct Composite {
+        std::string instrumentId;
+        uint32_t symbolId = 0;
+        bool weightedByOpenInterest = false;
+        std::map<std::string, Leg> legs;
+        size_t pending = 0;     // legs without a price yet
+        double sumPrice = 0;
+        double sumFactor = 0;
+        TThostFtdcVolumeType volume = 0;
+        TThostFtdcMoneyType turnover = 0;
+        TThostFtdcLargeVolumeType openInterest = 0;
+        std::string tradingDay;
+        double openPrice = 0;
+        double highestPrice = 0;
+        double lowestPrice = 0;
+    };
+
+    mutable std::mutex _mutex;
+    std::atomic_bool _enabled{false};
+    std::map<std::string, Composite> _composites;
+    // leg instrument -> composites using it
+    std::unordered_map<std::string, std::vector<std::pair<Composite*, Leg*>>> _legs;
+
+    void Index();
+
+public:
+    CompositeEngine() = default;
+    CompositeEngine(const CompositeEngine&) = delete;
+    CompositeEngine& operator=(const CompositeEngine&) = delete;
+
+    // Redefining an existing composite replaces its legs.
+    void Add(const std::string &instrumentId, const std::vector<std::pair<std::string, double>> &legs, bool weightedByOpenInterest);
+    void Remove(const std::string &instrumentId);
+    // Fills `out` with the depth records of composites changed by this leg tick, with the symbol ids interned by Add.
+    void Update(const CThostFtdcDepthMarketDataField *pDepthMarketData, std::vector<MarketDataEvent> &out);
+
+    std::vector<std::string> GetInstrumentIds() const;
+    std::vector<std::pair<std::string, double>> GetLegs(const std::string &instrumentId) const;
+};
@@ -0,0 +1,67 @@
+/*
+ * Copyright 2019 Holmes Conan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <cstring>
+#include "conflator.h"
+
+Conflator::Slot* Conflator::Find(const char *instrumentId)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto &slot = _slots[instrumentId];
+    if (!slot) {
+        slot.reset(new Slot());
+    }
+    return slot.get();
+}
+
+void Conflator::Update(const CThostFtdcDepthMarketDataField *pDepthMarketData, uint32_t symbolId, const TickBar &tick, const M1Bar &m1, int64_t tsEntry, int64_t tsEnqueue)
+{
+    auto slot = Find(pDepthMarketData->InstrumentID);
+
+    std::lock_guard<std::mutex> lock(slot->mutex);
+    memcpy(&slot->depth, pDepthMarketData, sizeof slot->depth);
+    slot->symbolId = symbolId;
+    memcpy(&slot->tick, &tick, sizeof slot->tick);
+    memcpy(&slot->m1, &m1, sizeof slot->m1);
+    slot->tsEntry = tsEntry;
+    slot->tsEnqueue = tsEnqueue;
+    if (slot->dirty) {
+        _conflated.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        slot->dirty = true;
+        _dirty.enqueue(slot);
+    }
+}
+
+bool Conflator::IsPending(const char *instrumentId)
+{
+    return Find(instrumentId)->dirty.load(std::memory_order_acquire);
+}
+
+bool Conflator::Drain(CThostFtdcDepthMarketDataField &depth, uint32_t &symbolId, TickBar &tick, M1Bar &m1, int64_t &tsEntry, int64_t &tsEnqueue)
+{
+    Slot *slot;
+    if (!_dirty.try_dequeue(slot)) return false;
+
+    std::lock_guard<std::mutex> lock(slot->mutex);
+    memcpy(&depth, &slot->depth, sizeof depth);
+    symbolId = slot->symbolId;
+    memcpy(&tick, &slot->tick, sizeof tick);
+    memcpy(&m1, &slot->m1, sizeof m1);
+    tsEntry = slot->tsEntry;
+    tsEnqueue = slot->tsEnqueue;
+    slot->dirty = false;
+    return true;
+}
@@ -0,0 +1,78 @@
+/*
+ * Copyright 2019 Holmes Conan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <cstdint>
+#include <unordered_map>
+#include "ThostFtdcUserApiStruct.h"
+#include "bar.h"
+#include "concurrentqueue.h"
+
+/*
+ * Latest market data state per instrument for the conflated delivery mode.
+ *
+ * The market data thread overwrites the instrument's slot and queues the slot
+ * once when it becomes dirty; Join drains the dirty slots, so each instrument
+ * is delivered at most once per drain with its newest depth, tick and 1 minute
+ * bar. Cumulative volume/turnover are part of the state and stay exact.
+ * The latency stamps are those of the newest update.
+ *
+ * Outside of the conflated mode the slots hold the updates FlowControl keeps
+ * out of the full response queue.
+ */
+class Conflator
+{
+    struct Slot {
+        std::mutex mutex;
+        CThostFtdcDepthMarketDataField depth;
+        uint32_t symbolId = 0;
+        TickBar tick;
+        M1Bar m1;
+        int64_t tsEntry = 0;
+        int64_t tsEnqueue = 0;
+        std::atomic_bool dirty{false};
+    };
+
+    std::atomic_bool _enabled{false};
+    std::mutex _mutex;
+    std::unordered_map<std::string, std::unique_ptr<Slot>> _slots;
+    moodycamel::ConcurrentQueue<Slot*> _dirty;
+    std::atomic<uint64_t> _conflated{0};
+
+    Slot* Find(const char *instrumentId);
+
+public:
+    Conflator() = default;
+    Conflator(const Conflator&) = delete;
+    Conflator& operator=(const Conflator&) = delete;
+
+    inline bool IsEnabled() const { return _enabled.load(std::memory_order_relaxed); }
+    inline void SetEnabled(bool enabled) { _enabled.store(enabled, std::memory_order_relaxed); }
+
+    void Update(const CThostFtdcDepthMarketDataField *pDepthMarketData, uint32_t symbolId, const TickBar &tick, const M1Bar &m1, int64_t tsEntry, int64_t tsEnqueue);
+    // Whether the instrument has an update waiting to be drained.
+    bool IsPending(const char *instrumentId);
+    // Upper bound of the slots to drain in this cycle.
+    inline size_t GetDirtyCount() const { return _dirty.size_approx(); }
+    bool Drain(CThostFtdcDepthMarketDataField &depth, uint32_t &symbolId, TickBar &tick, M1Bar &m1, int64_t &tsEntry, int64_t &tsEnqueue);
+
+    // Updates overwritten before they were delivered.
+    inline uint64_t GetConflated() const { return _conflated.load(std::memory_order_relaxed); }
+    inline void Reset() { _conflated.store(0, std::memory_order_relaxed); }
+};
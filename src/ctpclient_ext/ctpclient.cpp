@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 #include <ctime>
+#include <algorithm>
 #include <csignal>
 #include <string>
 #include <future>
@@ -25,15 +26,22 @@
 #include "mdspi.h"
 #include "traderspi.h"
 #include "ctpclient.h"
+#include "bench.h"
 
 using namespace std::chrono_literals;
 
-std::promise<void> g_exitPromise;
-std::shared_future<void> g_exitSignal(g_exitPromise.get_future());
+namespace {
+
+// Ctrl-C 让所有实例退出，由各自的 Poll 检查；按次数计，Init 之前的中断不影响新的会话
+volatile std::sig_atomic_t g_interrupts = 0;
 
 void signal_handler(int signal)
 {
-    g_exitPromise.set_value();
+    g_interrupts = g_interrupts + 1;
+}
+
+std::once_flag g_signalOnce;
+
 }
 
 #define assert_request(request) _assertRequest((request), #request)
@@ -43,11 +51,35 @@ void signal_handler(int signal)
 CtpClient::CtpClient(const std::string &mdAddr, const std::string &tdAddr, const std::string &brokerId, const std::string &userId, const std::string &password)
 : _mdAddr(mdAddr), _tdAddr(tdAddr), _brokerId(brokerId), _userId(userId), _password(password)
 {
-    std::signal(SIGINT, signal_handler);
+    std::call_once(g_signalOnce, [] { std::signal(SIGINT, signal_handler); });
+    _exitSignal = _exitPromise.get_future().share();
+    _mainContracts.SetProductOf([this](const std::string &instrumentId) {
+        return _catalog.GetProductId(instrumentId);
+    });
+    _feed.SetExchangeOf([this](const std::string &instrumentId) {
+        return _catalog.GetExchangeId(instrumentId);
+    });
+    _tickScale.SetTickSizeOf([this](const std::string &instrumentId) {
+        return _catalog.GetPriceTick(instrumentId);
+    });
 }
 
 CtpClient::~CtpClient()
 {
+    if (_thread.joinable()) {
+        Exit();
+        _thread.join();
+    }
+
+    // 账户会话回调会写入本实例的队列，先于其他成员释放
+    _router.Stop();
+    _loopback.Stop();
+
+    // 冗余前置的行情经由 _mdSpi 发布
+    for (auto mirror : _mdMirrors) {
+        delete mirror;
+    }
+
     if (_mdSpi) {
         delete _mdSpi;
     }
@@ -57,10 +89,11 @@ CtpClient::~CtpClient()
     }
 }
 
-void CtpClient::_assertRequest(int rc, const char *request)
+bool CtpClient::_assertRequest(int rc, const char *request)
 {
     if (rc == 0) {
         // 发送成功
+        return true;
     } else {
         std::stringstream ss;
         ss << request << " failed because of ";
@@ -80,12 +113,18 @@ void CtpClient::_assertRequest(int rc, const char *request)
             ss << "too frequently request.";
             OnException(ss.str());
             break;
+        case -5:
+            // 路由账户未登录或结算单未确认
+            ss << "account session not ready.";
+            OnException(ss.str());
+            break;
         default:
             ss << "unknown reason: " << rc;
             OnException(ss.str());
             break;
         }
         _requestResponsed.store(true, std::memory_order_release);
+        return false;
     }
 }
 
@@ -104,20 +143,57 @@ void CtpClient::Init()
 #define PATH_SEP "/"
 #endif
 
+    _interrupts = g_interrupts;
+    _subscriptions.Add(_instrumentIds);
+    if (GetEventMask() & EM_Auto) {
+        SetEventMask(EM_All);
+    }
+    if (_indicators.IsEnabled() || _history.IsBarEnabled()) {
+        SetEventMask(GetEventMask() | EM_1Min);
+    }
+    if (_history.IsTickEnabled()) {
+        SetEventMask(GetEventMask() | EM_Tick);
+    }
+
     if (_mdAddr != "") {
         auto mdFlowPath = _flowPath + PATH_SEP "md-";
 
-        _mdApi = CThostFtdcMdApi::CreateFtdcMdApi(mdFlowPath.c_str(), /*using udp*/false, /*multicast*/false);
+        if (LoopbackFront::IsLoopback(_mdAddr)) {
+            _mdApi = new LoopbackMdApi(&_loopback);
+        } else {
+            _mdApi = CThostFtdcMdApi::CreateFtdcMdApi(mdFlowPath.c_str(), /*using udp*/false, /*multicast*/false);
+        }
         _mdSpi = new MdSpi(this);
         _mdApi->RegisterSpi(_mdSpi);
         _mdApi->RegisterFront(const_cast<char*>(_mdAddr.c_str()));
         _mdApi->Init();
+
+        std::vector<std::string> fronts{_mdAddr};
+        fronts.insert(fronts.end(), _redundantMdAddrs.begin(), _redundantMdAddrs.end());
+        _arbiter.SetFronts(fronts);
+        for (size_t i = 1; i < fronts.size(); i++) {
+            auto mirror = new MdMirrorSpi(this, i, fronts[i]);
+            _mdMirrors.push_back(mirror);
+            mirror->Start(_flowPath + PATH_SEP "md" + std::to_string(i) + "-");
+        }
     }
 
     if (_tdAddr != "") {
         auto tdFlowPath = _flowPath + PATH_SEP "td-";
 
-        _tdApi = CThostFtdcTraderApi::CreateFtdcTraderApi(tdFlowPath.c_str());
+        if (LoopbackFront::IsLoopback(_tdAddr)) {
+            _tdApi = new LoopbackTraderApi(&_loopback);
+            // 回环前置的原生参考策略：每个 tick 以最新价买开一手，不经过 Python
+            if (_loopback.IsNativeStrategy()) {
+                _nativeOnTick = [this](const TickBar &tick) {
+                    CThostFtdcInputOrderField req;
+                    FillInputOrder(req, tick.InstrumentID, D_Buy, OF_Open, tick.Price, 1);
+                    InsertInputOrder(req);
+                };
+            }
+        } else {
+            _tdApi = CThostFtdcTraderApi::CreateFtdcTraderApi(tdFlowPath.c_str());
+        }
         _tdSpi = new TraderSpi(this);
         _tdApi->RegisterSpi(_tdSpi);
         _tdApi->SubscribePrivateTopic(THOST_TERT_QUICK);
@@ -126,44 +202,79 @@ void CtpClient::Init()
         _tdApi->Init();
     }
 
+    _router.Start(_flowPath + PATH_SEP "td-");
+
     _requestResponsed = true;
     _thread = std::thread([this](std::shared_future<void> exitSignal) {
         while (exitSignal.wait_for(1100ms) == std::future_status::timeout) {
             if (_requestResponsed.load(std::memory_order_acquire)) {
                 CtpClient::Request req;
                 if (_requestQueue.try_dequeue(req)) {
+                    _flow.OnRequestDequeued();
                     _requestResponsed.store(false, std::memory_order_release);
                     ProcessRequest(req);
                 }
             }
         }
-    }, g_exitSignal);
+    }, _exitSignal);
+    _idleTimer = std::chrono::steady_clock::now();
 }
 
 void CtpClient::Join()
 {
-    auto timer = std::chrono::steady_clock::now();
-    while (g_exitSignal.wait_for(10ms) == std::future_status::timeout) {
-        CtpClient::Response rsp;
-        while (_responseQueue.try_dequeue(rsp)) {
-            ProcessResponse(rsp);
-        }
+    while (_exitSignal.wait_for(10ms) == std::future_status::timeout) {
+        Poll();
+    }
+    Shutdown();
+}
 
-        {
-            auto duration = std::chrono::steady_clock::now() - timer;
-            if (std::chrono::duration_cast<std::chrono::milliseconds>(duration) > _idleDelay * 1ms) {
-                OnIdle();
-                timer = std::chrono::steady_clock::now();
-            }
+size_t CtpClient::Poll(size_t maxEvents)
+{
+    if (g_interrupts != _interrupts) {
+        Exit();
+    }
+    if (IsExited()) return 0;
+
+    CheckSessions();
+
+    // 只处理本轮开始时已变脏的合约，之后再变脏的留到下一轮
+    size_t dispatched = 0;
+    size_t conflated = _conflator.GetDirtyCount();
+    while (maxEvents == 0 || dispatched < maxEvents) {
+        if (DispatchNext()) {
+            dispatched++;
+            continue;
+        }
+        if (conflated > 0 && DispatchConflated()) {
+            conflated--;
+            dispatched++;
+            continue;
         }
+        break;
     }
 
-    _thread.join();
+    auto duration = std::chrono::steady_clock::now() - _idleTimer;
+    if (std::chrono::duration_cast<std::chrono::milliseconds>(duration) > _idleDelay * 1ms) {
+        OnIdle();
+        _idleTimer = std::chrono::steady_clock::now();
+    }
+    return dispatched;
+}
+
+void CtpClient::Shutdown()
+{
+    _flow.Close();
+    if (_thread.joinable()) {
+        _thread.join();
+    }
 }
 
 void CtpClient::Exit()
 {
-    g_exitPromise.set_value();
+    _flow.Close();
+    if (!_exited.exchange(true)) {
+        _exitPromise.set_value();
+    }
 }
 
 void CtpClient::Enqueue(ResponseType type, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast) {
@@ -172,9 +283,196 @@ void CtpClient::Enqueue(ResponseType type, CThostFtdcRspInfoField *pRspInfo, int
     Enqueue(r);
 }
 
-void CtpClient::Enqueue(const CtpClient::Response &r)
+void CtpClient::EnqueueMarketData(const CThostFtdcDepthMarketDataField *pDepthMarketData, uint32_t symbolId, FlowControl::Slot *slot, uint64_t seq)
 {
-    _responseQueue.enqueue(r);
+    Response r;
+    r.Init(ResponseType::OnRtnMarketData, nullptr, 0, true);
+    memcpy(&r.DepthMarketData, pDepthMarketData, sizeof *pDepthMarketData);
+    r.DepthMarketData.SymbolId = symbolId;
+    r.slot = slot;
+    r.seq = seq;
+    Enqueue(r);
+}
+
+void CtpClient::Enqueue(CtpClient::Response &r)
+{
+    _latency.Stamp(r.tsEntry, r.tsEnqueue);
+    _flow.OnEnqueued();
+    _responseQueues[GetLane(r.type)].enqueue(r);
+}
+
+CtpClient::Lane CtpClient::GetLane(ResponseType type)
+{
+    switch (type) {
+    case ResponseType::OnMdFrontConnected:
+    case ResponseType::OnMdFrontDisconnected:
+    case ResponseType::OnMdUserLogin:
+    case ResponseType::OnMdUserLogout:
+    case ResponseType::OnSubMarketData:
+    case ResponseType::OnUnSubMarketData:
+    case ResponseType::OnMdError:
+        return ControlLane;
+    case ResponseType::OnRtnMarketData:
+    case ResponseType::OnTick:
+    case ResponseType::On1Min:
+    case ResponseType::On1MinTick:
+    case ResponseType::OnDepthTicks:
+    case ResponseType::OnMainContractRoll:
+    case ResponseType::OnSpreadQuote:
+    case ResponseType::OnMarketDataRecovery:
+        return MarketDataLane;
+    default:
+        return TraderLane;
+    }
+}
+
+bool CtpClient::DispatchNext()
+{
+    CtpClient::Response rsp;
+    for (auto &lane : _responseQueues) {
+        if (lane.try_dequeue(rsp)) {
+            Dispatch(rsp);
+            return true;
+        }
+    }
+
+    // 与行情同级，排在其后
+    QuoteEvent e;
+    if (_quoteQueue.try_dequeue(e)) {
+        DispatchQuote(e);
+        return true;
+    }
+    return false;
+}
+
+void CtpClient::EnqueueQuote(const Quote &quote, FlowControl::Slot *slot, uint64_t seq)
+{
+    QuoteEvent e;
+    memcpy(e.quote, &quote, sizeof quote);
+    e.tsEntry = e.tsEnqueue = 0;
+    e.slot = slot;
+    e.seq = seq;
+    _latency.Stamp(e.tsEntry, e.tsEnqueue);
+    _flow.OnEnqueued(FlowControl::Quotes);
+    _quoteQueue.enqueue(e);
+}
+
+void CtpClient::DispatchQuote(QuoteEvent &e)
+{
+    if (!_flow.OnDequeued(e.slot, e.seq, FlowControl::Quotes)) return;
+
+    Quote quote;
+    memcpy(&quote, e.quote, sizeof quote);
+    LatencyStats::Cause cause(e.tsEntry);
+    if (e.tsEnqueue == 0) {
+        OnQuote(&quote);
+        return;
+    }
+
+    auto dequeued = LatencyStats::Now();
+    py::gil_scoped_acquire acquire;
+    auto acquired = LatencyStats::Now();
+    OnQuote(&quote);
+    _latency.Record(e.tsEntry, e.tsEnqueue, dequeued, acquired, LatencyStats::Now());
+}
+
+bool CtpClient::DispatchConflated()
+{
+    CThostFtdcDepthMarketDataField depth;
+    TickBar tick;
+    M1Bar m1;
+    uint32_t symbolId;
+    int64_t tsEntry, tsEnqueue;
+    if (!_conflator.Drain(depth, symbolId, tick, m1, tsEntry, tsEnqueue)) return false;
+
+    LatencyStats::Cause cause(tsEntry);
+    if (tsEnqueue == 0) {
+        ProcessConflated(depth, symbolId, tick, m1);
+        return true;
+    }
+
+    // 一次取出的所有事件作为一笔计时
+    auto dequeued = LatencyStats::Now();
+    py::gil_scoped_acquire acquire;
+    auto acquired = LatencyStats::Now();
+    ProcessConflated(depth, symbolId, tick, m1);
+    _latency.Record(tsEntry, tsEnqueue, dequeued, acquired, LatencyStats::Now());
+    return true;
+}
+
+void CtpClient::ProcessConflated(const CThostFtdcDepthMarketDataField &depth, uint32_t symbolId, const TickBar &tick, const M1Bar &m1)
+{
+    uint32_t mask = GetEventMask();
+    CtpClient::Response r;
+    if (mask & EM_MarketData) {
+        r.Init(ResponseType::OnRtnMarketData, nullptr, 0, true);
+        memcpy(&r.DepthMarketData, &depth, sizeof depth);
+        r.DepthMarketData.SymbolId = symbolId;
+        ProcessResponse(r);
+    }
+
+    if (mask & EM_Tick) {
+        r.Init(ResponseType::OnTick, nullptr, 0, true);
+        memcpy(&r.tick, &tick, sizeof tick);
+        ProcessResponse(r);
+    }
+
+    if (mask & EM_1MinTick) {
+        r.Init(ResponseType::On1MinTick, nullptr, 0, true);
+        memcpy(&r.m1, &m1, sizeof m1);
+        ProcessResponse(r);
+    }
+
+    if (mask & EM_Quote) {
+        Quote quote;
+        ToQuote(&depth, symbolId, quote);
+        OnQuote(&quote);
+    }
+
+    double priceTick = _tickScale.IsEnabled() ? _tickScale.Get(symbolId) : 0.0;
+    if (priceTick > 0.0 && (mask & EM_DepthTicks)) {
+        r.Init(ResponseType::OnDepthTicks, nullptr, 0, true);
+        ToTicks(&depth, symbolId, priceTick, r.depthTicks);
+        ProcessResponse(r);
+    }
+}
+
+std::map<std::string, int64_t> CtpClient::GetQueueStats() const
+{
+    auto stats = _flow.GetStats();
+    stats["conflated"] = int64_t(_conflator.GetConflated());
+    return stats;
+}
+
+void CtpClient::ResetQueueStats()
+{
+    _flow.Reset();
+    _conflator.Reset();
+}
+
+void CtpClient::EnqueueRequest(CtpClient::Request &r)
+{
+    _flow.OnRequestEnqueued();
+    _requestQueue.enqueue(r);
+}
+
+void CtpClient::Dispatch(CtpClient::Response &r)
+{
+    // 过载时被合并/丢弃的行情
+    if (!_flow.OnDequeued(r.slot, r.seq)) return;
+
+    // 回调中发出的请求以这条应答为起因计时
+    LatencyStats::Cause cause(r.tsEntry);
+    if (r.tsEnqueue == 0) {
+        ProcessResponse(r);
+        return;
+    }
+
+    auto dequeued = LatencyStats::Now();
+    py::gil_scoped_acquire acquire;
+    auto acquired = LatencyStats::Now();
+    ProcessResponse(r);
+    _latency.Record(r.tsEntry, r.tsEnqueue, dequeued, acquired, LatencyStats::Now());
 }
 
 void CtpClient::ProcessRequest(CtpClient::Request &r)
@@ -198,6 +496,18 @@ void CtpClient::ProcessRequest(CtpClient::Request &r)
     case RequestType::QueryMarketData:
         assert_request(_tdApi->ReqQryDepthMarketData(&r.QryDepthMarketData, r.nRequestID));
         break;
+    case RequestType::QueryProduct:
+        assert_request(_tdApi->ReqQryProduct(&r.QryProduct, r.nRequestID));
+        break;
+    case RequestType::QueryInstrument:
+        if (!assert_request(_tdApi->ReqQryInstrument(&r.QryInstrument, r.nRequestID))) {
+            // 查询未发出则不会有应答，以出错的最后一页结束这次加载
+            CThostFtdcRspInfoField rspInfo;
+            memset(&rspInfo, 0, sizeof rspInfo);
+            rspInfo.ErrorID = -1;
+            Enqueue(ResponseType::OnRspQryInstrument, &rspInfo, r.nRequestID, true);
+        }
+        break;
     default:
         throw std::invalid_argument("unhandled request type.");
     }
@@ -207,70 +517,149 @@ void CtpClient::ProcessResponse(CtpClient::Response &r)
 {
     switch (r.type) {
     case ResponseType::OnMdFrontConnected:
+        if (_autoSession) {
+            SetSession(false, SessionState::Connected);
+            StepSession(false, SessionState::LoggingIn);
+        }
         OnMdFrontConnected();
         break;
     case ResponseType::OnMdFrontDisconnected:
+        _mdLoggedIn = false;
+        _subscriptions.Reset();
+        if (_autoSession) {
+            SetSession(false, SessionState::Disconnected);
+        }
         OnMdFrontDisconnected(r.nReason);
         break;
     case ResponseType::OnMdUserLogin:
+        if (r.bRspInfoIsNone || r.RspInfo.ErrorID == 0) {
+            _mdLoggedIn = true;
+            // 断线重连后重新订阅
+            SyncSubscriptions();
+            // 用快照对齐断线期间的分钟线，重连后先到的行情也会完成对齐
+            if (_mdSpi && _mdSpi->GetStaleCount() > 0 && _tdApi) {
+                QueryMarketData("", RECOVERY_REQUEST_ID);
+            }
+            if (_autoSession && _mdSession.GetState() == SessionState::LoggingIn) {
+                SetSession(false, SessionState::Ready);
+            }
+        } else if (_autoSession) {
+            _mdSession.Fail();
+        }
         OnMdUserLogin(r.ptr<CThostFtdcRspUserLoginField>(), r.ptr<CThostFtdcRspInfoField>());
         break;
     case ResponseType::OnMdUserLogout:
         OnMdUserLogout(r.ptr<CThostFtdcUserLogoutField>(), r.ptr<CThostFtdcRspInfoField>());
         break;
     case ResponseType::OnSubMarketData:
+        if (!r.bRspIsNone && _subscriptions.OnSubscribed(r.SpecificInstrument.InstrumentID, r.bRspInfoIsNone || r.RspInfo.ErrorID == 0)) {
+            SyncSubscriptions();
+        }
         OnSubscribeMarketData(r.ptr<CThostFtdcSpecificInstrumentField>(), r.ptr<CThostFtdcRspInfoField>(), r.bIsLast);
         break;
     case ResponseType::OnUnSubMarketData:
+        if (!r.bRspIsNone && _subscriptions.OnUnsubscribed(r.SpecificInstrument.InstrumentID, r.bRspInfoIsNone || r.RspInfo.ErrorID == 0)) {
+            SyncSubscriptions();
+        }
         OnUnsubscribeMarketData(r.ptr<CThostFtdcSpecificInstrumentField>(), r.ptr<CThostFtdcRspInfoField>(), r.bIsLast);
         break;
     case ResponseType::OnRtnMarketData:
     {
-        auto pDepthMarketData = std::make_shared<CThostFtdcDepthMarketDataField>();
-        memcpy(pDepthMarketData.get(), &r.DepthMarketData, sizeof r.DepthMarketData);
+        auto pDepthMarketData = MakeEvent(r.DepthMarketData);
         OnRtnMarketData(pDepthMarketData);
     }
         break;
     case ResponseType::OnTick:
     {
-        auto pTickBar = std::make_shared<TickBar>();
-        memcpy(pTickBar.get(), &r.tick, sizeof r.tick);
+        _history.Append(r.tick);
+        if (_nativeOnTick) {
+            _nativeOnTick(r.tick);
+            break;
+        }
+        auto pTickBar = MakeEvent(r.tick);
         OnTick(pTickBar);
     }
         break;
     case ResponseType::On1Min:
     {
-        auto pM1Bar = std::make_shared<M1Bar>();
-        memcpy(pM1Bar.get(), &r.m1, sizeof r.m1);
+        _indicators.Update(r.m1, true);
+        _history.Append(r.m1);
+        auto pM1Bar = MakeEvent(r.m1);
         On1Min(pM1Bar);
     }
         break;
     case ResponseType::On1MinTick:
     {
-        auto pM1Bar = std::make_shared<M1Bar>();
-        memcpy(pM1Bar.get(), &r.m1, sizeof r.m1);
+        _indicators.Update(r.m1, false);
+        auto pM1Bar = MakeEvent(r.m1);
         On1MinTick(pM1Bar);
     }
         break;
+    case ResponseType::OnDepthTicks:
+        OnDepthTicks(&r.depthTicks);
+        break;
+    case ResponseType::OnMainContractRoll:
+        OnMainContractRoll(&r.roll);
+        break;
+    case ResponseType::OnSpreadQuote:
+        OnSpreadQuote(&r.spread);
+        break;
+    case ResponseType::OnMarketDataRecovery:
+        OnMarketDataRecovery(&r.recovery);
+        break;
     case ResponseType::OnMdError:
         OnMdError(r.ptr<CThostFtdcRspInfoField>());
         break;
     case ResponseType::OnTdFrontConnected:
+        if (_autoSession) {
+            SetSession(true, SessionState::Connected);
+            StepSession(true, _authCode.empty() ? SessionState::LoggingIn : SessionState::Authenticating);
+        }
         OnTdFrontConnected();
         break;
     case ResponseType::OnTdFrontDisconnected:
+        if (_autoSession) {
+            // 断线前未返回的查询不会再有应答
+            _requestResponsed.store(true, std::memory_order_release);
+            SetSession(true, SessionState::Disconnected);
+        }
+        // 断线前未返回的合约查询不会再有应答
+        if (_catalog.IsLoading()) {
+            _catalog.Cancel();
+        }
         OnTdFrontDisconnected(r.nReason);
         break;
     case ResponseType::OnTdAuthenticate:
+        if (_autoSession && _tdSession.GetState() == SessionState::Authenticating) {
+            if (r.bRspInfoIsNone || r.RspInfo.ErrorID == 0) {
+                StepSession(true, SessionState::LoggingIn);
+            } else {
+                _tdSession.Fail();
+            }
+        }
         OnTdAuthenticate(r.ptr<CThostFtdcRspAuthenticateField>(), r.ptr<CThostFtdcRspInfoField>());
         break;
     case ResponseType::OnTdUserLogin:
+        if (_autoSession && _tdSession.GetState() == SessionState::LoggingIn) {
+            if (r.bRspInfoIsNone || r.RspInfo.ErrorID == 0) {
+                StepSession(true, SessionState::Confirming);
+            } else {
+                _tdSession.Fail();
+            }
+        }
         OnTdUserLogin(r.ptr<CThostFtdcRspUserLoginField>(), r.ptr<CThostFtdcRspInfoField>());
         break;
     case ResponseType::OnTdUserLogout:
         OnTdUserLogout(r.ptr<CThostFtdcUserLogoutField>(), r.ptr<CThostFtdcRspInfoField>());
         break;
     case ResponseType::OnSettlementInfoConfirm:
+        if (_autoSession && _tdSession.GetState() == SessionState::Confirming) {
+            if (r.bRspInfoIsNone || r.RspInfo.ErrorID == 0) {
+                StepSession(true, SessionState::Syncing);
+            } else {
+                _tdSession.Fail();
+            }
+        }
         OnRspSettlementInfoConfirm(r.ptr<CThostFtdcSettlementInfoConfirmField>(), r.ptr<CThostFtdcRspInfoField>());
         break;
     case ResponseType::OnRspOrderInsert:
@@ -287,8 +676,7 @@ void CtpClient::ProcessResponse(CtpClient::Response &r)
         break;
     case ResponseType::OnRtnOrder:
     {
-        auto pOrder = std::make_shared<CThostFtdcOrderField>();
-        memcpy(pOrder.get(), &r.Order, sizeof r.Order);
+        auto pOrder = MakeEvent(r.Order);
         OnRtnOrder(pOrder);
     }
         break;
@@ -298,13 +686,15 @@ void CtpClient::ProcessResponse(CtpClient::Response &r)
     case ResponseType::OnTdError:
         OnTdError(r.ptr<CThostFtdcRspInfoField>());
         break;
+    case ResponseType::OnAccountStatus:
+        OnAccountStatus(r.account.UserID, r.account.Status, r.ptr<CThostFtdcRspInfoField>());
+        break;
     case ResponseType::OnRspQryOrder:
     {
         if (r.bRspIsNone) {
             OnRspQryOrder(nullptr, r.ptr<CThostFtdcRspInfoField>(), r.bIsLast);
         } else {
-            auto pOrder = std::make_shared<CThostFtdcOrderField>();
-            memcpy(pOrder.get(), &r.Order, sizeof r.Order);
+            auto pOrder = MakeEvent(r.Order);
             OnRspQryOrder(pOrder, r.ptr<CThostFtdcRspInfoField>(), r.bIsLast);
 
         }
@@ -322,8 +712,22 @@ void CtpClient::ProcessResponse(CtpClient::Response &r)
     case ResponseType::OnRspQryInvestorPosition:
         OnRspQryInvestorPosition(r.ptr<CThostFtdcInvestorPositionField>(), r.ptr<CThostFtdcRspInfoField>(), r.bIsLast);
         _requestResponsed.store(true, std::memory_order_release);
+        // 持仓在报单之后查询，持仓返回完毕即同步完成
+        if (_autoSession && r.bIsLast && _tdSession.GetState() == SessionState::Syncing) {
+            SetSession(true, SessionState::Ready);
+        }
         break;
     case ResponseType::OnRspQryDepthMarketData:
+        if (r.nRequestID == RECOVERY_REQUEST_ID) {
+            if (!r.bRspIsNone) {
+                _mdSpi->Recover(&r.DepthMarketData);
+            }
+            if (r.bIsLast) {
+                _mdSpi->FinishRecovery();
+                _requestResponsed.store(true, std::memory_order_release);
+            }
+            break;
+        }
         OnRspQryDepthMarketData(r.ptr<CThostFtdcDepthMarketDataField>(), r.ptr<CThostFtdcRspInfoField>(), r.nRequestID, r.bIsLast);
         _requestResponsed.store(true, std::memory_order_release);
         break;
@@ -331,6 +735,45 @@ void CtpClient::ProcessResponse(CtpClient::Response &r)
         OnRspQryInvestorPositionDetail(r.ptr<CThostFtdcInvestorPositionDetailField>(), r.ptr<CThostFtdcRspInfoField>(), r.bIsLast);
         _requestResponsed.store(true, std::memory_order_release);
         break;
+    case ResponseType::OnRspQryProduct:
+        if (r.ptr<CThostFtdcRspInfoField>() && r.RspInfo.ErrorID != 0) {
+            _catalog.Abort();
+        } else if (!r.bRspIsNone) {
+            _catalog.Add(r.Product);
+        }
+        // 分页返回，最后一页之后才能发送下一个查询
+        if (r.bIsLast) {
+            _requestResponsed.store(true, std::memory_order_release);
+        }
+        break;
+    case ResponseType::OnRspQryInstrument:
+        if (r.ptr<CThostFtdcRspInfoField>() && r.RspInfo.ErrorID != 0) {
+            _catalog.Abort();
+        } else if (!r.bRspIsNone) {
+            _catalog.Add(r.Instrument);
+        }
+        if (r.bIsLast) {
+            _requestResponsed.store(true, std::memory_order_release);
+            // 查询出错或没有返回合约时保留原有目录，也不覆盖缓存
+            if (!_catalog.Commit()) {
+                OnException("Instrument query failed, the catalog is not updated");
+                break;
+            }
+            _tickScale.Invalidate();
+
+            auto tradingDay = _catalog.GetTradingDay();
+            if (!_catalogPath.empty() && !tradingDay.empty()) {
+                auto path = InstrumentCatalog::CacheFile(_catalogPath, tradingDay);
+                if (!_catalog.Save(path)) {
+                    OnException("Cannot write instrument cache " + path);
+                }
+            }
+            OnInstrumentsReady(_catalog.GetInstrumentCount());
+        }
+        break;
+    case ResponseType::OnInstrumentsReady:
+        OnInstrumentsReady(_catalog.GetInstrumentCount());
+        break;
     default:
         throw std::invalid_argument("unhandled response type.");
     }
@@ -339,6 +782,72 @@ void CtpClient::ProcessResponse(CtpClient::Response &r)
 #pragma endregion
 
 
+#pragma region Sessions
+
+void CtpClient::SetSession(bool trader, SessionState state)
+{
+    auto &session = trader ? _tdSession : _mdSession;
+    session.Set(state);
+    OnSessionState(trader ? "td" : "md", state, 0);
+}
+
+void CtpClient::StepSession(bool trader, SessionState step)
+{
+    auto &session = trader ? _tdSession : _mdSession;
+    session.Begin(step);
+    OnSessionState(trader ? "td" : "md", step, session.GetAttempt());
+    SendSessionStep(trader);
+}
+
+void CtpClient::SendSessionStep(bool trader)
+{
+    if (!trader) {
+        if (_mdSession.GetState() == SessionState::LoggingIn) {
+            MdLogin();
+        }
+        return;
+    }
+
+    switch (_tdSession.GetState()) {
+    case SessionState::Authenticating:
+        TdAuthenticate();
+        break;
+    case SessionState::LoggingIn:
+        TdLogin();
+        break;
+    case SessionState::Confirming:
+        ConfirmSettlementInfo();
+        break;
+    case SessionState::Syncing:
+        QueryOrder("");
+        QueryInvestorPosition();
+        break;
+    default:
+        break;
+    }
+}
+
+void CtpClient::CheckSessions()
+{
+    if (!_autoSession) return;
+
+    for (bool trader : {false, true}) {
+        auto &session = trader ? _tdSession : _mdSession;
+        if (!session.IsDue()) continue;
+
+        // 超时或出错后重发当前步骤，次数用尽则等待下次重连
+        if (session.Retry()) {
+            OnSessionState(trader ? "td" : "md", session.GetState(), session.GetAttempt());
+            SendSessionStep(trader);
+        } else {
+            OnSessionState(trader ? "td" : "md", SessionState::Failed, session.GetAttempt());
+        }
+    }
+}
+
+#pragma endregion // Sessions
+
+
 #pragma region Market Data API
 
 void CtpClient::MdLogin()
@@ -355,28 +864,193 @@ void CtpClient::MdLogin()
 
 void CtpClient::SubscribeMarketData(const std::vector<std::string> &instrumentIds)
 {
-    size_t N = instrumentIds.size();
-    if (N == 0) return;
+    _subscriptions.Add(instrumentIds);
+    SyncSubscriptions();
+}
 
-    char **ppInstrumentIDs = new char*[N];
-    for (size_t i = 0; i < N; i++) {
-        ppInstrumentIDs[i] = const_cast<char*>(instrumentIds[i].c_str());
+void CtpClient::UnsubscribeMarketData(const std::vector<std::string> &instrumentIds)
+{
+    _subscriptions.Remove(instrumentIds);
+    SyncSubscriptions();
+}
+
+void CtpClient::SetSubscriptions(const std::vector<std::string> &instrumentIds)
+{
+    _subscriptions.Assign(instrumentIds);
+    SyncSubscriptions();
+}
+
+void CtpClient::SyncSubscriptions()
+{
+    // 未登录时只记录，登录后统一发送
+    if (_mdApi == nullptr || !_mdLoggedIn) return;
+
+    std::lock_guard<std::mutex> lock(_subscribeMutex);
+    std::vector<std::string> toSubscribe, toUnsubscribe;
+    _subscriptions.Diff(toSubscribe, toUnsubscribe);
+    SendSubscriptions(toUnsubscribe, false);
+    SendSubscriptions(toSubscribe, true);
+    for (auto mirror : _mdMirrors) {
+        mirror->Send(toUnsubscribe, false);
+        mirror->Send(toSubscribe, true);
     }
-    _mdApi->SubscribeMarketData(ppInstrumentIDs, N);
-    delete[] ppInstrumentIDs;
 }
 
-void CtpClient::UnsubscribeMarketData(const std::vector<std::string> &instrumentIds)
+void CtpClient::SendSubscriptions(const std::vector<std::string> &instrumentIds, bool subscribe)
+{
+    for (size_t begin = 0; begin < instrumentIds.size(); begin += _subscribeChunkSize) {
+        size_t end = std::min(begin + _subscribeChunkSize, instrumentIds.size());
+        _instrumentIdBuffer.clear();
+        for (size_t i = begin; i < end; i++) {
+            _instrumentIdBuffer.push_back(const_cast<char*>(instrumentIds[i].c_str()));
+        }
+
+        int rc = subscribe
+            ? _mdApi->SubscribeMarketData(_instrumentIdBuffer.data(), static_cast<int>(_instrumentIdBuffer.size()))
+            : _mdApi->UnSubscribeMarketData(_instrumentIdBuffer.data(), static_cast<int>(_instrumentIdBuffer.size()));
+        if (rc != 0) {
+            _subscriptions.Revert(std::vector<std::string>(instrumentIds.begin() + begin, instrumentIds.end()));
+            _assertRequest(rc, subscribe ? "SubscribeMarketData" : "UnSubscribeMarketData");
+            return;
+        }
+    }
+}
+
+void CtpClient::AddMainContract(const std::string &productId, const std::string &instrumentId, bool adjust, double threshold, const std::string &mainId)
 {
-    size_t N = instrumentIds.size();
-    if (N == 0) return;
+    if (productId.empty()) {
+        throw std::invalid_argument("product_id is required.");
+    }
+
+    _mainContracts.Add(productId, mainId.empty() ? productId + "888" : mainId, instrumentId, adjust, threshold);
 
-    char **ppInstrumentIDs = new char*[N];
-    for (size_t i = 0; i < N; i++) {
-        ppInstrumentIDs[i] = const_cast<char*>(instrumentIds[i].c_str());
+    // 订阅该品种的所有合约才能比较持仓量
+    auto instrumentIds = _catalog.GetInstrumentIds(productId);
+    if (!instrumentId.empty()) {
+        instrumentIds.push_back(instrumentId);
     }
-    _mdApi->UnSubscribeMarketData(ppInstrumentIDs, N);
-    delete[] ppInstrumentIDs;
+    SubscribeMarketData(instrumentIds);
+}
+
+void CtpClient::AddIndicator(const std::string &instrumentId, const std::string &name, IndicatorType type, int period, double k)
+{
+    if (instrumentId.empty() || name.empty()) {
+        throw std::invalid_argument("instrument_id and name are required.");
+    }
+
+    _indicators.Add(instrumentId, name, type, period, k);
+
+    // 指标依赖 1 分钟线；掩码尚待推断时由 Init 补上
+    auto mask = GetEventMask();
+    if ((mask & EM_Auto) == 0) {
+        SetEventMask(mask | EM_1Min);
+    }
+    SubscribeMarketData({instrumentId});
+}
+
+void CtpClient::TrackHistory(const std::string &instrumentId, size_t ticks, size_t bars)
+{
+    if (instrumentId.empty()) {
+        throw std::invalid_argument("instrument_id is required.");
+    }
+
+    _history.Track(instrumentId, ticks, bars);
+
+    auto mask = GetEventMask();
+    if ((mask & EM_Auto) == 0) {
+        SetEventMask(mask | (ticks > 0 ? EM_Tick : 0u) | (bars > 0 ? EM_1Min : 0u));
+    }
+    SubscribeMarketData({instrumentId});
+}
+
+std::map<std::string, size_t> CtpClient::WarmUp(const std::string &dir, const std::vector<std::string> &instrumentIds, size_t bars)
+{
+    py::gil_scoped_release release;
+
+    auto ids = instrumentIds.empty() ? _history.GetInstrumentIds() : instrumentIds;
+    std::map<std::string, size_t> loaded;
+    std::vector<BarRecord> records;
+    M1Bar bar;
+    for (auto &id : ids) {
+        if (!HistoryStore::Load(HistoryStore::ArchiveFile(dir, id), bars, records)) continue;
+
+        uint32_t symbolId = SymbolTable::Instance().Intern(id.c_str());
+        double tick = _tickScale.IsEnabled() ? _tickScale.Get(symbolId) : 0.0;
+        for (auto &record : records) {
+            HistoryStore::ToBar(record, id, symbolId, bar);
+            ToTicks(bar, tick);
+            _indicators.Update(bar, true);
+            _history.Append(bar);
+        }
+        loaded[id] = records.size();
+    }
+    return loaded;
+}
+
+size_t CtpClient::SaveHistory(const std::string &dir) const
+{
+    py::gil_scoped_release release;
+
+    size_t saved = 0;
+    for (auto &id : _history.GetInstrumentIds()) {
+        if (_history.Save(HistoryStore::ArchiveFile(dir, id), id)) {
+            saved++;
+        }
+    }
+    return saved;
+}
+
+void CtpClient::AddComposite(const std::string &instrumentId, const std::vector<std::pair<std::string, double>> &legs, bool weightedByOpenInterest)
+{
+    if (instrumentId.empty() || legs.empty()) {
+        throw std::invalid_argument("instrument_id and legs are required.");
+    }
+
+    _composites.Add(instrumentId, legs, weightedByOpenInterest);
+
+    // 主力连续合约由本地合成，不需要订阅
+    std::vector<std::string> instrumentIds;
+    for (auto &leg : legs) {
+        if (!_mainContracts.IsMainId(leg.first)) {
+            instrumentIds.push_back(leg.first);
+        }
+    }
+    SubscribeMarketData(instrumentIds);
+}
+
+void CtpClient::AddSpread(const std::string &spreadId, const std::vector<std::pair<std::string, double>> &legs, int maxSkew)
+{
+    if (spreadId.empty() || legs.empty()) {
+        throw std::invalid_argument("spread_id and legs are required.");
+    }
+
+    _spreads.Add(spreadId, legs, maxSkew);
+
+    std::vector<std::string> instrumentIds;
+    for (auto &leg : legs) {
+        if (!_mainContracts.IsMainId(leg.first)) {
+            instrumentIds.push_back(leg.first);
+        }
+    }
+    SubscribeMarketData(instrumentIds);
+}
+
+py::object CtpClient::GetSpreadQuote(const std::string &spreadId) const
+{
+    SpreadQuote quote;
+    if (!_spreads.GetQuote(spreadId, quote)) {
+        return py::none();
+    }
+    return py::cast(quote);
+}
+
+py::object CtpClient::GetQuote(const std::string &instrumentId) const
+{
+    Quote quote;
+    if (!_quoteBook.Get(SymbolTable::Instance().Find(instrumentId), quote)) {
+        return py::none();
+    }
+    return py::cast(quote);
 }
 
 #pragma endregion // Market Data API
@@ -473,7 +1147,7 @@ void CtpClientWrap::OnUnsubscribeMarketData(const CThostFtdcSpecificInstrumentFi
     );
 }
 
-void CtpClientWrap::OnRtnMarketData(std::shared_ptr<CThostFtdcDepthMarketDataField> pDepthMarketData)
+void CtpClientWrap::OnRtnMarketData(std::shared_ptr<MarketDataEvent> pDepthMarketData)
 {
     /* Acquire GIL before calling Python code */
     py::gil_scoped_acquire acquire;
@@ -529,6 +1203,76 @@ void CtpClientWrap::On1MinTick(std::shared_ptr<M1Bar> pBar)
     );
 }
 
+void CtpClientWrap::OnDepthTicks(const DepthTicks *pDepthTicks)
+{
+    /* Acquire GIL before calling Python code */
+    py::gil_scoped_acquire acquire;
+
+    PYBIND11_OVERLOAD_PURE_NAME(
+        void,
+        CtpClient,
+        "on_depth_ticks",
+        OnDepthTicks,
+        pDepthTicks
+    );
+}
+
+void CtpClientWrap::OnQuote(const Quote *pQuote)
+{
+    /* Acquire GIL before calling Python code */
+    py::gil_scoped_acquire acquire;
+
+    PYBIND11_OVERLOAD_PURE_NAME(
+        void,
+        CtpClient,
+        "on_quote",
+        OnQuote,
+        pQuote
+    );
+}
+
+void CtpClientWrap::OnMainContractRoll(const MainContractRoll *pRoll)
+{
+    /* Acquire GIL before calling Python code */
+    py::gil_scoped_acquire acquire;
+
+    PYBIND11_OVERLOAD_PURE_NAME(
+        void,
+        CtpClient,
+        "on_main_contract_roll",
+        OnMainContractRoll,
+        pRoll
+    );
+}
+
+void CtpClientWrap::OnSpreadQuote(const SpreadQuote *pQuote)
+{
+    /* Acquire GIL before calling Python code */
+    py::gil_scoped_acquire acquire;
+
+    PYBIND11_OVERLOAD_PURE_NAME(
+        void,
+        CtpClient,
+        "on_spread_quote",
+        OnSpreadQuote,
+        pQuote
+    );
+}
+
+void CtpClientWrap::OnMarketDataRecovery(const MarketDataRecovery *pRecovery)
+{
+    /* Acquire GIL before calling Python code */
+    py::gil_scoped_acquire acquire;
+
+    PYBIND11_OVERLOAD_PURE_NAME(
+        void,
+        CtpClient,
+        "on_market_data_recovery",
+        OnMarketDataRecovery,
+        pRecovery
+    );
+}
+
 void CtpClientWrap::OnMdError(const CThostFtdcRspInfoField *pRspInfo)
 {
     /* Acquire GIL before calling Python code */
@@ -591,7 +1335,7 @@ void CtpClient::QueryOrder(const std::string &instrumentId)
     strncpy(r.QryOrder.InvestorID, _userId.c_str(), sizeof r.QryOrder.InvestorID);
     strncpy(r.QryOrder.InstrumentID, instrumentId.c_str(), sizeof r.QryOrder.InstrumentID);
 
-    _requestQueue.enqueue(r);
+    EnqueueRequest(r);
 }
 
 void CtpClient::QueryTrade()
@@ -602,7 +1346,7 @@ void CtpClient::QueryTrade()
     strncpy(r.QryTrade.BrokerID, _brokerId.c_str(), sizeof r.QryTrade.BrokerID);
     strncpy(r.QryTrade.InvestorID, _userId.c_str(), sizeof r.QryTrade.InvestorID);
 
-    _requestQueue.enqueue(r);
+    EnqueueRequest(r);
 }
 
 void CtpClient::QueryTradingAccount()
@@ -614,7 +1358,7 @@ void CtpClient::QueryTradingAccount()
     strncpy(r.QryTradingAccount.InvestorID, _userId.c_str(), sizeof r.QryTradingAccount.InvestorID);
     strncpy(r.QryTradingAccount.CurrencyID, "CNY", sizeof r.QryTradingAccount.CurrencyID);
 
-    _requestQueue.enqueue(r);
+    EnqueueRequest(r);
 }
 
 void CtpClient::QueryInvestorPosition()
@@ -627,7 +1371,7 @@ void CtpClient::QueryInvestorPosition()
     // 不填写合约则返回所有持仓
     // strncpy(r.QryInvestorPosition.InstrumentID, "", sizeof r.QryInvestorPosition.InstrumentID);
 
-    _requestQueue.enqueue(r);
+    EnqueueRequest(r);
 }
 
 void CtpClient::QueryInvestorPositionDetail()
@@ -640,7 +1384,7 @@ void CtpClient::QueryInvestorPositionDetail()
     // 不填写合约则返回所有持仓
     // strncpy(r.QryInvestorPositionDetail.InstrumentID, "", sizeof r.QryInvestorPositionDetail.InstrumentID);
 
-    _requestQueue.enqueue(r);
+    EnqueueRequest(r);
 }
 
 void CtpClient::QueryMarketData(const std::string &instrumentId, int nRequestID)
@@ -651,12 +1395,61 @@ void CtpClient::QueryMarketData(const std::string &instrumentId, int nRequestID)
     strncpy(r.QryDepthMarketData.InstrumentID, instrumentId.c_str(), sizeof r.QryDepthMarketData.InstrumentID);
     r.nRequestID = nRequestID;
 
-    _requestQueue.enqueue(r);
+    EnqueueRequest(r);
 }
 
-void CtpClient::InsertOrder(const std::string &instrumentId, Direction direction, OffsetFlag offsetFlag, TThostFtdcPriceType limitPrice, TThostFtdcVolumeType volume, py::kwargs kwargs)
+void CtpClient::LoadInstruments()
+{
+    // 查询的分页在分发线程写入目录，同一时间只能有一次加载
+    if (_catalog.IsLoading()) {
+        throw std::runtime_error("instruments are being loaded.");
+    }
+
+    std::string tradingDay = _tdApi ? _tdApi->GetTradingDay() : "";
+    if (!_catalogPath.empty() && !tradingDay.empty()) {
+        auto path = InstrumentCatalog::CacheFile(_catalogPath, tradingDay);
+        if (_catalog.Load(path, tradingDay)) {
+            _tickScale.Invalidate();
+            Enqueue(ResponseType::OnInstrumentsReady, nullptr, 0, true);
+            return;
+        }
+    }
+
+    if (!_catalog.Begin(tradingDay)) {
+        throw std::runtime_error("instruments are being loaded.");
+    }
+
+    CtpClient::Request r;
+    memset(&r, 0, sizeof r);
+    r.type = RequestType::QueryProduct;
+    EnqueueRequest(r);
+
+    // 不填写合约则返回所有合约
+    memset(&r, 0, sizeof r);
+    r.type = RequestType::QueryInstrument;
+    EnqueueRequest(r);
+}
+
+py::object CtpClient::GetInstrument(const std::string &instrumentId) const
+{
+    CThostFtdcInstrumentField instrument;
+    if (!_catalog.FindInstrument(instrumentId, instrument)) {
+        return py::none();
+    }
+    return py::cast(instrument);
+}
+
+py::object CtpClient::GetProduct(const std::string &productId) const
+{
+    CThostFtdcProductField product;
+    if (!_catalog.FindProduct(productId, product)) {
+        return py::none();
+    }
+    return py::cast(product);
+}
+
+void CtpClient::FillInputOrder(CThostFtdcInputOrderField &req, const std::string &instrumentId, Direction direction, OffsetFlag offsetFlag, TThostFtdcPriceType limitPrice, TThostFtdcVolumeType volume)
 {
-    CThostFtdcInputOrderField req;
     memset(&req, 0, sizeof req);
     strncpy(req.BrokerID, _brokerId.c_str(), sizeof req.BrokerID);
     strncpy(req.InvestorID, _userId.c_str(), sizeof req.InvestorID);
@@ -684,6 +1477,11 @@ void CtpClient::InsertOrder(const std::string &instrumentId, Direction direction
 
     req.Direction = (TThostFtdcDirectionType)direction;
     req.CombOffsetFlag[0] = (TThostFtdcOffsetFlagType)offsetFlag;
+}
+
+void CtpClient::FillInputOrder(CThostFtdcInputOrderField &req, const std::string &instrumentId, Direction direction, OffsetFlag offsetFlag, TThostFtdcPriceType limitPrice, TThostFtdcVolumeType volume, py::kwargs kwargs)
+{
+    FillInputOrder(req, instrumentId, direction, offsetFlag, limitPrice, volume);
 
     if (kwargs.contains("order_price_type")) {
         req.OrderPriceType = (TThostFtdcOrderPriceTypeType)kwargs["order_price_type"].cast<OrderPriceType>();
@@ -712,7 +1510,17 @@ void CtpClient::InsertOrder(const std::string &instrumentId, Direction direction
     if (kwargs.contains("request_id")) {
         req.RequestID = kwargs["request_id"].cast<int>();
     }
+}
+
+void CtpClient::InsertOrder(const std::string &instrumentId, Direction direction, OffsetFlag offsetFlag, TThostFtdcPriceType limitPrice, TThostFtdcVolumeType volume, py::kwargs kwargs)
+{
+    CThostFtdcInputOrderField req;
+    FillInputOrder(req, instrumentId, direction, offsetFlag, limitPrice, volume, kwargs);
+    InsertInputOrder(req);
+}
 
+void CtpClient::InsertInputOrder(CThostFtdcInputOrderField &req)
+{
     assert_request(_tdApi->ReqOrderInsert(&req, req.RequestID));
 }
 
@@ -738,7 +1546,12 @@ void CtpClient::OrderAction(
     req.LimitPrice = limitPrice;
     req.VolumeChange = volumeChange;
 
-    assert_request(_tdApi->ReqOrderAction(&req, requestId));
+    // 路由账户的报单由其所属会话撤改
+    if (_router.Owns(req.InvestorID)) {
+        assert_request(_router.OrderAction(req, requestId));
+    } else {
+        assert_request(_tdApi->ReqOrderAction(&req, requestId));
+    }
 }
 
 void CtpClient::DeleteOrder(std::shared_ptr<CThostFtdcOrderField> pOrder, int requestId)
@@ -746,6 +1559,31 @@ void CtpClient::DeleteOrder(std::shared_ptr<CThostFtdcOrderField> pOrder, int re
     OrderAction(pOrder, OrderActionFlag::AF_Delete, 0.0, 0, requestId);
 }
 
+void CtpClient::AddAccount(const std::string &userId, const std::string &password, const std::string &brokerId, const std::string &appId, const std::string &authCode, const std::string &tdAddr)
+{
+    Account account;
+    account.userId = userId;
+    account.password = password;
+    account.brokerId = brokerId.empty() ? _brokerId : brokerId;
+    account.appId = appId.empty() ? _appId : appId;
+    account.authCode = authCode;
+    account.tdAddr = tdAddr.empty() ? _tdAddr : tdAddr;
+    if (account.tdAddr.empty()) {
+        throw std::invalid_argument("No trader front for account " + userId);
+    }
+
+    _router.Add(this, account);
+}
+
+std::map<std::string, std::string> CtpClient::Allocate(const std::string &instrumentId, Direction direction, OffsetFlag offsetFlag, TThostFtdcPriceType limitPrice, const std::map<std::string, int> &volumes, py::kwargs kwargs)
+{
+    CThostFtdcInputOrderField req;
+    FillInputOrder(req, instrumentId, direction, offsetFlag, limitPrice, 0, kwargs);
+
+    py::gil_scoped_release release;
+    return _router.Allocate(req, volumes);
+}
+
 #pragma endregion // Trader API
 
 
@@ -911,6 +1749,38 @@ void CtpClientWrap::OnTdError(const CThostFtdcRspInfoField *pRspInfo)
     );
 }
 
+void CtpClientWrap::OnSessionState(const std::string &session, SessionState state, int attempt)
+{
+    /* Acquire GIL before calling Python code */
+    py::gil_scoped_acquire acquire;
+
+    PYBIND11_OVERLOAD_PURE_NAME(
+        void,
+        CtpClient,
+        "on_session_state",
+        OnSessionState,
+        session,
+        state,
+        attempt
+    );
+}
+
+void CtpClientWrap::OnAccountStatus(const std::string &userId, AccountStatus status, const CThostFtdcRspInfoField *pRspInfo)
+{
+    /* Acquire GIL before calling Python code */
+    py::gil_scoped_acquire acquire;
+
+    PYBIND11_OVERLOAD_PURE_NAME(
+        void,
+        CtpClient,
+        "on_account_status",
+        OnAccountStatus,
+        userId,
+        status,
+        pRspInfo
+    );
+}
+
 void CtpClientWrap::OnRspQryOrder(std::shared_ptr<CThostFtdcOrderField> pOrder, const CThostFtdcRspInfoField *pRspInfo, bool bIsLast)
 {
     /* Acquire GIL before calling Python code */
@@ -1008,8 +1878,78 @@ void CtpClientWrap::OnRspQryDepthMarketData(const CThostFtdcDepthMarketDataField
     );
 }
 
+void CtpClientWrap::OnInstrumentsReady(size_t count)
+{
+    /* Acquire GIL before calling Python code */
+    py::gil_scoped_acquire acquire;
+
+    PYBIND11_OVERLOAD_PURE_NAME(
+        void,        /* Return type */
+        CtpClient,
+        "on_instruments_ready",
+        OnInstrumentsReady,
+        count
+    );
+}
+
 #pragma endregion // Trader SPI
 
+#pragma region Benchmarks
+
+// 合成的行情直接送入 MdSpi，由另一线程调用 poll 测量出队和回调
+std::map<std::string, double> CtpClient::BenchmarkMarketData(size_t instruments, size_t updates, double rate)
+{
+    DepthStream stream(instruments, 42);
+
+    std::unique_ptr<MdSpi> local;
+    MdSpi *spi = _mdSpi;
+    if (spi == nullptr) {
+        local.reset(new MdSpi(this));
+        spi = local.get();
+    }
+
+    Histogram histogram;
+    CThostFtdcDepthMarketDataField depth;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < updates; i++) {
+        if (rate > 0) {
+            std::this_thread::sleep_until(start + std::chrono::nanoseconds(static_cast<int64_t>(i * 1e9 / rate)));
+        }
+        stream.Next(depth);
+
+        int64_t t0 = LatencyStats::Now();
+        spi->OnRtnDepthMarketData(&depth);
+        histogram.Record(LatencyStats::Now() - t0);
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    auto result = histogram.GetSummary();
+    result["seconds"] = elapsed.count();
+    result["rate"] = elapsed.count() > 0 ? updates / elapsed.count() : 0.0;
+    return result;
+}
+
+// 只测量构造报单的开销，不发送
+std::map<std::string, double> CtpClient::BenchmarkOrderInsert(const std::string &instrumentId, size_t orders, py::kwargs kwargs)
+{
+    Histogram histogram;
+    CThostFtdcInputOrderField req;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < orders; i++) {
+        int64_t t0 = LatencyStats::Now();
+        FillInputOrder(req, instrumentId, i % 2 == 0 ? D_Buy : D_Sell, OF_Open, 3800.0, 1, kwargs);
+        histogram.Record(LatencyStats::Now() - t0);
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    auto result = histogram.GetSummary();
+    result["seconds"] = elapsed.count();
+    result["rate"] = elapsed.count() > 0 ? orders / elapsed.count() : 0.0;
+    return result;
+}
+
+#pragma endregion // Benchmarks
+
 void CtpClientWrap::OnIdle()
 {
     /* Acquire GIL before calling Python code */
@@ -16,18 +16,40 @@
 #pragma once
 #include <atomic>
 #include <chrono>
+#include <mutex>
 #include <thread>
+#include <future>
 #include <string>
 #include <vector>
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 #include "ThostFtdcUserApiStruct.h"
 #include "bar.h"
+#include "subscription.h"
+#include "catalog.h"
+#include "maincontract.h"
+#include "composite.h"
+#include "spread.h"
+#include "latency.h"
+#include "feed.h"
+#include "flowcontrol.h"
+#include "conflator.h"
+#include "pool.h"
+#include "ticks.h"
+#include "quote.h"
+#include "symbols.h"
+#include "router.h"
+#include "arbiter.h"
+#include "session.h"
+#include "indicators.h"
+#include "history.h"
+#include "loopback.h"
 #include "concurrentqueue.h"
 
 namespace py = pybind11;
 
 class MdSpi;
+class MdMirrorSpi;
 class TraderSpi;
 class CThostFtdcMdApi;
 class CThostFtdcTraderApi;
@@ -142,6 +164,19 @@ enum OrderActionStatus {
     OAS_Rejected = THOST_FTDC_OAS_Rejected
 };
 
+// 行情事件，只构造并投递掩码中的事件
+enum EventMask : uint32_t {
+    EM_MarketData = 1 << 0,
+    EM_Tick = 1 << 1,
+    EM_1Min = 1 << 2,
+    EM_1MinTick = 1 << 3,
+    EM_DepthTicks = 1 << 4,
+    EM_Quote = 1 << 5,
+    EM_All = EM_MarketData | EM_Tick | EM_1Min | EM_1MinTick | EM_DepthTicks | EM_Quote,
+    // Resolved at Init from the callbacks the Python subclass overrides.
+    EM_Auto = 1u << 31
+};
+
 #pragma endregion // Enums
 
 class CtpClient
@@ -152,6 +187,8 @@ class CtpClient
     CThostFtdcTraderApi *_tdApi = nullptr;
     std::string _flowPath;
     std::string _mdAddr;
+    std::vector<std::string> _redundantMdAddrs;
+    std::vector<MdMirrorSpi*> _mdMirrors;
     std::string _tdAddr;
     std::string _brokerId;
     std::string _userId;
@@ -160,7 +197,18 @@ class CtpClient
     std::string _authCode;
     std::string _userProductInfo;
     std::thread _thread;
+    std::promise<void> _exitPromise;
+    std::shared_future<void> _exitSignal;
+    std::atomic_bool _exited{false};
+    int _interrupts = 0;
+    std::chrono::steady_clock::time_point _idleTimer;
     size_t _idleDelay = 1000;
+    size_t _subscribeChunkSize = 500;
+    std::string _catalogPath;
+    std::atomic<uint32_t> _eventMask{EM_Auto};
+    bool _autoSession = false;
+    SessionMachine _mdSession;
+    SessionMachine _tdSession;
 
     enum class RequestType {
         QueryOrder,
@@ -168,7 +216,9 @@ class CtpClient
         QueryTradingAccount,
         QueryInvestorPosition,
         QueryInvestorPositionDetail,
-        QueryMarketData
+        QueryMarketData,
+        QueryProduct,
+        QueryInstrument
     };
 
     enum class ResponseType : uint32_t {
@@ -182,6 +232,8 @@ class CtpClient
         OnTick,
         On1Min,
         On1MinTick,
+        OnDepthTicks,
+        OnMarketDataRecovery,
         OnMdError,
 
         OnTdFrontConnected,
@@ -197,12 +249,18 @@ class CtpClient
         OnRtnOrder,
         OnRtnTrade,
         OnTdError,
+        OnAccountStatus,
         OnRspQryOrder,
         OnRspQryTrade,
         OnRspQryTradingAccount,
         OnRspQryInvestorPosition,
         OnRspQryInvestorPositionDetail,
-        OnRspQryDepthMarketData
+        OnRspQryDepthMarketData,
+        OnRspQryProduct,
+        OnRspQryInstrument,
+        OnInstrumentsReady,
+        OnMainContractRoll,
+        OnSpreadQuote
     };
 
     struct Request {
@@ -214,6 +272,8 @@ class CtpClient
             CThostFtdcQryInvestorPositionField QryInvestorPosition;
             CThostFtdcQryInvestorPositionDetailField QryInvestorPositionDetail;
             CThostFtdcQryDepthMarketDataField QryDepthMarketData;
+            CThostFtdcQryProductField QryProduct;
+            CThostFtdcQryInstrumentField QryInstrument;
         };
         int nRequestID;
     };
@@ -226,9 +286,10 @@ class CtpClient
             CThostFtdcRspUserLoginField RspUserLogin;
             CThostFtdcUserLogoutField UserLogout;
             CThostFtdcSpecificInstrumentField SpecificInstrument;
-            CThostFtdcDepthMarketDataField DepthMarketData;
+            MarketDataEvent DepthMarketData;
             M1Bar m1;
             TickBar tick;
+            DepthTicks depthTicks;
             CThostFtdcSettlementInfoConfirmField SettlementInfoConfirm;
             CThostFtdcInputOrderField InputOrder;
             CThostFtdcInputOrderActionField InputOrderAction;
@@ -239,6 +300,12 @@ class CtpClient
             CThostFtdcInvestorPositionField InvestorPosition;
             CThostFtdcSettlementInfoField SettlementInfo;
             CThostFtdcInvestorPositionDetailField InvestorPositionDetail;
+            CThostFtdcProductField Product;
+            CThostFtdcInstrumentField Instrument;
+            MainContractRoll roll;
+            SpreadQuote spread;
+            AccountEvent account;
+            MarketDataRecovery recovery;
         };
         CThostFtdcRspInfoField RspInfo;
         int nRequestID;
@@ -246,6 +313,10 @@ class CtpClient
         bool bIsLast;
         bool bRspIsNone;
         bool bRspInfoIsNone;
+        int64_t tsEntry;
+        int64_t tsEnqueue;
+        FlowControl::Slot *slot;
+        uint64_t seq;
 
         inline void Init(ResponseType type, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast) {
             memset(this, 0, sizeof *this);
@@ -267,7 +338,29 @@ class CtpClient
 
     std::atomic_bool _requestResponsed;
     moodycamel::ConcurrentQueue<CtpClient::Request>  _requestQueue;
-    moodycamel::ConcurrentQueue<CtpClient::Response> _responseQueue;
+    // 成交/报单事件优先于行情控制事件，再优先于行情
+    enum Lane {
+        TraderLane,
+        ControlLane,
+        MarketDataLane,
+        LaneCount
+    };
+    static Lane GetLane(ResponseType type);
+    moodycamel::ConcurrentQueue<CtpClient::Response> _responseQueues[LaneCount];
+
+    // 紧凑行情不经过 Response，队列不支持 64 字节对齐的元素，按字节拷贝
+    struct QuoteEvent {
+        unsigned char quote[sizeof(Quote)];
+        int64_t tsEntry;
+        int64_t tsEnqueue;
+        FlowControl::Slot *slot;
+        uint64_t seq;
+    };
+    moodycamel::ConcurrentQueue<QuoteEvent> _quoteQueue;
+    QuoteBook _quoteBook;
+    void EnqueueQuote(const Quote &quote, FlowControl::Slot *slot, uint64_t seq);
+    void DispatchQuote(QuoteEvent &e);
+    bool DispatchNext();
     void ProcessRequest(CtpClient::Request &r);
     void ProcessResponse(CtpClient::Response &r);
 
@@ -283,12 +376,62 @@ class CtpClient
 
         Enqueue(r);
     }
+    template<class T>
+    void EnqueueMarketData(ResponseType type, T *pRsp, FlowControl::Slot *slot, uint64_t seq) {
+        Response r;
+        r.Init(type, nullptr, 0, true);
+        memcpy(&r.base, pRsp, sizeof *pRsp);
+        r.slot = slot;
+        r.seq = seq;
+        Enqueue(r);
+    }
+    void EnqueueMarketData(const CThostFtdcDepthMarketDataField *pDepthMarketData, uint32_t symbolId, FlowControl::Slot *slot, uint64_t seq);
     void Enqueue(ResponseType type, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast);
-    void Enqueue(const CtpClient::Response &r);
-
-    void _assertRequest(int rc, const char *request);
+    void Enqueue(CtpClient::Response &r);
+    void Dispatch(CtpClient::Response &r);
+    LatencyStats _latency;
+    FeedMonitor _feed;
+    FlowControl _flow;
+    Conflator _conflator;
+    TickScale _tickScale;
+    bool DispatchConflated();
+    void ProcessConflated(const CThostFtdcDepthMarketDataField &depth, uint32_t symbolId, const TickBar &tick, const M1Bar &m1);
+    void EnqueueRequest(CtpClient::Request &r);
+
+    std::atomic_bool _mdLoggedIn{false};
+    // 断线恢复时查询全市场快照所用的请求编号
+    static constexpr int RECOVERY_REQUEST_ID = -1;
+    SubscriptionSet _subscriptions;
+    InstrumentCatalog _catalog;
+    MainContractResolver _mainContracts;
+    CompositeEngine _composites;
+    SpreadMonitor _spreads;
+    OrderRouter _router;
+    FrontArbiter _arbiter;
+    IndicatorEngine _indicators;
+    HistoryStore _history;
+    LoopbackFront _loopback;
+    // 设置后代替 on_tick 在分发线程上调用，不经过 Python；在 Init 中设置
+    std::function<void(const TickBar&)> _nativeOnTick;
+    std::mutex _subscribeMutex;
+    std::vector<char*> _instrumentIdBuffer;
+    void SyncSubscriptions();
+    void SendSubscriptions(const std::vector<std::string> &instrumentIds, bool subscribe);
+
+    bool _assertRequest(int rc, const char *request);
+    // 会话状态机，只在分发线程中调用
+    void SetSession(bool trader, SessionState state);
+    void StepSession(bool trader, SessionState step);
+    void SendSessionStep(bool trader);
+    void CheckSessions();
+    // The overload without kwargs does not touch Python objects and may run without the GIL.
+    void FillInputOrder(CThostFtdcInputOrderField &req, const std::string &instrumentId, Direction direction, OffsetFlag offsetFlag, TThostFtdcPriceType limitPrice, TThostFtdcVolumeType volume);
+    void FillInputOrder(CThostFtdcInputOrderField &req, const std::string &instrumentId, Direction direction, OffsetFlag offsetFlag, TThostFtdcPriceType limitPrice, TThostFtdcVolumeType volume, py::kwargs kwargs);
+    void InsertInputOrder(CThostFtdcInputOrderField &req);
     friend class MdSpi;
+    friend class MdMirrorSpi;
     friend class TraderSpi;
+    friend class AccountSession;
 protected:
     std::vector<std::string> _instrumentIds;
 
@@ -303,6 +446,12 @@ public:
     void Init();
     void Join();
     void Exit();
+    // One dispatch cycle of `Join` for an external dispatcher; returns the number of responses dispatched.
+    // At most `maxEvents` responses are dispatched when it is not 0, so one busy client cannot starve the others.
+    size_t Poll(size_t maxEvents = 0);
+    // Waits for the request thread after exit.
+    void Shutdown();
+    inline bool IsExited() const { return _exited.load(std::memory_order_acquire); }
 
 public:
     // Getter/Setter
@@ -310,6 +459,10 @@ public:
     inline void SetFlowPath(std::string flowPath) { _flowPath = flowPath; }
     inline std::string GetMdAddr() const { return _mdAddr; }
     inline void SetMdAddr(std::string addr) { _mdAddr = addr; }
+    inline const std::vector<std::string>& GetRedundantMdAddrs() const { return _redundantMdAddrs; }
+    inline void SetRedundantMdAddrs(const std::vector<std::string> &addrs) { _redundantMdAddrs = addrs; }
+    inline std::map<std::string, std::map<std::string, double>> GetMdFrontStats() const { return _arbiter.GetStats(); }
+    inline void ResetMdFrontStats() { _arbiter.Reset(); }
     inline std::string GetTdAddr() const { return _tdAddr; }
     inline void SetTdAddr(std::string addr) { _tdAddr = addr; }
     inline std::string GetBrokerId() const { return _brokerId; }
@@ -333,6 +486,63 @@ public:
     }
     inline size_t GetIdleDelay() const { return _idleDelay; }
     inline void SetIdleDelay(size_t delay) { _idleDelay = delay; }
+    inline size_t GetSubscribeChunkSize() const { return _subscribeChunkSize; }
+    inline void SetSubscribeChunkSize(size_t size) { _subscribeChunkSize = size > 0 ? size : 1; }
+    inline std::string GetCatalogPath() const { return _catalogPath; }
+    inline void SetCatalogPath(std::string path) { _catalogPath = path; }
+    inline bool IsLatencyEnabled() const { return _latency.IsEnabled(); }
+    inline void SetLatencyEnabled(bool enabled) { _latency.SetEnabled(enabled); }
+    inline std::map<std::string, std::map<std::string, double>> GetLatencyStats() const { return _latency.GetStats(); }
+    inline void ResetLatencyStats() { _latency.Reset(); }
+    inline bool IsFeedMonitorEnabled() const { return _feed.IsEnabled(); }
+    inline void SetFeedMonitorEnabled(bool enabled) { _feed.SetEnabled(enabled); }
+    inline int GetFeedGapThreshold() const { return _feed.GetGapThreshold(); }
+    inline void SetFeedGapThreshold(int ms) { _feed.SetGapThreshold(ms); }
+    inline int GetFeedStallTimeout() const { return _feed.GetStallTimeout(); }
+    inline void SetFeedStallTimeout(int ms) { _feed.SetStallTimeout(ms); }
+    inline int GetFeedUtcOffset() const { return _feed.GetUtcOffset(); }
+    inline void SetFeedUtcOffset(int minutes) { _feed.SetUtcOffset(minutes); }
+    inline std::map<std::string, std::map<std::string, double>> GetFeedStats() const { return _feed.GetExchangeStats(); }
+    inline std::map<std::string, double> GetFeedInstrumentStats(const std::string &instrumentId) const { return _feed.GetInstrumentStats(instrumentId); }
+    inline std::vector<std::string> GetStalledInstruments() const { return _feed.GetStalledInstruments(); }
+    inline void ResetFeedStats() { _feed.Reset(); }
+    inline size_t GetQueueLimit() const { return _flow.GetLimit(); }
+    inline void SetQueueLimit(size_t limit) { _flow.SetLimit(limit); }
+    inline OverflowPolicy GetOverflowPolicy() const { return _flow.GetPolicy(); }
+    inline void SetOverflowPolicy(OverflowPolicy policy) { _flow.SetPolicy(policy); }
+    inline uint32_t GetEventMask() const { return _eventMask.load(std::memory_order_relaxed); }
+    inline void SetEventMask(uint32_t mask) { _eventMask.store(mask, std::memory_order_relaxed); }
+    inline bool IsFixedPointPrices() const { return _tickScale.IsEnabled(); }
+    inline void SetFixedPointPrices(bool enabled) { _tickScale.SetEnabled(enabled); }
+    inline double GetPriceTick(const std::string &instrumentId) { return _tickScale.Get(instrumentId.c_str()); }
+    inline void SetPriceTick(const std::string &instrumentId, double tick) { _tickScale.Set(instrumentId, tick); }
+    inline bool IsAutoSession() const { return _autoSession; }
+    inline void SetAutoSession(bool enabled) { _autoSession = enabled; }
+    inline SessionState GetMdSessionState() const { return _mdSession.GetState(); }
+    inline SessionState GetTdSessionState() const { return _tdSession.GetState(); }
+    inline int GetSessionTimeout() const { return _tdSession.GetTimeout(); }
+    inline void SetSessionTimeout(int ms) { _mdSession.SetTimeout(ms); _tdSession.SetTimeout(ms); }
+    inline int GetSessionRetryDelay() const { return _tdSession.GetRetryDelay(); }
+    inline void SetSessionRetryDelay(int ms) { _mdSession.SetRetryDelay(ms); _tdSession.SetRetryDelay(ms); }
+    inline int GetSessionAttempts() const { return _tdSession.GetMaxAttempts(); }
+    inline void SetSessionAttempts(int n) { _mdSession.SetMaxAttempts(n); _tdSession.SetMaxAttempts(n); }
+    inline bool IsConflating() const { return _conflator.IsEnabled(); }
+    inline void SetConflating(bool conflate) { _conflator.SetEnabled(conflate); }
+    std::map<std::string, int64_t> GetQueueStats() const;
+    void ResetQueueStats();
+
+    // Benchmarks, run without a front. Per-call nanoseconds plus "seconds" and "rate".
+    std::map<std::string, double> BenchmarkMarketData(size_t instruments, size_t updates, double rate);
+    std::map<std::string, double> BenchmarkOrderInsert(const std::string &instrumentId, size_t orders, py::kwargs kwargs);
+
+    // Loopback front, see LoopbackFront
+    inline void StartLoopback(size_t instruments, size_t updates, double rate) { _loopback.Start(instruments, updates, rate); }
+    inline void StopLoopback() { _loopback.Stop(); }
+    inline bool IsLoopbackRunning() const { return _loopback.IsRunning(); }
+    inline bool IsLoopbackNativeStrategy() const { return _loopback.IsNativeStrategy(); }
+    inline void SetLoopbackNativeStrategy(bool enabled) { _loopback.SetNativeStrategy(enabled); }
+    inline std::map<std::string, double> GetLoopbackStats() const { return _loopback.GetStats(); }
+    inline void ResetLoopbackStats() { _loopback.Reset(); }
 
     static py::tuple GetApiVersion();
 
@@ -341,6 +551,44 @@ public:
     void MdLogin();
     void SubscribeMarketData(const std::vector<std::string> &instrumentIds);
     void UnsubscribeMarketData(const std::vector<std::string> &instrumentIds);
+    void SetSubscriptions(const std::vector<std::string> &instrumentIds);
+    inline std::vector<std::string> GetSubscribedInstrumentIds() const { return _subscriptions.Get(SubscriptionSet::State::Active); }
+    inline std::vector<std::string> GetPendingInstrumentIds() const { return _subscriptions.Get(SubscriptionSet::State::Pending); }
+
+    // Main contract
+    void AddMainContract(const std::string &productId, const std::string &instrumentId, bool adjust, double threshold, const std::string &mainId);
+    inline std::string GetMainContract(const std::string &productId) const { return _mainContracts.GetLeader(productId); }
+    inline std::vector<std::tuple<std::string, double, int>> GetMainContractRanking(const std::string &productId) const { return _mainContracts.GetRanking(productId); }
+
+    // Composite instruments
+    void AddComposite(const std::string &instrumentId, const std::vector<std::pair<std::string, double>> &legs, bool weightedByOpenInterest);
+    inline void RemoveComposite(const std::string &instrumentId) { _composites.Remove(instrumentId); }
+    inline std::vector<std::string> GetCompositeIds() const { return _composites.GetInstrumentIds(); }
+    inline std::vector<std::pair<std::string, double>> GetCompositeLegs(const std::string &instrumentId) const { return _composites.GetLegs(instrumentId); }
+
+    // Spreads
+    void AddSpread(const std::string &spreadId, const std::vector<std::pair<std::string, double>> &legs, int maxSkew);
+    inline void RemoveSpread(const std::string &spreadId) { _spreads.Remove(spreadId); }
+    py::object GetSpreadQuote(const std::string &spreadId) const;
+    inline std::vector<SpreadQuote> GetSpreadQuotes() const { return _spreads.GetQuotes(); }
+
+    // Indicators
+    void AddIndicator(const std::string &instrumentId, const std::string &name, IndicatorType type, int period, double k);
+    inline void RemoveIndicators(const std::string &instrumentId) { _indicators.Remove(instrumentId); }
+    inline std::map<std::string, double> GetIndicators(const std::string &instrumentId) const { return _indicators.GetValues(instrumentId); }
+    inline std::vector<std::string> GetIndicatorNames(const std::string &instrumentId) const { return _indicators.GetNames(instrumentId); }
+    inline const double* GetIndicatorBuffer(const std::string &instrumentId, size_t &width) const { return _indicators.GetBuffer(instrumentId, width); }
+
+    // History
+    void TrackHistory(const std::string &instrumentId, size_t ticks, size_t bars);
+    inline const TickRecord* GetTickHistory(const std::string &instrumentId, size_t &n) const { return _history.GetTicks(instrumentId, n); }
+    inline const BarRecord* GetBarHistory(const std::string &instrumentId, size_t &n) const { return _history.GetBars(instrumentId, n); }
+    // Replays the last `bars` archived bars into the history and indicators, before `Init`.
+    std::map<std::string, size_t> WarmUp(const std::string &dir, const std::vector<std::string> &instrumentIds, size_t bars);
+    size_t SaveHistory(const std::string &dir) const;
+
+    // Compact quotes
+    py::object GetQuote(const std::string &instrumentId) const;
 
 public:
     // MdSpi
@@ -350,12 +598,18 @@ public:
 	virtual void OnMdUserLogout(const CThostFtdcUserLogoutField *pUserLogout, const CThostFtdcRspInfoField *pRspInfo) = 0;
     virtual void OnSubscribeMarketData(const CThostFtdcSpecificInstrumentField *pSpecificInstrument, const CThostFtdcRspInfoField *pRspInfo, bool bIsLast) = 0;
     virtual void OnUnsubscribeMarketData(const CThostFtdcSpecificInstrumentField *pSpecificInstrument, const CThostFtdcRspInfoField *pRspInfo, bool bIsLast) = 0;
-    virtual void OnRtnMarketData(std::shared_ptr<CThostFtdcDepthMarketDataField> pDepthMarketData) = 0;
+    virtual void OnRtnMarketData(std::shared_ptr<MarketDataEvent> pDepthMarketData) = 0;
     virtual void OnTick(std::shared_ptr<TickBar> pBar) = 0;
     virtual void On1Min(std::shared_ptr<M1Bar> pBar) = 0;
     virtual void On1MinTick(std::shared_ptr<M1Bar> pBar) = 0;
+    virtual void OnDepthTicks(const DepthTicks *pDepthTicks) = 0;
+    virtual void OnQuote(const Quote *pQuote) = 0;
+    virtual void OnMainContractRoll(const MainContractRoll *pRoll) = 0;
+    virtual void OnSpreadQuote(const SpreadQuote *pQuote) = 0;
+    virtual void OnMarketDataRecovery(const MarketDataRecovery *pRecovery) = 0;
 	virtual void OnMdError(const CThostFtdcRspInfoField *pRspInfo) = 0;
 
+    virtual void OnSessionState(const std::string &session, SessionState state, int attempt) = 0;
     virtual void OnException(const std::string &message) = 0;
     virtual void OnIdle() = 0;
 
@@ -368,6 +622,13 @@ public:
     void QueryInvestorPositionDetail();
     void QueryMarketData(const std::string &instrumentId, int requestId);
 
+    // Instrument catalog
+    void LoadInstruments();
+    py::object GetInstrument(const std::string &instrumentId) const;
+    py::object GetProduct(const std::string &productId) const;
+    inline std::vector<std::string> ListInstruments(const std::string &productId) const { return _catalog.GetInstrumentIds(productId); }
+    inline std::vector<std::string> ListProducts() const { return _catalog.GetProductIds(); }
+
     void TdAuthenticate();
     void TdLogin();
     void ConfirmSettlementInfo();
@@ -385,6 +646,18 @@ public:
         int requestId);
     void DeleteOrder(std::shared_ptr<CThostFtdcOrderField> pOrder, int requestId);
 
+    // Order router
+    void AddAccount(const std::string &userId, const std::string &password, const std::string &brokerId, const std::string &appId, const std::string &authCode, const std::string &tdAddr);
+    inline std::vector<std::string> GetAccounts() const { return _router.GetUserIds(); }
+    inline AccountStatus GetAccountStatus(const std::string &userId) const { return _router.GetStatus(userId); }
+    std::map<std::string, std::string> Allocate(
+        const std::string &instrumentId,
+        Direction direction,
+        OffsetFlag offsetFlag,
+        TThostFtdcPriceType limitPrice,
+        const std::map<std::string, int> &volumes,
+        py::kwargs kwargs);
+
 public:
     // TraderSpi
 	virtual void OnTdFrontConnected() = 0;
@@ -398,6 +671,7 @@ public:
 	virtual void OnRtnOrder(std::shared_ptr<CThostFtdcOrderField> pOrder) = 0;
 	virtual void OnRtnTrade(const CThostFtdcTradeField *pTrade) = 0;
 	virtual void OnTdError(const CThostFtdcRspInfoField *pRspInfo) = 0;
+    virtual void OnAccountStatus(const std::string &userId, AccountStatus status, const CThostFtdcRspInfoField *pRspInfo) = 0;
 
     virtual void OnRspQryOrder(std::shared_ptr<CThostFtdcOrderField> pOrder, const CThostFtdcRspInfoField *pRspInfo, bool bIsLast) = 0;
     virtual void OnRspQryTrade(const CThostFtdcTradeField *pTrade, const CThostFtdcRspInfoField *pRspInfo, bool bIsLast) = 0;
@@ -405,6 +679,7 @@ public:
     virtual void OnRspQryInvestorPosition(const CThostFtdcInvestorPositionField *pInvestorPosition, const CThostFtdcRspInfoField *pRspInfo, bool bIsLast) = 0;
     virtual void OnRspQryInvestorPositionDetail(const CThostFtdcInvestorPositionDetailField *pInvestorPositionDetail, const CThostFtdcRspInfoField *pRspInfo, bool bIsLast) = 0;
     virtual void OnRspQryDepthMarketData(const CThostFtdcDepthMarketDataField *pDepthMarketData, const CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast) = 0;
+    virtual void OnInstrumentsReady(size_t count) = 0;
 };
 
 template<>
@@ -423,10 +698,15 @@ struct CtpClientWrap : CtpClient
 	void OnMdUserLogout(const CThostFtdcUserLogoutField *pUserLogout, const CThostFtdcRspInfoField *pRspInfo) override;
     void OnSubscribeMarketData(const CThostFtdcSpecificInstrumentField *pSpecificInstrument, const CThostFtdcRspInfoField *pRspInfo, bool bIsLast) override;
     void OnUnsubscribeMarketData(const CThostFtdcSpecificInstrumentField *pSpecificInstrument, const CThostFtdcRspInfoField *pRspInfo, bool bIsLast) override;
-    void OnRtnMarketData(std::shared_ptr<CThostFtdcDepthMarketDataField> pDepthMarketData) override;
+    void OnRtnMarketData(std::shared_ptr<MarketDataEvent> pDepthMarketData) override;
     void OnTick(std::shared_ptr<TickBar> pBar) override;
     void On1Min(std::shared_ptr<M1Bar> pBar) override;
     void On1MinTick(std::shared_ptr<M1Bar> pBar) override;
+    void OnDepthTicks(const DepthTicks *pDepthTicks) override;
+    void OnQuote(const Quote *pQuote) override;
+    void OnMainContractRoll(const MainContractRoll *pRoll) override;
+    void OnSpreadQuote(const SpreadQuote *pQuote) override;
+    void OnMarketDataRecovery(const MarketDataRecovery *pRecovery) override;
 	void OnMdError(const CThostFtdcRspInfoField *pRspInfo) override;
 
 	void OnTdFrontConnected() override;
@@ -440,6 +720,7 @@ struct CtpClientWrap : CtpClient
 	void OnRtnOrder(std::shared_ptr<CThostFtdcOrderField> pOrder) override;
 	void OnRtnTrade(const CThostFtdcTradeField *pTrade) override;
 	void OnTdError(const CThostFtdcRspInfoField *pRspInfo) override;
+    void OnAccountStatus(const std::string &userId, AccountStatus status, const CThostFtdcRspInfoField *pRspInfo) override;
 
     void OnRspQryOrder(std::shared_ptr<CThostFtdcOrderField> pOrder, const CThostFtdcRspInfoField *pRspInfo, bool bIsLast) override;
     void OnRspQryTrade(const CThostFtdcTradeField *pTrade, const CThostFtdcRspInfoField *pRspInfo, bool bIsLast) override;
@@ -447,7 +728,9 @@ struct CtpClientWrap : CtpClient
     void OnRspQryInvestorPosition(const CThostFtdcInvestorPositionField *pInvestorPosition, const CThostFtdcRspInfoField *pRspInfo, bool bIsLast) override;
     void OnRspQryInvestorPositionDetail(const CThostFtdcInvestorPositionDetailField *pInvestorPositionDetail, const CThostFtdcRspInfoField *pRspInfo, bool bIsLast) override;
     void OnRspQryDepthMarketData(const CThostFtdcDepthMarketDataField *pDepthMarketData, const CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast) override;
+    void OnInstrumentsReady(size_t count) override;
 
     void OnIdle() override;
+    void OnSessionState(const std::string &session, SessionState state, int attempt) override;
     void OnException(const std::string &message) override;
 };
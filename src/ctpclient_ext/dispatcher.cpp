@@ -0,0 +1,111 @@
+/*
+ * Copyright 2019 Holmes Conan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include "dispatcher.h"
+#include "ctpclient.h"
+
+using namespace std::chrono_literals;
+
+void Dispatcher::Add(CtpClient *client)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (std::find(_clients.begin(), _clients.end(), client) == _clients.end()) {
+        _clients.push_back(client);
+    }
+}
+
+void Dispatcher::Remove(CtpClient *client)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _clients.erase(std::remove(_clients.begin(), _clients.end(), client), _clients.end());
+}
+
+size_t Dispatcher::GetCount()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _clients.size();
+}
+
+void Dispatcher::Run(size_t threads)
+{
+    std::vector<CtpClient*> clients;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        clients = _clients;
+    }
+    _stopped.store(false, std::memory_order_release);
+    if (clients.empty()) return;
+
+    threads = std::max<size_t>(1, std::min(threads, clients.size()));
+    std::vector<std::vector<CtpClient*>> partitions(threads);
+    for (size_t i = 0; i < clients.size(); i++) {
+        partitions[i % threads].push_back(clients[i]);
+    }
+
+    _error = nullptr;
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < threads; i++) {
+        workers.emplace_back(&Dispatcher::Loop, this, partitions[i]);
+    }
+    Loop(partitions[0]);
+    for (auto &worker : workers) {
+        worker.join();
+    }
+
+    // 回调抛出的第一个异常在调用线程重新抛出
+    if (_error) {
+        std::rethrow_exception(_error);
+    }
+}
+
+void Dispatcher::Loop(std::vector<CtpClient*> clients)
+{
+    try {
+        Poll(clients);
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (!_error) {
+            _error = std::current_exception();
+        }
+        Stop();
+    }
+
+    for (auto client : clients) {
+        if (client->IsExited()) {
+            client->Shutdown();
+        }
+    }
+}
+
+void Dispatcher::Poll(const std::vector<CtpClient*> &clients)
+{
+    while (!_stopped.load(std::memory_order_acquire)) {
+        size_t dispatched = 0;
+        bool alive = false;
+        size_t maxEvents = GetMaxEvents();
+        for (auto client : clients) {
+            dispatched += client->Poll(maxEvents);
+            alive = alive || !client->IsExited();
+        }
+        if (!alive) break;
+        // 空闲时让出 CPU，有事件时立即进入下一轮
+        if (dispatched == 0) {
+            std::this_thread::sleep_for(1ms);
+        }
+    }
+}
@@ -0,0 +1,59 @@
+/*
+ * Copyright 2019 Holmes Conan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <exception>
+
+class CtpClient;
+
+/*
+ * Runs the dispatch loop of many clients (accounts, fronts) on one thread or
+ * a small pool instead of one `join` per client.
+ *
+ * Each client is always polled by the same thread, so its callbacks stay in
+ * order. Callbacks acquire the GIL themselves; with more than one thread only
+ * the native part of dispatching runs in parallel. The clients of a thread
+ * take turns, each dispatching at most `maxEvents` responses per turn.
+ */
+class Dispatcher
+{
+    std::mutex _mutex;
+    std::vector<CtpClient*> _clients;
+    std::atomic_bool _stopped{false};
+    std::atomic<size_t> _maxEvents{256};
+    std::exception_ptr _error;
+
+    void Loop(std::vector<CtpClient*> clients);
+    void Poll(const std::vector<CtpClient*> &clients);
+
+public:
+    Dispatcher() = default;
+    Dispatcher(const Dispatcher&) = delete;
+    Dispatcher& operator=(const Dispatcher&) = delete;
+
+    // Clients added while running are picked up by the next `Run`.
+    void Add(CtpClient *client);
+    void Remove(CtpClient *client);
+    size_t GetCount();
+    inline size_t GetMaxEvents() const { return _maxEvents.load(std::memory_order_relaxed); }
+    inline void SetMaxEvents(size_t maxEvents) { _maxEvents.store(maxEvents, std::memory_order_relaxed); }
+
+    // Returns when every client has exited or `Stop` is called.
+    void Run(size_t threads);
+    inline void Stop() { _stopped.store(true, std::memory_order_release); }
+};
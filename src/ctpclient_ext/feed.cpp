@@ -0,0 +1,214 @@
+/*
+ * Copyright 2019 Holmes Conan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <chrono>
+#include "feed.h"
+#include "bar.h"
+
+namespace {
+
+const int MILLISECONDS_PER_DAY = 24 * 60 * 60 * 1000;
+// 行情延迟以毫秒计，超过 2^16 毫秒的都算作一个桶
+const int FEED_LATENCY_BITS = 16;
+
+const int MILLISECONDS_PER_MINUTE = 60 * 1000;
+
+constexpr int HourMinute(int h, int m)
+{
+    return (h * 60 + m) * MILLISECONDS_PER_MINUTE;
+}
+
+// 交易所休市时段（交易所时间），跨过整段休市的两笔行情之间不算缺口
+const struct {
+    int begin;
+    int end;
+} SESSION_BREAKS[] = {
+    {HourMinute(2, 30), HourMinute(9, 0)},      // 夜盘收盘（最晚 02:30）至日盘开盘，含周末
+    {HourMinute(10, 15), HourMinute(10, 30)},   // 商品期货上午小节休息
+    {HourMinute(11, 30), HourMinute(13, 0)},    // 午休
+    {HourMinute(15, 15), HourMinute(21, 0)}     // 日盘收盘（最晚 15:15）至夜盘开盘
+};
+
+// 收盘后和开盘前的最后/第一笔行情可能与休市边界相差几秒
+const int SESSION_BREAK_TOLERANCE = MILLISECONDS_PER_MINUTE;
+
+// 比任一休市时段都短的倒退才算乱序，更长的是跨过了休市
+const int MAX_OUT_OF_ORDER = HourMinute(0, 15);
+
+// 折算到 [-12h, 12h)
+inline int Wrap(int64_t ms)
+{
+    ms %= MILLISECONDS_PER_DAY;
+    if (ms >= MILLISECONDS_PER_DAY / 2) ms -= MILLISECONDS_PER_DAY;
+    if (ms < -MILLISECONDS_PER_DAY / 2) ms += MILLISECONDS_PER_DAY;
+    return int(ms);
+}
+
+// 折算到 [0, 24h)
+inline int Forward(int64_t ms)
+{
+    ms %= MILLISECONDS_PER_DAY;
+    return int(ms < 0 ? ms + MILLISECONDS_PER_DAY : ms);
+}
+
+// Whether the `elapsed` ms from `last` on cover a whole session break.
+bool SpansSessionBreak(int last, int elapsed)
+{
+    for (auto &b : SESSION_BREAKS) {
+        int begin = Forward(b.begin - last + SESSION_BREAK_TOLERANCE) - SESSION_BREAK_TOLERANCE;
+        int end = begin + Forward(b.end - b.begin);
+        if (end <= elapsed + SESSION_BREAK_TOLERANCE) return true;
+    }
+    return false;
+}
+
+inline int64_t SteadyMilliseconds()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+}
+
+FeedMonitor::Stats::Stats() : latency(FEED_LATENCY_BITS)
+{
+    //
+}
+
+FeedMonitor::Stats& FeedMonitor::Find(const CThostFtdcDepthMarketDataField *pDepthMarketData)
+{
+    auto &stats = _instruments[pDepthMarketData->InstrumentID];
+    if (stats) return *stats;
+
+    stats.reset(new Stats());
+    // 部分柜台行情中的 ExchangeID 为空
+    std::string exchangeId(pDepthMarketData->ExchangeID);
+    if (exchangeId.empty() && _exchangeOf) {
+        exchangeId = _exchangeOf(pDepthMarketData->InstrumentID);
+    }
+
+    auto &exchange = _exchanges[exchangeId];
+    if (!exchange) {
+        exchange.reset(new Stats());
+        exchange->exchangeId = exchangeId;
+    }
+    stats->exchangeId = exchangeId;
+    stats->exchange = exchange.get();
+    return *stats;
+}
+
+void FeedMonitor::Update(const CThostFtdcDepthMarketDataField *pDepthMarketData)
+{
+    if (!IsEnabled()) return;
+
+    auto wall = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    auto arrival = SteadyMilliseconds();
+    int local = int((wall + _utcOffset.load(std::memory_order_relaxed)) % MILLISECONDS_PER_DAY);
+    int time = ParseUpdateTime(pDepthMarketData->UpdateTime, pDepthMarketData->UpdateMillisec);
+    int latency = Wrap(local - time);
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto &stats = Find(pDepthMarketData);
+    if (stats.lastTime >= 0) {
+        int back = Forward(stats.lastTime - time);
+        int gap = Forward(time - stats.lastTime);
+        if (back > 0 && back < MAX_OUT_OF_ORDER) {
+            stats.outOfOrder++;
+        } else if (gap > _gapThreshold && !SpansSessionBreak(stats.lastTime, gap)) {
+            stats.gaps++;
+            if (gap > stats.maxGap) stats.maxGap = gap;
+        }
+    }
+    stats.lastTime = time;
+
+    for (auto s : {&stats, stats.exchange}) {
+        s->latency.Record(latency);
+        s->lastLatency = latency;
+        if (latency < s->minLatency) s->minLatency = latency;
+        s->lastArrival = arrival;
+    }
+}
+
+void FeedMonitor::Reset()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _instruments.clear();
+    _exchanges.clear();
+}
+
+std::map<std::string, double> FeedMonitor::Summary(const Stats &stats, int64_t now)
+{
+    auto summary = stats.latency.GetSummary();
+    summary["last"] = stats.lastLatency;
+    summary["skew"] = stats.minLatency == INT32_MAX ? 0 : stats.minLatency;
+    summary["age"] = double(now - stats.lastArrival);
+    return summary;
+}
+
+bool FeedMonitor::IsStalled(const Stats &stats, int64_t now) const
+{
+    return now - stats.lastArrival > _stallTimeout
+        && stats.exchange != nullptr
+        && now - stats.exchange->lastArrival <= _stallTimeout;
+}
+
+std::map<std::string, std::map<std::string, double>> FeedMonitor::GetExchangeStats() const
+{
+    auto now = SteadyMilliseconds();
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::map<std::string, std::map<std::string, double>> result;
+    for (auto &kv : _exchanges) {
+        result[kv.first] = Summary(*kv.second, now);
+        result[kv.first]["stalled"] = 0;
+        result[kv.first]["gaps"] = 0;
+    }
+    for (auto &kv : _instruments) {
+        auto &stats = *kv.second;
+        auto &summary = result[stats.exchangeId];
+        summary["gaps"] += double(stats.gaps);
+        if (IsStalled(stats, now)) {
+            summary["stalled"] += 1;
+        }
+    }
+    return result;
+}
+
+std::map<std::string, double> FeedMonitor::GetInstrumentStats(const std::string &instrumentId) const
+{
+    auto now = SteadyMilliseconds();
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto iter = _instruments.find(instrumentId);
+    if (iter == _instruments.end()) return {};
+
+    auto &stats = *iter->second;
+    auto summary = Summary(stats, now);
+    summary["gaps"] = double(stats.gaps);
+    summary["max_gap"] = stats.maxGap;
+    summary["out_of_order"] = double(stats.outOfOrder);
+    summary["stalled"] = IsStalled(stats, now) ? 1 : 0;
+    return summary;
+}
+
+std::vector<std::string> FeedMonitor::GetStalledInstruments() const
+{
+    auto now = SteadyMilliseconds();
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::vector<std::string> v;
+    for (auto &kv : _instruments) {
+        if (IsStalled(*kv.second, now)) {
+            v.push_back(kv.first);
+        }
+    }
+    return v;
+}
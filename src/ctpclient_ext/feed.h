@@ -0,0 +1,99 @@
+/*
+ * Copyright 2019 Holmes Conan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include "ThostFtdcUserApiStruct.h"
+#include "latency.h"
+
+/*
+ * Exchange-to-client latency of the market data feed: local wall clock at SPI
+ * entry minus UpdateTime/UpdateMillisec, per exchange and per instrument, in
+ * milliseconds. UpdateTime is exchange time, UTC+8 for the Chinese futures
+ * exchanges, whatever the timezone of the host is.
+ *
+ * Only the time of day is compared, because ActionDay is not reliable during
+ * night sessions (DCE reports the trading day). Negative latencies mean the
+ * local clock is behind the exchange, the minimum is reported as `skew`.
+ *
+ * Silences longer than the gap threshold count as gaps, except across the
+ * exchanges' session breaks (lunch, day/night close), which every instrument
+ * goes through daily.
+ */
+class FeedMonitor
+{
+public:
+    using ExchangeOf = std::function<std::string(const std::string&)>;
+
+private:
+    struct Stats {
+        Stats();
+        Histogram latency;
+        std::string exchangeId;
+        Stats *exchange = nullptr;
+        int lastLatency = 0;
+        int minLatency = INT32_MAX;
+        int lastTime = -1;
+        int64_t lastArrival = 0;
+        uint64_t gaps = 0;
+        int maxGap = 0;
+        uint64_t outOfOrder = 0;
+    };
+
+    mutable std::mutex _mutex;
+    std::atomic_bool _enabled{false};
+    std::atomic<int64_t> _utcOffset{8 * 60 * 60 * 1000};
+    int _gapThreshold = 5000;
+    int _stallTimeout = 30000;
+    std::unordered_map<std::string, std::unique_ptr<Stats>> _instruments;
+    std::map<std::string, std::unique_ptr<Stats>> _exchanges;
+    ExchangeOf _exchangeOf;
+
+    Stats& Find(const CThostFtdcDepthMarketDataField *pDepthMarketData);
+    static std::map<std::string, double> Summary(const Stats &stats, int64_t now);
+    bool IsStalled(const Stats &stats, int64_t now) const;
+
+public:
+    FeedMonitor() = default;
+    FeedMonitor(const FeedMonitor&) = delete;
+    FeedMonitor& operator=(const FeedMonitor&) = delete;
+
+    inline void SetExchangeOf(ExchangeOf exchangeOf) { _exchangeOf = exchangeOf; }
+    inline bool IsEnabled() const { return _enabled.load(std::memory_order_relaxed); }
+    inline void SetEnabled(bool enabled) { _enabled.store(enabled, std::memory_order_relaxed); }
+    // UTC offset of the exchange time, in minutes.
+    inline int GetUtcOffset() const { return int(_utcOffset.load(std::memory_order_relaxed) / 60000); }
+    inline void SetUtcOffset(int minutes) { _utcOffset.store(int64_t(minutes) * 60000, std::memory_order_relaxed); }
+    inline int GetGapThreshold() const { return _gapThreshold; }
+    inline void SetGapThreshold(int ms) { _gapThreshold = ms; }
+    inline int GetStallTimeout() const { return _stallTimeout; }
+    inline void SetStallTimeout(int ms) { _stallTimeout = ms; }
+
+    void Update(const CThostFtdcDepthMarketDataField *pDepthMarketData);
+    void Reset();
+
+    std::map<std::string, std::map<std::string, double>> GetExchangeStats() const;
+    std::map<std::string, double> GetInstrumentStats(const std::string &instrumentId) const;
+    // Instruments silent for `stallTimeout` while their exchange is still ticking.
+    std::vector<std::string> GetStalledInstruments() const;
+};
@@ -0,0 +1,118 @@
+/*
+ * Copyright 2019 Holmes Conan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <chrono>
+#include <algorithm>
+#include "flowcontrol.h"
+
+using namespace std::chrono_literals;
+
+void FlowControl::Raise(std::atomic<int64_t> &highWater, int64_t value)
+{
+    int64_t current = highWater.load(std::memory_order_relaxed);
+    while (value > current && !highWater.compare_exchange_weak(current, value, std::memory_order_relaxed));
+}
+
+FlowControl::Slot* FlowControl::Find(const char *instrumentId, Queue queue)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto &slot = _slots[queue][instrumentId];
+    if (!slot) {
+        slot.reset(new Slot());
+        slot->queue = queue;
+    }
+    return slot.get();
+}
+
+uint64_t FlowControl::Next(Slot &slot, bool &overflow)
+{
+    uint64_t seq = slot.seq.fetch_add(1, std::memory_order_relaxed) + 1;
+    overflow = false;
+
+    auto &counters = _queues[slot.queue];
+    size_t limit = GetLimit();
+    if (limit == 0 || counters.depth.load(std::memory_order_relaxed) < int64_t(limit)) return seq;
+
+    switch (GetPolicy()) {
+    case OverflowPolicy::Block:
+        _blocked.fetch_add(1, std::memory_order_relaxed);
+        Wait(counters, limit);
+        break;
+    case OverflowPolicy::DropOldest: {
+        // 跳过该合约队列中最旧的一笔，队列中没有时不跳过
+        uint64_t oldest = std::max(slot.dropUntil.load(std::memory_order_acquire), slot.consumed.load(std::memory_order_acquire)) + 1;
+        if (oldest <= slot.queued.load(std::memory_order_acquire)) {
+            slot.dropUntil.store(oldest, std::memory_order_release);
+        }
+        overflow = true;
+        break;
+    }
+    case OverflowPolicy::Conflate:
+        // 已入队的都被这一笔取代
+        slot.dropUntil.store(seq - 1, std::memory_order_release);
+        overflow = true;
+        break;
+    }
+    if (overflow) {
+        _overflowed.fetch_add(1, std::memory_order_relaxed);
+    }
+    return seq;
+}
+
+void FlowControl::Wait(const Counters &counters, size_t limit)
+{
+    std::unique_lock<std::mutex> lock(_waitMutex);
+    _waiters.fetch_add(1, std::memory_order_seq_cst);
+    // 限时等待，错过通知时也能及时醒来
+    while (counters.depth.load(std::memory_order_seq_cst) >= int64_t(limit) && !_closed.load(std::memory_order_acquire)) {
+        _space.wait_for(lock, 1ms);
+    }
+    _waiters.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void FlowControl::Notify()
+{
+    std::lock_guard<std::mutex> lock(_waitMutex);
+    _space.notify_all();
+}
+
+void FlowControl::Reset()
+{
+    for (auto &counters : _queues) {
+        counters.highWater.store(counters.depth.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        counters.enqueued.store(0, std::memory_order_relaxed);
+    }
+    _requestHighWater.store(_requestDepth.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    _dropped.store(0, std::memory_order_relaxed);
+    _blocked.store(0, std::memory_order_relaxed);
+    _overflowed.store(0, std::memory_order_relaxed);
+}
+
+std::map<std::string, int64_t> FlowControl::GetStats() const
+{
+    return {
+        {"depth", _queues[Responses].depth.load(std::memory_order_relaxed)},
+        {"high_water", _queues[Responses].highWater.load(std::memory_order_relaxed)},
+        {"enqueued", int64_t(_queues[Responses].enqueued.load(std::memory_order_relaxed))},
+        {"quote_depth", _queues[Quotes].depth.load(std::memory_order_relaxed)},
+        {"quote_high_water", _queues[Quotes].highWater.load(std::memory_order_relaxed)},
+        {"quote_enqueued", int64_t(_queues[Quotes].enqueued.load(std::memory_order_relaxed))},
+        {"dropped", int64_t(_dropped.load(std::memory_order_relaxed))},
+        {"blocked", int64_t(_blocked.load(std::memory_order_relaxed))},
+        {"overflowed", int64_t(_overflowed.load(std::memory_order_relaxed))},
+        {"request_depth", _requestDepth.load(std::memory_order_relaxed)},
+        {"request_high_water", _requestHighWater.load(std::memory_order_relaxed)}
+    };
+}
@@ -0,0 +1,144 @@
+/*
+ * Copyright 2019 Holmes Conan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <string>
+#include <cstdint>
+#include <unordered_map>
+
+enum class OverflowPolicy {
+    Block,          // 行情线程等待队列有空位，期间不再接收行情
+    DropOldest,     // 每次超出上限跳过该合约已入队的最旧一笔，最新一笔进入合并槽
+    Conflate        // 只保留该合约最新的行情，已入队的也跳过
+};
+
+/*
+ * Depth accounting and overload handling of the response queue.
+ *
+ * Every market data update gets a per-instrument sequence number; the events
+ * built from it (depth, tick, 1 minute bar tick) carry it through the queue.
+ * When the queue is at `limit`, `Next` reports the update as overflowing and
+ * the caller keeps it out of the queue: with DropOldest and Conflate it is
+ * parked in the instrument's conflation slot, which holds only the newest
+ * update, so the queue never grows past the limit. DropOldest also marks the
+ * instrument's oldest queued sequence number obsolete, one per overflowing
+ * update, and Conflate marks all of them; Join skips obsolete events when
+ * dequeued without calling into Python. Block stalls the market data thread,
+ * and with it the CTP feed, until the queue has room or the client exits.
+ * Events without a slot (completed bars, trader events, control events) are
+ * never dropped or blocked.
+ *
+ * The compact quote stream has its own queue, so it is accounted and limited
+ * separately, with its own slots and sequence numbers.
+ */
+class FlowControl
+{
+public:
+    enum Queue {
+        Responses,
+        Quotes,
+        QueueCount
+    };
+
+    struct Slot {
+        std::atomic<uint64_t> seq{0};
+        std::atomic<uint64_t> consumed{0};
+        std::atomic<uint64_t> dropUntil{0};
+        std::atomic<uint64_t> queued{0};
+        Queue queue = Responses;
+    };
+
+private:
+    struct Counters {
+        std::atomic<int64_t> depth{0};
+        std::atomic<int64_t> highWater{0};
+        std::atomic<uint64_t> enqueued{0};
+    };
+
+    std::mutex _mutex;
+    std::unordered_map<std::string, std::unique_ptr<Slot>> _slots[QueueCount];
+    std::atomic<size_t> _limit{0};
+    std::atomic<OverflowPolicy> _policy{OverflowPolicy::Conflate};
+    std::atomic_bool _closed{false};
+    std::mutex _waitMutex;
+    std::condition_variable _space;
+    std::atomic<int> _waiters{0};
+
+    Counters _queues[QueueCount];
+    std::atomic<uint64_t> _dropped{0};
+    std::atomic<uint64_t> _blocked{0};
+    std::atomic<uint64_t> _overflowed{0};
+    std::atomic<int64_t> _requestDepth{0};
+    std::atomic<int64_t> _requestHighWater{0};
+
+    static void Raise(std::atomic<int64_t> &highWater, int64_t value);
+    void Wait(const Counters &counters, size_t limit);
+    void Notify();
+
+public:
+    FlowControl() = default;
+    FlowControl(const FlowControl&) = delete;
+    FlowControl& operator=(const FlowControl&) = delete;
+
+    inline size_t GetLimit() const { return _limit.load(std::memory_order_relaxed); }
+    inline void SetLimit(size_t limit) { _limit.store(limit, std::memory_order_relaxed); }
+    inline OverflowPolicy GetPolicy() const { return _policy.load(std::memory_order_relaxed); }
+    inline void SetPolicy(OverflowPolicy policy) { _policy.store(policy, std::memory_order_relaxed); }
+    // Releases blocked producers, e.g. on exit.
+    inline void Close() { _closed.store(true, std::memory_order_release); Notify(); }
+
+    // Producer side: called once per market data update before its events are
+    // enqueued; `overflow` tells to park the update instead of enqueueing it.
+    Slot* Find(const char *instrumentId, Queue queue = Responses);
+    uint64_t Next(Slot &slot, bool &overflow);
+    // Once per update whose events were enqueued rather than parked.
+    inline void OnQueued(Slot &slot, uint64_t seq) {
+        // 中间的行情都进了合并槽，取走时队列中已没有更早的事件
+        if (seq > slot.queued.load(std::memory_order_relaxed) + 1 && slot.dropUntil.load(std::memory_order_relaxed) < seq - 1) {
+            slot.dropUntil.store(seq - 1, std::memory_order_release);
+        }
+        slot.queued.store(seq, std::memory_order_release);
+    }
+    // Once per physical queue entry.
+    inline void OnEnqueued(Queue queue = Responses) {
+        auto &counters = _queues[queue];
+        counters.enqueued.fetch_add(1, std::memory_order_relaxed);
+        Raise(counters.highWater, counters.depth.fetch_add(1, std::memory_order_relaxed) + 1);
+    }
+
+    // Consumer side: false if the event is obsolete and must be skipped.
+    inline bool OnDequeued(Slot *slot, uint64_t seq, Queue queue = Responses) {
+        _queues[queue].depth.fetch_sub(1, std::memory_order_seq_cst);
+        if (_waiters.load(std::memory_order_seq_cst) > 0) Notify();
+        if (slot == nullptr) return true;
+        if (seq <= slot->dropUntil.load(std::memory_order_acquire)) {
+            _dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        slot->consumed.store(seq, std::memory_order_release);
+        return true;
+    }
+
+    inline void OnRequestEnqueued() { Raise(_requestHighWater, _requestDepth.fetch_add(1, std::memory_order_relaxed) + 1); }
+    inline void OnRequestDequeued() { _requestDepth.fetch_sub(1, std::memory_order_relaxed); }
+
+    void Reset();
+    std::map<std::string, int64_t> GetStats() const;
+};
@@ -0,0 +1,254 @@
+/*
+ * Copyright 2019 Holmes Conan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include "history.h"
+#include "symbols.h"
+
+namespace {
+
+inline int32_t ParseDay(const char *day)
+{
+    return static_cast<int32_t>(atoi(day));
+}
+
+// 交易日内的先后顺序：夜盘（含凌晨）在日盘之前。不用 ActionDay，部分交易所夜盘的 ActionDay 不可靠
+inline int64_t BarKey(const BarRecord &record)
+{
+    const int32_t evening = 18 * 3600000;
+    int32_t time = record.Time >= evening ? record.Time - evening : record.Time + (24 * 3600000 - evening);
+    return static_cast<int64_t>(record.TradingDay) * 24 * 3600000 + time;
+}
+
+// 与合约缓存一样按原样保存结构体，记录大小用于校验
+struct ArchiveHeader {
+    char magic[8];
+    uint32_t recordSize;
+    uint32_t count;
+};
+
+const char ARCHIVE_MAGIC[8] = "CTPBAR1";
+
+bool ReadHeader(std::istream &is, ArchiveHeader &header)
+{
+    return is.read(reinterpret_cast<char*>(&header), sizeof header)
+        && memcmp(header.magic, ARCHIVE_MAGIC, sizeof header.magic) == 0
+        && header.recordSize == sizeof(BarRecord);
+}
+
+}
+
+void HistoryStore::Track(const std::string &instrumentId, size_t ticks, size_t bars)
+{
+    uint32_t symbolId = SymbolTable::Instance().Intern(instrumentId.c_str());
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto iter = _series.find(symbolId);
+    if (iter != _series.end()) {
+        if (iter->second.ticks.GetCapacity() != ticks || iter->second.bars.GetCapacity() != bars) {
+            throw std::invalid_argument("History of " + instrumentId + " is already tracked with other capacities.");
+        }
+        return;
+    }
+
+    auto &series = _series[symbolId];
+    series.ticks.Reset(ticks);
+    series.bars.Reset(bars);
+    if (ticks > 0) _ticksEnabled = true;
+    if (bars > 0) _barsEnabled = true;
+}
+
+bool HistoryStore::IsTracked(const std::string &instrumentId) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _series.count(SymbolTable::Instance().Find(instrumentId)) > 0;
+}
+
+void HistoryStore::Append(const TickBar &tick)
+{
+    if (!IsTickEnabled()) return;
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto iter = _series.find(tick.SymbolId);
+    if (iter == _series.end()) return;
+
+    // UpdateTime: "HH:MM:SS.mmm"
+    TickRecord record;
+    record.TradingDay = ParseDay(tick.TradingDay);
+    record.ActionDay = ParseDay(tick.ActionDay);
+    record.Time = ParseUpdateTime(tick.UpdateTime, atoi(tick.UpdateTime + 9));
+    record.Volume = tick.Volume;
+    record.Price = tick.Price;
+    record.Turnover = tick.Turnover;
+    record.Position = tick.Position;
+    iter->second.ticks.Push(record);
+}
+
+void HistoryStore::Append(const M1Bar &bar)
+{
+    // 中途开始的K线不完整，不进入历史和归档
+    if (!IsBarEnabled() || bar.Partial) return;
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto iter = _series.find(bar.SymbolId);
+    if (iter == _series.end()) return;
+
+    // UpdateTime: "HH:MM"
+    const char *t = bar.UpdateTime;
+    BarRecord record;
+    record.TradingDay = ParseDay(bar.TradingDay);
+    record.ActionDay = ParseDay(bar.ActionDay);
+    record.Time = (((t[0] - '0') * 10 + (t[1] - '0')) * 60 + (t[3] - '0') * 10 + (t[4] - '0')) * 60000;
+    record.Volume = bar.Volume;
+    record.Open = bar.OpenPrice;
+    record.High = bar.HighestPrice;
+    record.Low = bar.LowestPrice;
+    record.Close = bar.ClosePrice;
+    record.Turnover = bar.Turnover;
+    record.Position = bar.Position;
+
+    auto last = iter->second.bars.Back();
+    if (last != nullptr && BarKey(record) <= BarKey(*last)) return;
+    iter->second.bars.Push(record);
+}
+
+std::vector<std::string> HistoryStore::GetInstrumentIds() const
+{
+    auto &symbols = SymbolTable::Instance();
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::vector<std::string> v;
+    for (auto &kv : _series) {
+        v.push_back(symbols.GetName(kv.first));
+    }
+    return v;
+}
+
+std::string HistoryStore::ArchiveFile(const std::string &dir, const std::string &instrumentId)
+{
+#ifdef WIN32
+    return dir + "\\" + instrumentId + ".m1";
+#else
+    return dir + "/" + instrumentId + ".m1";
+#endif
+}
+
+bool HistoryStore::Load(const std::string &path, size_t n, std::vector<BarRecord> &records)
+{
+    std::ifstream ifs(path, std::ios::binary);
+    ArchiveHeader header;
+    if (!ifs || !ReadHeader(ifs, header)) return false;
+
+    // 只读取末尾的 n 条
+    size_t count = header.count;
+    if (n == 0 || n > count) n = count;
+    ifs.seekg(static_cast<std::streamoff>((count - n) * sizeof(BarRecord)), std::ios::cur);
+
+    records.resize(n);
+    return n == 0 || static_cast<bool>(ifs.read(reinterpret_cast<char*>(records.data()), n * sizeof(BarRecord)));
+}
+
+bool HistoryStore::Save(const std::string &path, const std::string &instrumentId) const
+{
+    std::vector<BarRecord> records;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto iter = _series.find(SymbolTable::Instance().Find(instrumentId));
+        if (iter == _series.end() || iter->second.bars.GetCapacity() == 0) return false;
+
+        size_t n = 0;
+        auto first = iter->second.bars.Last(n);
+        records.assign(first, first + n);
+    }
+
+    std::fstream fs(path, std::ios::binary | std::ios::in | std::ios::out);
+    ArchiveHeader header;
+    if (fs && ReadHeader(fs, header)) {
+        // 跳过已经归档的部分，只追加比归档最后一根更新的分钟线
+        size_t begin = 0;
+        if (header.count > 0) {
+            BarRecord last;
+            fs.seekg(static_cast<std::streamoff>(sizeof header + (header.count - 1) * sizeof(BarRecord)));
+            if (!fs.read(reinterpret_cast<char*>(&last), sizeof last)) return false;
+            while (begin < records.size() && BarKey(records[begin]) <= BarKey(last)) {
+                begin++;
+            }
+        }
+        if (begin == records.size()) return true;
+
+        fs.seekp(static_cast<std::streamoff>(sizeof header + header.count * sizeof(BarRecord)));
+        fs.write(reinterpret_cast<const char*>(records.data() + begin), (records.size() - begin) * sizeof(BarRecord));
+        header.count += static_cast<uint32_t>(records.size() - begin);
+        fs.seekp(0);
+        fs.write(reinterpret_cast<const char*>(&header), sizeof header);
+        return static_cast<bool>(fs);
+    }
+    fs.close();
+
+    memset(&header, 0, sizeof header);
+    memcpy(header.magic, ARCHIVE_MAGIC, sizeof header.magic);
+    header.recordSize = sizeof(BarRecord);
+    header.count = static_cast<uint32_t>(records.size());
+
+    std::string tmpPath = path + ".tmp";
+    {
+        std::ofstream ofs(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!ofs) return false;
+
+        ofs.write(reinterpret_cast<const char*>(&header), sizeof header);
+        ofs.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(BarRecord));
+        if (!ofs) return false;
+    }
+
+    std::remove(path.c_str());
+    return std::rename(tmpPath.c_str(), path.c_str()) == 0;
+}
+
+void HistoryStore::ToBar(const BarRecord &record, const std::string &instrumentId, uint32_t symbolId, M1Bar &bar)
+{
+    memset(&bar, 0, sizeof bar);
+    strncpy(bar.InstrumentID, instrumentId.c_str(), sizeof bar.InstrumentID - 1);
+    bar.SymbolId = symbolId;
+    snprintf(bar.TradingDay, sizeof bar.TradingDay, "%08d", record.TradingDay);
+    snprintf(bar.ActionDay, sizeof bar.ActionDay, "%08d", record.ActionDay);
+    int minutes = record.Time / 60000;
+    snprintf(bar.UpdateTime, sizeof bar.UpdateTime, "%02d:%02d", minutes / 60, minutes % 60);
+    bar.OpenPrice = record.Open;
+    bar.HighestPrice = record.High;
+    bar.LowestPrice = record.Low;
+    bar.ClosePrice = record.Close;
+    bar.Volume = record.Volume;
+    bar.Turnover = record.Turnover;
+    bar.Position = record.Position;
+}
+
+const TickRecord* HistoryStore::GetTicks(const std::string &instrumentId, size_t &n) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto iter = _series.find(SymbolTable::Instance().Find(instrumentId));
+    if (iter == _series.end() || iter->second.ticks.GetCapacity() == 0) return nullptr;
+    return iter->second.ticks.Last(n);
+}
+
+const BarRecord* HistoryStore::GetBars(const std::string &instrumentId, size_t &n) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto iter = _series.find(SymbolTable::Instance().Find(instrumentId));
+    if (iter == _series.end() || iter->second.bars.GetCapacity() == 0) return nullptr;
+    return iter->second.bars.Last(n);
+}
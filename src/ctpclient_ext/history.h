@@ -0,0 +1,148 @@
+/*
+ * Copyright 2019 Holmes Conan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+#include "ThostFtdcUserApiStruct.h"
+#include "bar.h"
+
+// 历史记录只保留数值字段，可直接作为 NumPy 结构化数组的元素
+struct TickRecord {
+    int32_t TradingDay;
+    int32_t ActionDay;
+    int32_t Time;           // 当天的毫秒数
+    int32_t Volume;
+    double Price;
+    double Turnover;
+    double Position;
+};
+
+struct BarRecord {
+    int32_t TradingDay;
+    int32_t ActionDay;
+    int32_t Time;           // 分钟开始时刻，当天的毫秒数
+    int32_t Volume;
+    double Open;
+    double High;
+    double Low;
+    double Close;
+    double Turnover;
+    double Position;
+};
+
+/*
+ * Fixed-capacity ring whose entries are written twice, at `i` and
+ * `i + slots`, so the last `n` entries are always contiguous and can be
+ * viewed without unwrapping. It has twice as many slots as its capacity, so
+ * the entries returned by `Last` are not overwritten by the next `capacity`
+ * pushes.
+ */
+template<class T>
+class HistoryRing
+{
+    std::unique_ptr<T[]> _data;
+    size_t _capacity = 0;
+    size_t _slots = 0;
+    size_t _head = 0;
+    size_t _size = 0;
+
+public:
+    void Reset(size_t capacity)
+    {
+        _slots = capacity * 2;
+        _data.reset(capacity > 0 ? new T[_slots * 2] : nullptr);
+        _capacity = capacity;
+        _head = _size = 0;
+    }
+
+    inline size_t GetCapacity() const { return _capacity; }
+    inline size_t GetSize() const { return _size; }
+    inline const T* Back() const { return _size > 0 ? _data.get() + (_head + _slots - 1) % _slots : nullptr; }
+
+    void Push(const T &item)
+    {
+        if (_capacity == 0) return;
+        _data[_head] = item;
+        _data[_head + _slots] = item;
+        _head = (_head + 1) % _slots;
+        if (_size < _capacity) _size++;
+    }
+
+    // Oldest of the last `n` entries (all if 0); `n` is clamped to the size.
+    const T* Last(size_t &n) const
+    {
+        if (n == 0 || n > _size) n = _size;
+        return _data.get() + _head + _slots - n;
+    }
+};
+
+/*
+ * Recent ticks and completed 1 minute bars of the tracked instruments,
+ * appended on the dispatch thread right before `on_tick`/`on_1min`, so
+ * memory stays constant however long the session runs.
+ *
+ * The buffers are never reallocated once tracked, so views of them stay valid;
+ * a view of the last `n` entries keeps showing them, in order, for the next
+ * `capacity` appends and is overwritten afterwards.
+ */
+class HistoryStore
+{
+    struct Series {
+        HistoryRing<TickRecord> ticks;
+        HistoryRing<BarRecord> bars;
+    };
+
+    mutable std::mutex _mutex;
+    std::atomic_bool _ticksEnabled{false};
+    std::atomic_bool _barsEnabled{false};
+    std::unordered_map<uint32_t, Series> _series;
+
+public:
+    HistoryStore() = default;
+    HistoryStore(const HistoryStore&) = delete;
+    HistoryStore& operator=(const HistoryStore&) = delete;
+
+    inline bool IsTickEnabled() const { return _ticksEnabled.load(std::memory_order_relaxed); }
+    inline bool IsBarEnabled() const { return _barsEnabled.load(std::memory_order_relaxed); }
+
+    // Tracking again with other capacities is refused, views may still point at the buffers.
+    void Track(const std::string &instrumentId, size_t ticks, size_t bars);
+    bool IsTracked(const std::string &instrumentId) const;
+
+    void Append(const TickBar &tick);
+    // Partial bars and bars not newer than the last one, e.g. the bar completed
+    // live right after a warm-up, are dropped.
+    void Append(const M1Bar &bar);
+    std::vector<std::string> GetInstrumentIds() const;
+
+    // Bar archive of one instrument: a header and the records, oldest first.
+    static std::string ArchiveFile(const std::string &dir, const std::string &instrumentId);
+    // Reads the last `n` bars (all if 0) of an archive.
+    static bool Load(const std::string &path, size_t n, std::vector<BarRecord> &records);
+    // Appends the bars newer than the archive's last one.
+    bool Save(const std::string &path, const std::string &instrumentId) const;
+    // Fixed-point prices are left to the caller.
+    static void ToBar(const BarRecord &record, const std::string &instrumentId, uint32_t symbolId, M1Bar &bar);
+
+    // Last `n` entries (all if 0), oldest first; `n` is set to the number returned.
+    const TickRecord* GetTicks(const std::string &instrumentId, size_t &n) const;
+    const BarRecord* GetBars(const std::string &instrumentId, size_t &n) const;
+};
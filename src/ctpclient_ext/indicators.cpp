@@ -0,0 +1,258 @@
+/*
+ * Copyright 2019 Holmes Conan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <cmath>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include "indicators.h"
+#include "symbols.h"
+
+namespace {
+
+const double NaN = std::numeric_limits<double>::quiet_NaN();
+
+}
+
+Indicator::Indicator(IndicatorType type, int period, double k)
+: _type(type), _period(period > 0 ? period : 1), _k(k), _alpha(2.0 / (_period + 1))
+{
+    if (_type == IndicatorType::Bollinger) {
+        _window.resize(_period, 0.0);
+    }
+}
+
+void Indicator::Update(const M1Bar &bar, bool commit, double *values)
+{
+    double close = bar.ClosePrice;
+    int count = _count + 1;
+
+    switch (_type) {
+    case IndicatorType::EMA:
+    {
+        double value = _count == 0 ? close : _alpha * close + (1 - _alpha) * _value;
+        values[0] = count >= _period ? value : NaN;
+        if (commit) {
+            _value = value;
+        }
+    }
+        break;
+    case IndicatorType::ATR:
+    {
+        double tr = bar.HighestPrice - bar.LowestPrice;
+        if (_count > 0) {
+            tr = std::max(tr, std::max(std::fabs(bar.HighestPrice - _prevClose), std::fabs(bar.LowestPrice - _prevClose)));
+        }
+        // 前 period 根取真实波幅的均值作为初值
+        double sum = count <= _period ? _sum + tr : _sum;
+        double value = count < _period ? NaN
+            : count == _period ? sum / _period
+            : (_value * (_period - 1) + tr) / _period;
+        values[0] = value;
+        if (commit) {
+            _sum = sum;
+            _value = value;
+            _prevClose = close;
+        }
+    }
+        break;
+    case IndicatorType::VWAP:
+    {
+        // 用典型价计算，避免依赖合约乘数
+        bool newDay = strcmp(_tradingDay, bar.TradingDay) != 0;
+        double pv = (newDay ? 0.0 : _sum) + (bar.HighestPrice + bar.LowestPrice + close) / 3 * bar.Volume;
+        double volume = (newDay ? 0.0 : _volume) + bar.Volume;
+        values[0] = volume > 0 ? pv / volume : NaN;
+        if (commit) {
+            if (newDay) {
+                strncpy(_tradingDay, bar.TradingDay, sizeof _tradingDay);
+            }
+            _sum = pv;
+            _volume = volume;
+        }
+    }
+        break;
+    case IndicatorType::Bollinger:
+    {
+        // 窗口满后用新收盘价替换最旧的一个
+        double oldest = _count >= _period ? _window[_pos] : 0.0;
+        double sum = _sum - oldest + close;
+        double sumSq = _sumSq - oldest * oldest + close * close;
+        if (count >= _period) {
+            double mean = sum / _period;
+            double stddev = std::sqrt(std::max(sumSq / _period - mean * mean, 0.0));
+            values[0] = mean;
+            values[1] = mean + _k * stddev;
+            values[2] = mean - _k * stddev;
+        } else {
+            values[0] = values[1] = values[2] = NaN;
+        }
+        if (commit) {
+            _window[_pos] = close;
+            _pos = (_pos + 1) % _period;
+            _sum = sum;
+            _sumSq = sumSq;
+        }
+    }
+        break;
+    case IndicatorType::RSI:
+    {
+        // 第一根只记录收盘价，之后每根贡献一个涨跌幅
+        double change = _count > 0 ? close - _prevClose : 0.0;
+        double gain = change > 0 ? change : 0.0;
+        double loss = change < 0 ? -change : 0.0;
+        int changes = count - 1;
+        double avgGain, avgLoss;
+        if (changes <= _period) {
+            avgGain = _avgGain + gain;
+            avgLoss = _avgLoss + loss;
+        } else {
+            avgGain = (_avgGain * (_period - 1) + gain) / _period;
+            avgLoss = (_avgLoss * (_period - 1) + loss) / _period;
+        }
+        if (changes == _period) {
+            avgGain /= _period;
+            avgLoss /= _period;
+        }
+        values[0] = changes < _period ? NaN
+            : avgLoss == 0 ? 100.0
+            : 100.0 - 100.0 / (1.0 + avgGain / avgLoss);
+        if (commit) {
+            _avgGain = avgGain;
+            _avgLoss = avgLoss;
+            _prevClose = close;
+        }
+    }
+        break;
+    }
+
+    if (commit) {
+        _count = count;
+    }
+}
+
+void IndicatorEngine::Add(const std::string &instrumentId, const std::string &name, IndicatorType type, int period, double k)
+{
+    if (period <= 0 && type != IndicatorType::VWAP) {
+        throw std::invalid_argument("period must be positive.");
+    }
+
+    uint32_t symbolId = SymbolTable::Instance().Intern(instrumentId.c_str());
+    Indicator indicator(type, period, k);
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto &series = _series[symbolId];
+    if (series.width + indicator.GetWidth() > MAX_VALUES) {
+        throw std::invalid_argument("Too many indicators for " + instrumentId);
+    }
+    if (!series.values) {
+        series.values.reset(new double[MAX_VALUES]);
+        std::fill(series.values.get(), series.values.get() + MAX_VALUES, NaN);
+    }
+
+    series.indicators.push_back(indicator);
+    series.names.push_back(name);
+    if (type == IndicatorType::Bollinger) {
+        series.names.push_back(name + "_upper");
+        series.names.push_back(name + "_lower");
+    }
+    series.width += indicator.GetWidth();
+    _enabled = true;
+}
+
+void IndicatorEngine::Remove(const std::string &instrumentId)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto iter = _series.find(SymbolTable::Instance().Find(instrumentId));
+    if (iter == _series.end()) return;
+
+    auto &series = iter->second;
+    series.indicators.clear();
+    series.names.clear();
+    series.width = 0;
+    std::fill(series.values.get(), series.values.get() + MAX_VALUES, NaN);
+
+    bool enabled = false;
+    for (auto &kv : _series) {
+        enabled = enabled || !kv.second.indicators.empty();
+    }
+    _enabled = enabled;
+}
+
+void IndicatorEngine::Update(const M1Bar &bar, bool commit)
+{
+    // 启动、预热或缺口后中途开始的K线不完整，VWAP 等会被扭曲
+    if (!IsEnabled() || bar.Partial) return;
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto iter = _series.find(bar.SymbolId);
+    if (iter == _series.end()) return;
+
+    auto &series = iter->second;
+    if (commit) {
+        // TradingDay + "HH:MM"，一个交易日内的分钟不会重复
+        int64_t key = static_cast<int64_t>(atoi(bar.TradingDay)) * 10000
+            + ((bar.UpdateTime[0] - '0') * 10 + (bar.UpdateTime[1] - '0')) * 100
+            + (bar.UpdateTime[3] - '0') * 10 + (bar.UpdateTime[4] - '0');
+        if (key == series.lastBar) return;
+        series.lastBar = key;
+    }
+
+    double *values = series.values.get();
+    for (auto &indicator : series.indicators) {
+        indicator.Update(bar, commit, values);
+        values += indicator.GetWidth();
+    }
+}
+
+bool IndicatorEngine::Has(const std::string &instrumentId) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto iter = _series.find(SymbolTable::Instance().Find(instrumentId));
+    return iter != _series.end() && !iter->second.indicators.empty();
+}
+
+std::map<std::string, double> IndicatorEngine::GetValues(const std::string &instrumentId) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto iter = _series.find(SymbolTable::Instance().Find(instrumentId));
+    if (iter == _series.end()) return {};
+
+    std::map<std::string, double> result;
+    auto &series = iter->second;
+    for (size_t i = 0; i < series.names.size(); i++) {
+        result[series.names[i]] = series.values[i];
+    }
+    return result;
+}
+
+std::vector<std::string> IndicatorEngine::GetNames(const std::string &instrumentId) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto iter = _series.find(SymbolTable::Instance().Find(instrumentId));
+    return iter == _series.end() ? std::vector<std::string>() : iter->second.names;
+}
+
+const double* IndicatorEngine::GetBuffer(const std::string &instrumentId, size_t &width) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto iter = _series.find(SymbolTable::Instance().Find(instrumentId));
+    if (iter == _series.end()) return nullptr;
+
+    width = iter->second.width;
+    return iter->second.values.get();
+}
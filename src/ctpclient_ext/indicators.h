@@ -0,0 +1,121 @@
+/*
+ * Copyright 2019 Holmes Conan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+#include "ThostFtdcUserApiStruct.h"
+#include "bar.h"
+
+enum class IndicatorType {
+    EMA,
+    ATR,            // Wilder 平滑
+    VWAP,           // 按交易日累计
+    Bollinger,      // 中轨、上轨、下轨
+    RSI             // Wilder 平滑
+};
+
+/*
+ * Streaming indicator of one instrument, updated in O(1) per bar. Values are
+ * NaN until `period` bars have been seen.
+ */
+class Indicator
+{
+    IndicatorType _type;
+    int _period;
+    double _k;
+    double _alpha;
+
+    int _count = 0;
+    double _value = 0.0;
+    double _prevClose = 0.0;
+    double _sum = 0.0;
+    double _sumSq = 0.0;
+    // VWAP 的当日累计成交量
+    double _volume = 0.0;
+    double _avgGain = 0.0;
+    double _avgLoss = 0.0;
+    // Bollinger 的收盘价窗口
+    std::vector<double> _window;
+    size_t _pos = 0;
+    TThostFtdcDateType _tradingDay = {0};
+
+public:
+    Indicator(IndicatorType type, int period, double k);
+
+    inline IndicatorType GetType() const { return _type; }
+    // Number of values written by `Update`.
+    inline size_t GetWidth() const { return _type == IndicatorType::Bollinger ? 3 : 1; }
+
+    // `commit` folds a completed bar into the state; otherwise the values of the
+    // bar in progress are computed without changing the state.
+    void Update(const M1Bar &bar, bool commit, double *values);
+};
+
+/*
+ * Indicators registered per instrument, evaluated on the dispatch thread just
+ * before the bar is delivered: completed bars (`on_1min`) update the state,
+ * bars in progress (`on_1min_tick`) only refresh the values.
+ *
+ * The values of an instrument live in one fixed buffer, so NumPy views of it
+ * stay valid while indicators are added.
+ */
+class IndicatorEngine
+{
+public:
+    static const size_t MAX_VALUES = 32;
+
+private:
+    struct Series {
+        std::vector<Indicator> indicators;
+        std::vector<std::string> names;
+        std::unique_ptr<double[]> values;
+        size_t width = 0;
+        // 最后一根已完成分钟线，预热后重复到达的同一根不再计入
+        int64_t lastBar = 0;
+    };
+
+    mutable std::mutex _mutex;
+    std::atomic_bool _enabled{false};
+    std::unordered_map<uint32_t, Series> _series;
+
+public:
+    IndicatorEngine() = default;
+    IndicatorEngine(const IndicatorEngine&) = delete;
+    IndicatorEngine& operator=(const IndicatorEngine&) = delete;
+
+    inline bool IsEnabled() const { return _enabled.load(std::memory_order_relaxed); }
+
+    // Bollinger adds `name`, `name_upper` and `name_lower`.
+    void Add(const std::string &instrumentId, const std::string &name, IndicatorType type, int period, double k);
+    // Drops the indicators of the instrument but keeps its buffer, which may still be viewed.
+    void Remove(const std::string &instrumentId);
+    // Partial bars are skipped.
+    void Update(const M1Bar &bar, bool commit);
+    // Whether indicators are registered on the instrument.
+    bool Has(const std::string &instrumentId) const;
+
+    std::map<std::string, double> GetValues(const std::string &instrumentId) const;
+    std::vector<std::string> GetNames(const std::string &instrumentId) const;
+    // Value buffer of the instrument, nullptr if it has no indicators. `width` is
+    // the current number of values, indicators added later extend the buffer.
+    const double* GetBuffer(const std::string &instrumentId, size_t &width) const;
+};
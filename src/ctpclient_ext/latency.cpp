@@ -0,0 +1,182 @@
+/*
+ * Copyright 2019 Holmes Conan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <cmath>
+#include "latency.h"
+
+namespace {
+
+const int LINEAR_BITS = 6;      // 0..63 计数精确
+const int SUB_BUCKET_BITS = 5;  // 之后每个 2 的幂分成 32 份
+
+inline int HighestBit(uint64_t value)
+{
+    int n = 0;
+    while (value >>= 1) n++;
+    return n;
+}
+
+}
+
+thread_local int64_t LatencyStats::t_entry = 0;
+thread_local int64_t LatencyStats::t_cause = 0;
+
+Histogram::Histogram(int maxBits)
+: _size((size_t(1) << LINEAR_BITS) + size_t(maxBits - LINEAR_BITS + 1) * (size_t(1) << SUB_BUCKET_BITS)),
+  _counts(new std::atomic<uint64_t>[_size]())
+{
+    //
+}
+
+size_t Histogram::IndexOf(int64_t value) const
+{
+    if (value < 0) value = 0;
+    if (value < (int64_t(1) << LINEAR_BITS)) return size_t(value);
+
+    int msb = HighestBit(uint64_t(value));
+    size_t sub = size_t(value >> (msb - SUB_BUCKET_BITS)) - (size_t(1) << SUB_BUCKET_BITS);
+    size_t index = (size_t(1) << LINEAR_BITS) + size_t(msb - LINEAR_BITS) * (size_t(1) << SUB_BUCKET_BITS) + sub;
+    return index < _size ? index : _size - 1;
+}
+
+int64_t Histogram::ValueOf(size_t index) const
+{
+    if (index < (size_t(1) << LINEAR_BITS)) return int64_t(index);
+
+    index -= size_t(1) << LINEAR_BITS;
+    int msb = int(index >> SUB_BUCKET_BITS) + LINEAR_BITS;
+    int64_t sub = int64_t(index & ((size_t(1) << SUB_BUCKET_BITS) - 1)) + (int64_t(1) << SUB_BUCKET_BITS);
+    int shift = msb - SUB_BUCKET_BITS;
+    // 桶的中点
+    return (sub << shift) + (int64_t(1) << shift) / 2;
+}
+
+void Histogram::Record(int64_t value)
+{
+    if (value < 0) {
+        // 计入最快的桶会拉低各分位数
+        _negative.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    _counts[IndexOf(value)].fetch_add(1, std::memory_order_relaxed);
+    _count.fetch_add(1, std::memory_order_relaxed);
+    _sum.fetch_add(uint64_t(value), std::memory_order_relaxed);
+
+    int64_t min = _min.load(std::memory_order_relaxed);
+    while (value < min && !_min.compare_exchange_weak(min, value, std::memory_order_relaxed));
+    int64_t max = _max.load(std::memory_order_relaxed);
+    while (value > max && !_max.compare_exchange_weak(max, value, std::memory_order_relaxed));
+}
+
+void Histogram::Reset()
+{
+    for (size_t i = 0; i < _size; i++) {
+        _counts[i].store(0, std::memory_order_relaxed);
+    }
+    _count.store(0, std::memory_order_relaxed);
+    _negative.store(0, std::memory_order_relaxed);
+    _sum.store(0, std::memory_order_relaxed);
+    _min.store(INT64_MAX, std::memory_order_relaxed);
+    _max.store(0, std::memory_order_relaxed);
+}
+
+int64_t Histogram::GetMin() const
+{
+    int64_t min = _min.load(std::memory_order_relaxed);
+    return min == INT64_MAX ? 0 : min;
+}
+
+double Histogram::GetMean() const
+{
+    uint64_t count = GetCount();
+    return count == 0 ? 0.0 : double(_sum.load(std::memory_order_relaxed)) / double(count);
+}
+
+int64_t Histogram::GetPercentile(double percentile) const
+{
+    uint64_t count = GetCount();
+    if (count == 0) return 0;
+
+    uint64_t target = uint64_t(std::ceil(percentile / 100.0 * double(count)));
+    if (target == 0) target = 1;
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < _size; i++) {
+        seen += _counts[i].load(std::memory_order_relaxed);
+        if (seen >= target) {
+            int64_t value = ValueOf(i);
+            return value < GetMax() ? value : GetMax();
+        }
+    }
+    return GetMax();
+}
+
+std::map<std::string, double> Histogram::GetSummary() const
+{
+    return {
+        {"count", double(GetCount())},
+        {"negative", double(GetNegativeCount())},
+        {"min", double(GetMin())},
+        {"max", double(GetMax())},
+        {"mean", GetMean()},
+        {"p50", double(GetPercentile(50.0))},
+        {"p90", double(GetPercentile(90.0))},
+        {"p99", double(GetPercentile(99.0))},
+        {"p999", double(GetPercentile(99.9))}
+    };
+}
+
+void LatencyStats::Record(int64_t entry, int64_t enqueue, int64_t dequeue, int64_t acquired, int64_t returned)
+{
+    _histograms[Spi].Record(enqueue - entry);
+    _histograms[Queue].Record(dequeue - enqueue);
+    _histograms[Gil].Record(acquired - dequeue);
+    _histograms[Callback].Record(returned - acquired);
+    _histograms[Total].Record(returned - entry);
+}
+
+void LatencyStats::Reset()
+{
+    for (auto &h : _histograms) {
+        h.Reset();
+    }
+}
+
+const char* LatencyStats::GetStageName(Stage stage)
+{
+    switch (stage) {
+    case Spi:
+        return "spi";
+    case Queue:
+        return "queue";
+    case Gil:
+        return "gil";
+    case Callback:
+        return "callback";
+    case Total:
+        return "total";
+    default:
+        return "";
+    }
+}
+
+std::map<std::string, std::map<std::string, double>> LatencyStats::GetStats() const
+{
+    std::map<std::string, std::map<std::string, double>> stats;
+    for (int i = 0; i < StageCount; i++) {
+        stats[GetStageName(Stage(i))] = _histograms[i].GetSummary();
+    }
+    return stats;
+}
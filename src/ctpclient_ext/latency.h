@@ -0,0 +1,154 @@
+/*
+ * Copyright 2019 Holmes Conan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+#include <map>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <cstdint>
+
+/*
+ * Log-linear histogram in the spirit of HdrHistogram: values below 64 are
+ * counted exactly, above that each power of two is split into 32 buckets,
+ * so every recorded value is kept within ~3% of its true value. Recording
+ * is lock free and may happen from several threads.
+ *
+ * Negative values (clock skew, a missing stamp) are only counted as
+ * `negative`, they are not part of the distribution.
+ */
+class Histogram
+{
+    size_t _size;
+    std::unique_ptr<std::atomic<uint64_t>[]> _counts;
+    std::atomic<uint64_t> _count{0};
+    std::atomic<uint64_t> _negative{0};
+    std::atomic<uint64_t> _sum{0};
+    std::atomic<int64_t> _min{INT64_MAX};
+    std::atomic<int64_t> _max{0};
+
+    size_t IndexOf(int64_t value) const;
+    int64_t ValueOf(size_t index) const;
+
+public:
+    // Values above 2^maxBits are clamped.
+    explicit Histogram(int maxBits = 40);
+    Histogram(const Histogram&) = delete;
+    Histogram& operator=(const Histogram&) = delete;
+
+    void Record(int64_t value);
+    void Reset();
+
+    inline uint64_t GetCount() const { return _count.load(std::memory_order_relaxed); }
+    inline uint64_t GetNegativeCount() const { return _negative.load(std::memory_order_relaxed); }
+    int64_t GetMin() const;
+    inline int64_t GetMax() const { return _max.load(std::memory_order_relaxed); }
+    double GetMean() const;
+    int64_t GetPercentile(double percentile) const;
+    // count, negative, min, max, mean, p50, p90, p99, p999
+    std::map<std::string, double> GetSummary() const;
+};
+
+/*
+ * Per-stage latency of the response pipeline, in nanoseconds of
+ * steady_clock:
+ *
+ *   spi       SPI entry -> enqueued (bar building etc.)
+ *   queue     enqueued -> dequeued by Join/Poll
+ *   gil       dequeued -> GIL acquired (Join/Poll run without the GIL)
+ *   callback  GIL acquired -> callback returned
+ *   total     SPI entry -> callback returned
+ *
+ * Conflated updates are timed once per drained instrument, from the entry
+ * of its newest update. When disabled no clock is read and responses carry
+ * zero stamps, unless an explicit entry (the loopback front's injection time)
+ * is given; such responses are not timed, but requests made while they are
+ * dispatched can be timed from their cause.
+ */
+class LatencyStats
+{
+public:
+    enum Stage {
+        Spi,
+        Queue,
+        Gil,
+        Callback,
+        Total,
+        StageCount
+    };
+
+    inline static int64_t Now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // Marks the SPI entry of the current thread for the responses enqueued in its scope.
+    // A nested scope keeps the outer entry.
+    class Entry
+    {
+        int64_t _outer;
+
+    public:
+        explicit Entry(const LatencyStats &stats) : _outer(t_entry) { if (_outer == 0 && stats.IsEnabled()) t_entry = Now(); }
+        // Explicit entry, carried even when the stats are disabled.
+        explicit Entry(int64_t entry) : _outer(t_entry) { t_entry = entry; }
+        ~Entry() { t_entry = _outer; }
+        Entry(const Entry&) = delete;
+        Entry& operator=(const Entry&) = delete;
+    };
+
+    // Marks the response dispatched on the current thread as the cause of the requests made in its scope.
+    class Cause
+    {
+    public:
+        explicit Cause(int64_t entry) { t_cause = entry; }
+        ~Cause() { t_cause = 0; }
+        Cause(const Cause&) = delete;
+        Cause& operator=(const Cause&) = delete;
+    };
+
+    // Entry of the response being dispatched on the current thread, 0 if none.
+    inline static int64_t GetCause() { return t_cause; }
+
+private:
+    static thread_local int64_t t_entry;
+    static thread_local int64_t t_cause;
+    std::atomic_bool _enabled{false};
+    Histogram _histograms[StageCount];
+
+public:
+    LatencyStats() = default;
+    LatencyStats(const LatencyStats&) = delete;
+    LatencyStats& operator=(const LatencyStats&) = delete;
+
+    inline bool IsEnabled() const { return _enabled.load(std::memory_order_relaxed); }
+    inline void SetEnabled(bool enabled) { _enabled.store(enabled, std::memory_order_relaxed); }
+
+    // Responses enqueued outside of an `Entry` scope use the enqueue time as entry.
+    // When disabled only an explicit entry is carried and `enqueue` is left 0.
+    inline void Stamp(int64_t &entry, int64_t &enqueue) const {
+        if (!IsEnabled()) {
+            entry = t_entry;
+            return;
+        }
+        enqueue = Now();
+        entry = t_entry != 0 ? t_entry : enqueue;
+    }
+    void Record(int64_t entry, int64_t enqueue, int64_t dequeue, int64_t acquired, int64_t returned);
+    void Reset();
+
+    static const char* GetStageName(Stage stage);
+    std::map<std::string, std::map<std::string, double>> GetStats() const;
+};
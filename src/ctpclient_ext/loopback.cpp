@@ -0,0 +1,296 @@
+/*
+ * Copyright 2019 Holmes Conan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include "loopback.h"
+#include "bench.h"
+
+namespace {
+
+// 回环前置的应答都是成功的
+CThostFtdcRspInfoField g_rspOk = {0, {0}};
+
+}
+
+LoopbackFront::~LoopbackFront()
+{
+    Stop();
+}
+
+bool LoopbackFront::IsLoopback(const std::string &addr)
+{
+    return addr.compare(0, 11, "loopback://") == 0;
+}
+
+void LoopbackFront::Start(size_t instruments, size_t updates, double rate)
+{
+    auto spi = _mdSpi.load(std::memory_order_acquire);
+    if (spi == nullptr) {
+        throw std::runtime_error("The market data front is not a loopback front, or Init was not called.");
+    }
+    if (_running.exchange(true)) {
+        throw std::runtime_error("The loopback front is already injecting.");
+    }
+    if (_injector.joinable()) {
+        _injector.join();
+    }
+
+    _stop = false;
+    _injector = std::thread(&LoopbackFront::Inject, this, spi, instruments, updates, rate);
+}
+
+void LoopbackFront::Stop()
+{
+    _stop = true;
+    if (_injector.joinable()) {
+        _injector.join();
+    }
+}
+
+void LoopbackFront::Inject(CThostFtdcMdSpi *spi, size_t instruments, size_t updates, double rate)
+{
+    DepthStream stream(instruments, 42);
+    CThostFtdcDepthMarketDataField depth;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < updates && !_stop.load(std::memory_order_relaxed); i++) {
+        if (rate > 0) {
+            std::this_thread::sleep_until(start + std::chrono::nanoseconds(static_cast<int64_t>(i * 1e9 / rate)));
+        }
+        stream.Next(depth);
+        {
+            // 注入时刻随事件传递，由它触发的报单据此计时
+            LatencyStats::Entry entry(LatencyStats::Now());
+            spi->OnRtnDepthMarketData(&depth);
+        }
+        _injected.fetch_add(1, std::memory_order_relaxed);
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _seconds = elapsed.count();
+    }
+    _running.store(false, std::memory_order_release);
+}
+
+void LoopbackFront::OnOrderInsert()
+{
+    int64_t now = LatencyStats::Now();
+    _orders.fetch_add(1, std::memory_order_relaxed);
+
+    int64_t cause = LatencyStats::GetCause();
+    if (cause != 0) {
+        _tickToOrder.Record(now - cause);
+    }
+}
+
+std::map<std::string, double> LoopbackFront::GetStats() const
+{
+    auto result = _tickToOrder.GetSummary();
+    auto injected = _injected.load(std::memory_order_relaxed);
+    result["injected"] = static_cast<double>(injected);
+    result["orders"] = static_cast<double>(_orders.load(std::memory_order_relaxed));
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    result["seconds"] = _seconds;
+    result["rate"] = _seconds > 0 ? injected / _seconds : 0.0;
+    return result;
+}
+
+void LoopbackFront::Reset()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _tickToOrder.Reset();
+    _injected = 0;
+    _orders = 0;
+    _seconds = 0.0;
+}
+
+#pragma region LoopbackMdApi
+
+void LoopbackMdApi::Release()
+{
+    _front->SetMdSpi(nullptr);
+    delete this;
+}
+
+void LoopbackMdApi::Init()
+{
+    if (_spi) _spi->OnFrontConnected();
+}
+
+const char *LoopbackMdApi::GetTradingDay()
+{
+    return BENCH_TRADING_DAY;
+}
+
+void LoopbackMdApi::RegisterSpi(CThostFtdcMdSpi *pSpi)
+{
+    _spi = pSpi;
+    _front->SetMdSpi(pSpi);
+}
+
+int LoopbackMdApi::SubscribeMarketData(char *ppInstrumentID[], int nCount)
+{
+    CThostFtdcSpecificInstrumentField instrument;
+    for (int i = 0; i < nCount; i++) {
+        memset(&instrument, 0, sizeof instrument);
+        strncpy(instrument.InstrumentID, ppInstrumentID[i], sizeof instrument.InstrumentID - 1);
+        _spi->OnRspSubMarketData(&instrument, &g_rspOk, 0, i == nCount - 1);
+    }
+    return 0;
+}
+
+int LoopbackMdApi::UnSubscribeMarketData(char *ppInstrumentID[], int nCount)
+{
+    CThostFtdcSpecificInstrumentField instrument;
+    for (int i = 0; i < nCount; i++) {
+        memset(&instrument, 0, sizeof instrument);
+        strncpy(instrument.InstrumentID, ppInstrumentID[i], sizeof instrument.InstrumentID - 1);
+        _spi->OnRspUnSubMarketData(&instrument, &g_rspOk, 0, i == nCount - 1);
+    }
+    return 0;
+}
+
+int LoopbackMdApi::ReqUserLogin(CThostFtdcReqUserLoginField *pReqUserLoginField, int nRequestID)
+{
+    CThostFtdcRspUserLoginField rsp;
+    memset(&rsp, 0, sizeof rsp);
+    strncpy(rsp.TradingDay, BENCH_TRADING_DAY, sizeof rsp.TradingDay - 1);
+    strncpy(rsp.BrokerID, pReqUserLoginField->BrokerID, sizeof rsp.BrokerID - 1);
+    strncpy(rsp.UserID, pReqUserLoginField->UserID, sizeof rsp.UserID - 1);
+    _spi->OnRspUserLogin(&rsp, &g_rspOk, nRequestID, true);
+    return 0;
+}
+
+int LoopbackMdApi::ReqUserLogout(CThostFtdcUserLogoutField *pUserLogout, int nRequestID)
+{
+    _spi->OnRspUserLogout(pUserLogout, &g_rspOk, nRequestID, true);
+    return 0;
+}
+
+#pragma endregion // LoopbackMdApi
+
+#pragma region LoopbackTraderApi
+
+void LoopbackTraderApi::Release()
+{
+    delete this;
+}
+
+void LoopbackTraderApi::Init()
+{
+    if (_spi) _spi->OnFrontConnected();
+}
+
+const char *LoopbackTraderApi::GetTradingDay()
+{
+    return BENCH_TRADING_DAY;
+}
+
+int LoopbackTraderApi::ReqAuthenticate(CThostFtdcReqAuthenticateField *pReqAuthenticateField, int nRequestID)
+{
+    CThostFtdcRspAuthenticateField rsp;
+    memset(&rsp, 0, sizeof rsp);
+    strncpy(rsp.BrokerID, pReqAuthenticateField->BrokerID, sizeof rsp.BrokerID - 1);
+    strncpy(rsp.UserID, pReqAuthenticateField->UserID, sizeof rsp.UserID - 1);
+    _spi->OnRspAuthenticate(&rsp, &g_rspOk, nRequestID, true);
+    return 0;
+}
+
+int LoopbackTraderApi::ReqUserLogin(CThostFtdcReqUserLoginField *pReqUserLoginField, int nRequestID)
+{
+    CThostFtdcRspUserLoginField rsp;
+    memset(&rsp, 0, sizeof rsp);
+    strncpy(rsp.TradingDay, BENCH_TRADING_DAY, sizeof rsp.TradingDay - 1);
+    strncpy(rsp.BrokerID, pReqUserLoginField->BrokerID, sizeof rsp.BrokerID - 1);
+    strncpy(rsp.UserID, pReqUserLoginField->UserID, sizeof rsp.UserID - 1);
+    rsp.FrontID = 1;
+    rsp.SessionID = 1;
+    strncpy(rsp.MaxOrderRef, "0", sizeof rsp.MaxOrderRef - 1);
+    _spi->OnRspUserLogin(&rsp, &g_rspOk, nRequestID, true);
+    return 0;
+}
+
+int LoopbackTraderApi::ReqUserLogout(CThostFtdcUserLogoutField *pUserLogout, int nRequestID)
+{
+    _spi->OnRspUserLogout(pUserLogout, &g_rspOk, nRequestID, true);
+    return 0;
+}
+
+int LoopbackTraderApi::ReqSettlementInfoConfirm(CThostFtdcSettlementInfoConfirmField *pSettlementInfoConfirm, int nRequestID)
+{
+    _spi->OnRspSettlementInfoConfirm(pSettlementInfoConfirm, &g_rspOk, nRequestID, true);
+    return 0;
+}
+
+int LoopbackTraderApi::ReqOrderInsert(CThostFtdcInputOrderField *pInputOrder, int nRequestID)
+{
+    _front->OnOrderInsert();
+    return 0;
+}
+
+// 查询都返回空结果
+int LoopbackTraderApi::ReqQryOrder(CThostFtdcQryOrderField *pQryOrder, int nRequestID)
+{
+    _spi->OnRspQryOrder(nullptr, &g_rspOk, nRequestID, true);
+    return 0;
+}
+
+int LoopbackTraderApi::ReqQryTrade(CThostFtdcQryTradeField *pQryTrade, int nRequestID)
+{
+    _spi->OnRspQryTrade(nullptr, &g_rspOk, nRequestID, true);
+    return 0;
+}
+
+int LoopbackTraderApi::ReqQryInvestorPosition(CThostFtdcQryInvestorPositionField *pQryInvestorPosition, int nRequestID)
+{
+    _spi->OnRspQryInvestorPosition(nullptr, &g_rspOk, nRequestID, true);
+    return 0;
+}
+
+int LoopbackTraderApi::ReqQryInvestorPositionDetail(CThostFtdcQryInvestorPositionDetailField *pQryInvestorPositionDetail, int nRequestID)
+{
+    _spi->OnRspQryInvestorPositionDetail(nullptr, &g_rspOk, nRequestID, true);
+    return 0;
+}
+
+int LoopbackTraderApi::ReqQryTradingAccount(CThostFtdcQryTradingAccountField *pQryTradingAccount, int nRequestID)
+{
+    _spi->OnRspQryTradingAccount(nullptr, &g_rspOk, nRequestID, true);
+    return 0;
+}
+
+int LoopbackTraderApi::ReqQryInstrument(CThostFtdcQryInstrumentField *pQryInstrument, int nRequestID)
+{
+    _spi->OnRspQryInstrument(nullptr, &g_rspOk, nRequestID, true);
+    return 0;
+}
+
+int LoopbackTraderApi::ReqQryProduct(CThostFtdcQryProductField *pQryProduct, int nRequestID)
+{
+    _spi->OnRspQryProduct(nullptr, &g_rspOk, nRequestID, true);
+    return 0;
+}
+
+int LoopbackTraderApi::ReqQryDepthMarketData(CThostFtdcQryDepthMarketDataField *pQryDepthMarketData, int nRequestID)
+{
+    _spi->OnRspQryDepthMarketData(nullptr, &g_rspOk, nRequestID, true);
+    return 0;
+}
+
+#pragma endregion // LoopbackTraderApi
@@ -0,0 +1,208 @@
+/*
+ * Copyright 2019 Holmes Conan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <cstdint>
+#include "ThostFtdcMdApi.h"
+#include "ThostFtdcTraderApi.h"
+#include "latency.h"
+
+/*
+ * In-process stand-in for the CTP fronts, selected with a `loopback://`
+ * address, to measure tick-to-order latency without a network.
+ *
+ * Synthetic depth updates (see DepthStream) are injected on a thread of their
+ * own, like the API's network thread. The injection time is the entry of the
+ * events built from the update (LatencyStats::Entry), so a ReqOrderInsert made
+ * while one of them is dispatched records the time from the injection of the
+ * update that caused it to the request leaving the client. Logins, settlement
+ * confirmation and queries are answered at once with empty results; orders
+ * get no responses.
+ */
+class LoopbackFront
+{
+    mutable std::mutex _mutex;
+    Histogram _tickToOrder;
+    std::atomic<uint64_t> _injected{0};
+    std::atomic<uint64_t> _orders{0};
+    double _seconds = 0.0;
+    std::atomic<CThostFtdcMdSpi*> _mdSpi{nullptr};
+    std::atomic_bool _nativeStrategy{false};
+    std::atomic_bool _running{false};
+    std::atomic_bool _stop{false};
+    std::thread _injector;
+
+    void Inject(CThostFtdcMdSpi *spi, size_t instruments, size_t updates, double rate);
+
+public:
+    LoopbackFront() = default;
+    LoopbackFront(const LoopbackFront&) = delete;
+    LoopbackFront& operator=(const LoopbackFront&) = delete;
+    ~LoopbackFront();
+
+    static bool IsLoopback(const std::string &addr);
+
+    inline void SetMdSpi(CThostFtdcMdSpi *spi) { _mdSpi.store(spi, std::memory_order_release); }
+    // The native strategy is installed by CtpClient::Init.
+    inline bool IsNativeStrategy() const { return _nativeStrategy.load(std::memory_order_relaxed); }
+    inline void SetNativeStrategy(bool enabled) { _nativeStrategy.store(enabled, std::memory_order_relaxed); }
+    inline bool IsRunning() const { return _running.load(std::memory_order_acquire); }
+
+    // Injects `updates` updates of `instruments` instruments, `rate` per second (0 for as fast as possible).
+    void Start(size_t instruments, size_t updates, double rate);
+    void Stop();
+    // Orders made outside of the dispatch of an injected update are counted but not timed.
+    void OnOrderInsert();
+
+    // tick_to_order percentiles in nanoseconds, plus injected/orders/seconds/rate.
+    std::map<std::string, double> GetStats() const;
+    void Reset();
+};
+
+class LoopbackMdApi final : public CThostFtdcMdApi
+{
+    LoopbackFront *_front;
+    CThostFtdcMdSpi *_spi = nullptr;
+
+public:
+    explicit LoopbackMdApi(LoopbackFront *front) : _front(front) {}
+
+    void Release() override;
+    void Init() override;
+    int Join() override { return 0; }
+    const char *GetTradingDay() override;
+    void RegisterFront(char *) override {}
+    void RegisterNameServer(char *) override {}
+    void RegisterFensUserInfo(CThostFtdcFensUserInfoField *) override {}
+    void RegisterSpi(CThostFtdcMdSpi *pSpi) override;
+    int SubscribeMarketData(char *ppInstrumentID[], int nCount) override;
+    int UnSubscribeMarketData(char *ppInstrumentID[], int nCount) override;
+    int SubscribeForQuoteRsp(char *[], int) override { return 0; }
+    int UnSubscribeForQuoteRsp(char *[], int) override { return 0; }
+    int ReqUserLogin(CThostFtdcReqUserLoginField *pReqUserLoginField, int nRequestID) override;
+    int ReqUserLogout(CThostFtdcUserLogoutField *pUserLogout, int nRequestID) override;
+};
+
+class LoopbackTraderApi final : public CThostFtdcTraderApi
+{
+    LoopbackFront *_front;
+    CThostFtdcTraderSpi *_spi = nullptr;
+
+public:
+    explicit LoopbackTraderApi(LoopbackFront *front) : _front(front) {}
+
+    void Release() override;
+    void Init() override;
+    int Join() override { return 0; }
+    const char *GetTradingDay() override;
+    void RegisterFront(char *) override {}
+    void RegisterNameServer(char *) override {}
+    void RegisterFensUserInfo(CThostFtdcFensUserInfoField *) override {}
+    void RegisterSpi(CThostFtdcTraderSpi *pSpi) override { _spi = pSpi; }
+    void SubscribePrivateTopic(THOST_TE_RESUME_TYPE) override {}
+    void SubscribePublicTopic(THOST_TE_RESUME_TYPE) override {}
+    int RegisterUserSystemInfo(CThostFtdcUserSystemInfoField *) override { return 0; }
+    int SubmitUserSystemInfo(CThostFtdcUserSystemInfoField *) override { return 0; }
+
+    int ReqAuthenticate(CThostFtdcReqAuthenticateField *pReqAuthenticateField, int nRequestID) override;
+    int ReqUserLogin(CThostFtdcReqUserLoginField *pReqUserLoginField, int nRequestID) override;
+    int ReqUserLogout(CThostFtdcUserLogoutField *pUserLogout, int nRequestID) override;
+    int ReqSettlementInfoConfirm(CThostFtdcSettlementInfoConfirmField *pSettlementInfoConfirm, int nRequestID) override;
+    int ReqOrderInsert(CThostFtdcInputOrderField *pInputOrder, int nRequestID) override;
+    int ReqOrderAction(CThostFtdcInputOrderActionField *, int) override { return 0; }
+    int ReqQryOrder(CThostFtdcQryOrderField *pQryOrder, int nRequestID) override;
+    int ReqQryTrade(CThostFtdcQryTradeField *pQryTrade, int nRequestID) override;
+    int ReqQryInvestorPosition(CThostFtdcQryInvestorPositionField *pQryInvestorPosition, int nRequestID) override;
+    int ReqQryInvestorPositionDetail(CThostFtdcQryInvestorPositionDetailField *pQryInvestorPositionDetail, int nRequestID) override;
+    int ReqQryTradingAccount(CThostFtdcQryTradingAccountField *pQryTradingAccount, int nRequestID) override;
+    int ReqQryInstrument(CThostFtdcQryInstrumentField *pQryInstrument, int nRequestID) override;
+    int ReqQryProduct(CThostFtdcQryProductField *pQryProduct, int nRequestID) override;
+    int ReqQryDepthMarketData(CThostFtdcQryDepthMarketDataField *pQryDepthMarketData, int nRequestID) override;
+
+    // 其余请求不会被调用，直接返回成功
+    int ReqUserPasswordUpdate(CThostFtdcUserPasswordUpdateField *, int) override { return 0; }
+    int ReqTradingAccountPasswordUpdate(CThostFtdcTradingAccountPasswordUpdateField *, int) override { return 0; }
+    int ReqUserAuthMethod(CThostFtdcReqUserAuthMethodField *, int) override { return 0; }
+    int ReqGenUserCaptcha(CThostFtdcReqGenUserCaptchaField *, int) override { return 0; }
+    int ReqGenUserText(CThostFtdcReqGenUserTextField *, int) override { return 0; }
+    int ReqUserLoginWithCaptcha(CThostFtdcReqUserLoginWithCaptchaField *, int) override { return 0; }
+    int ReqUserLoginWithText(CThostFtdcReqUserLoginWithTextField *, int) override { return 0; }
+    int ReqUserLoginWithOTP(CThostFtdcReqUserLoginWithOTPField *, int) override { return 0; }
+    int ReqParkedOrderInsert(CThostFtdcParkedOrderField *, int) override { return 0; }
+    int ReqParkedOrderAction(CThostFtdcParkedOrderActionField *, int) override { return 0; }
+    int ReqQueryMaxOrderVolume(CThostFtdcQueryMaxOrderVolumeField *, int) override { return 0; }
+    int ReqRemoveParkedOrder(CThostFtdcRemoveParkedOrderField *, int) override { return 0; }
+    int ReqRemoveParkedOrderAction(CThostFtdcRemoveParkedOrderActionField *, int) override { return 0; }
+    int ReqExecOrderInsert(CThostFtdcInputExecOrderField *, int) override { return 0; }
+    int ReqExecOrderAction(CThostFtdcInputExecOrderActionField *, int) override { return 0; }
+    int ReqForQuoteInsert(CThostFtdcInputForQuoteField *, int) override { return 0; }
+    int ReqQuoteInsert(CThostFtdcInputQuoteField *, int) override { return 0; }
+    int ReqQuoteAction(CThostFtdcInputQuoteActionField *, int) override { return 0; }
+    int ReqBatchOrderAction(CThostFtdcInputBatchOrderActionField *, int) override { return 0; }
+    int ReqOptionSelfCloseInsert(CThostFtdcInputOptionSelfCloseField *, int) override { return 0; }
+    int ReqOptionSelfCloseAction(CThostFtdcInputOptionSelfCloseActionField *, int) override { return 0; }
+    int ReqCombActionInsert(CThostFtdcInputCombActionField *, int) override { return 0; }
+    int ReqQryInvestor(CThostFtdcQryInvestorField *, int) override { return 0; }
+    int ReqQryTradingCode(CThostFtdcQryTradingCodeField *, int) override { return 0; }
+    int ReqQryInstrumentMarginRate(CThostFtdcQryInstrumentMarginRateField *, int) override { return 0; }
+    int ReqQryInstrumentCommissionRate(CThostFtdcQryInstrumentCommissionRateField *, int) override { return 0; }
+    int ReqQryExchange(CThostFtdcQryExchangeField *, int) override { return 0; }
+    int ReqQrySettlementInfo(CThostFtdcQrySettlementInfoField *, int) override { return 0; }
+    int ReqQryTransferBank(CThostFtdcQryTransferBankField *, int) override { return 0; }
+    int ReqQryNotice(CThostFtdcQryNoticeField *, int) override { return 0; }
+    int ReqQrySettlementInfoConfirm(CThostFtdcQrySettlementInfoConfirmField *, int) override { return 0; }
+    int ReqQryInvestorPositionCombineDetail(CThostFtdcQryInvestorPositionCombineDetailField *, int) override { return 0; }
+    int ReqQryCFMMCTradingAccountKey(CThostFtdcQryCFMMCTradingAccountKeyField *, int) override { return 0; }
+    int ReqQryEWarrantOffset(CThostFtdcQryEWarrantOffsetField *, int) override { return 0; }
+    int ReqQryInvestorProductGroupMargin(CThostFtdcQryInvestorProductGroupMarginField *, int) override { return 0; }
+    int ReqQryExchangeMarginRate(CThostFtdcQryExchangeMarginRateField *, int) override { return 0; }
+    int ReqQryExchangeMarginRateAdjust(CThostFtdcQryExchangeMarginRateAdjustField *, int) override { return 0; }
+    int ReqQryExchangeRate(CThostFtdcQryExchangeRateField *, int) override { return 0; }
+    int ReqQrySecAgentACIDMap(CThostFtdcQrySecAgentACIDMapField *, int) override { return 0; }
+    int ReqQryProductExchRate(CThostFtdcQryProductExchRateField *, int) override { return 0; }
+    int ReqQryProductGroup(CThostFtdcQryProductGroupField *, int) override { return 0; }
+    int ReqQryMMInstrumentCommissionRate(CThostFtdcQryMMInstrumentCommissionRateField *, int) override { return 0; }
+    int ReqQryMMOptionInstrCommRate(CThostFtdcQryMMOptionInstrCommRateField *, int) override { return 0; }
+    int ReqQryInstrumentOrderCommRate(CThostFtdcQryInstrumentOrderCommRateField *, int) override { return 0; }
+    int ReqQrySecAgentTradingAccount(CThostFtdcQryTradingAccountField *, int) override { return 0; }
+    int ReqQrySecAgentCheckMode(CThostFtdcQrySecAgentCheckModeField *, int) override { return 0; }
+    int ReqQrySecAgentTradeInfo(CThostFtdcQrySecAgentTradeInfoField *, int) override { return 0; }
+    int ReqQryOptionInstrTradeCost(CThostFtdcQryOptionInstrTradeCostField *, int) override { return 0; }
+    int ReqQryOptionInstrCommRate(CThostFtdcQryOptionInstrCommRateField *, int) override { return 0; }
+    int ReqQryExecOrder(CThostFtdcQryExecOrderField *, int) override { return 0; }
+    int ReqQryForQuote(CThostFtdcQryForQuoteField *, int) override { return 0; }
+    int ReqQryQuote(CThostFtdcQryQuoteField *, int) override { return 0; }
+    int ReqQryOptionSelfClose(CThostFtdcQryOptionSelfCloseField *, int) override { return 0; }
+    int ReqQryInvestUnit(CThostFtdcQryInvestUnitField *, int) override { return 0; }
+    int ReqQryCombInstrumentGuard(CThostFtdcQryCombInstrumentGuardField *, int) override { return 0; }
+    int ReqQryCombAction(CThostFtdcQryCombActionField *, int) override { return 0; }
+    int ReqQryTransferSerial(CThostFtdcQryTransferSerialField *, int) override { return 0; }
+    int ReqQryAccountregister(CThostFtdcQryAccountregisterField *, int) override { return 0; }
+    int ReqQryContractBank(CThostFtdcQryContractBankField *, int) override { return 0; }
+    int ReqQryParkedOrder(CThostFtdcQryParkedOrderField *, int) override { return 0; }
+    int ReqQryParkedOrderAction(CThostFtdcQryParkedOrderActionField *, int) override { return 0; }
+    int ReqQryTradingNotice(CThostFtdcQryTradingNoticeField *, int) override { return 0; }
+    int ReqQryBrokerTradingParams(CThostFtdcQryBrokerTradingParamsField *, int) override { return 0; }
+    int ReqQryBrokerTradingAlgos(CThostFtdcQryBrokerTradingAlgosField *, int) override { return 0; }
+    int ReqQueryCFMMCTradingAccountToken(CThostFtdcQueryCFMMCTradingAccountTokenField *, int) override { return 0; }
+    int ReqFromBankToFutureByFuture(CThostFtdcReqTransferField *, int) override { return 0; }
+    int ReqFromFutureToBankByFuture(CThostFtdcReqTransferField *, int) override { return 0; }
+    int ReqQueryBankAccountMoneyByFuture(CThostFtdcReqQueryAccountField *, int) override { return 0; }
+};
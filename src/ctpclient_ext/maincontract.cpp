@@ -0,0 +1,236 @@
+/*
+ * Copyright 2019 Holmes Conan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <cctype>
+#include <cstring>
+#include <algorithm>
+#include "maincontract.h"
+#include "symbols.h"
+
+namespace {
+
+TThostFtdcPriceType CThostFtdcDepthMarketDataField::* const ADJUSTED_PRICES[] = {
+    &CThostFtdcDepthMarketDataField::LastPrice,
+    &CThostFtdcDepthMarketDataField::PreSettlementPrice,
+    &CThostFtdcDepthMarketDataField::PreClosePrice,
+    &CThostFtdcDepthMarketDataField::OpenPrice,
+    &CThostFtdcDepthMarketDataField::HighestPrice,
+    &CThostFtdcDepthMarketDataField::LowestPrice,
+    &CThostFtdcDepthMarketDataField::ClosePrice,
+    &CThostFtdcDepthMarketDataField::SettlementPrice,
+    &CThostFtdcDepthMarketDataField::UpperLimitPrice,
+    &CThostFtdcDepthMarketDataField::LowerLimitPrice,
+    &CThostFtdcDepthMarketDataField::BidPrice1,
+    &CThostFtdcDepthMarketDataField::AskPrice1,
+    &CThostFtdcDepthMarketDataField::BidPrice2,
+    &CThostFtdcDepthMarketDataField::AskPrice2,
+    &CThostFtdcDepthMarketDataField::BidPrice3,
+    &CThostFtdcDepthMarketDataField::AskPrice3,
+    &CThostFtdcDepthMarketDataField::BidPrice4,
+    &CThostFtdcDepthMarketDataField::AskPrice4,
+    &CThostFtdcDepthMarketDataField::BidPrice5,
+    &CThostFtdcDepthMarketDataField::AskPrice5
+};
+
+// "IF2006" -> "IF", used when the instrument is not in the catalog.
+std::string ProductPrefix(const std::string &instrumentId)
+{
+    size_t n = 0;
+    while (n < instrumentId.size() && std::isalpha(static_cast<unsigned char>(instrumentId[n]))) {
+        n++;
+    }
+    return instrumentId.substr(0, n);
+}
+
+}
+
+void MainContractResolver::Add(const std::string &productId, const std::string &mainId, const std::string &leader, bool adjust, double threshold)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto &product = _products[productId];
+    product.productId = productId;
+    product.mainId = mainId;
+    product.mainSymbolId = SymbolTable::Instance().Intern(mainId.c_str());
+    product.adjust = adjust;
+    product.threshold = threshold;
+    product.leader = leader;
+
+    // Instruments seen before may belong to the new product.
+    _instruments.clear();
+    _enabled.store(true, std::memory_order_release);
+}
+
+MainContractResolver::Product* MainContractResolver::Find(const char *instrumentId)
+{
+    auto iter = _instruments.find(instrumentId);
+    if (iter != _instruments.end()) {
+        return iter->second;
+    }
+
+    std::string productId = _productOf ? _productOf(instrumentId) : std::string();
+    if (productId.empty()) {
+        productId = ProductPrefix(instrumentId);
+    }
+
+    auto productIter = _products.find(productId);
+    Product *product = productIter == _products.end() ? nullptr : &productIter->second;
+    _instruments.emplace(instrumentId, product);
+    return product;
+}
+
+bool MainContractResolver::Beats(const Product &product, const std::string &challenger, const std::string &leader) const
+{
+    auto &c = product.contracts.at(challenger);
+    auto &l = product.contracts.at(leader);
+    if (c.OpenInterest > l.OpenInterest * product.threshold) return true;
+    return c.OpenInterest == l.OpenInterest && c.Volume > l.Volume;
+}
+
+void MainContractResolver::Roll(Product &product, const std::string &leader, const CThostFtdcDepthMarketDataField *pDepthMarketData, MainContractRoll &roll)
+{
+    memset(&roll, 0, sizeof roll);
+    strncpy(roll.ProductID, product.productId.c_str(), sizeof roll.ProductID - 1);
+    strncpy(roll.InstrumentID, product.mainId.c_str(), sizeof roll.InstrumentID - 1);
+    strncpy(roll.OldInstrumentID, product.leader.c_str(), sizeof roll.OldInstrumentID - 1);
+    strncpy(roll.NewInstrumentID, leader.c_str(), sizeof roll.NewInstrumentID - 1);
+    memcpy(roll.TradingDay, pDepthMarketData->TradingDay, sizeof roll.TradingDay);
+    memcpy(roll.UpdateTime, pDepthMarketData->UpdateTime, sizeof roll.UpdateTime);
+
+    auto iter = product.contracts.find(product.leader);
+    if (iter != product.contracts.end()) {
+        auto &prev = iter->second;
+        auto &next = product.contracts[leader];
+        if (IsValidPrice(prev.LastPrice) && IsValidPrice(next.LastPrice)) {
+            roll.PriceGap = next.LastPrice - prev.LastPrice;
+        }
+
+        // 保持主力连续合约的累计成交量/成交额连续
+        product.volumeOffset += prev.Volume - next.Volume;
+        product.turnoverOffset += prev.Turnover - next.Turnover;
+        if (product.adjust) {
+            product.priceOffset -= roll.PriceGap;
+        }
+    }
+
+    product.leader = leader;
+}
+
+bool MainContractResolver::Update(const CThostFtdcDepthMarketDataField *pDepthMarketData, MarketDataEvent &main, MainContractRoll &roll, bool &rolled)
+{
+    rolled = false;
+    if (!_enabled.load(std::memory_order_acquire)) return false;
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    Product *product = Find(pDepthMarketData->InstrumentID);
+    if (product == nullptr) return false;
+
+    if (product->tradingDay != pDepthMarketData->TradingDay) {
+        // 新交易日累计成交量从零开始
+        product->tradingDay = pDepthMarketData->TradingDay;
+        product->volumeOffset = 0;
+        product->turnoverOffset = 0;
+        for (auto &kv : product->contracts) {
+            kv.second.Volume = 0;
+            kv.second.Turnover = 0;
+        }
+    }
+
+    std::string instrumentId(pDepthMarketData->InstrumentID);
+    auto &contract = product->contracts[instrumentId];
+    contract.OpenInterest = pDepthMarketData->OpenInterest;
+    contract.Volume = pDepthMarketData->Volume;
+    contract.Turnover = pDepthMarketData->Turnover;
+    if (IsValidPrice(pDepthMarketData->LastPrice)) {
+        contract.LastPrice = pDepthMarketData->LastPrice;
+    }
+
+    if (product->contracts.count(product->leader) == 0) {
+        // 第一个行情，或者指定的主力合约还没有行情
+        if (product->leader.empty() || product->leader == instrumentId) {
+            Roll(*product, instrumentId, pDepthMarketData, roll);
+            rolled = true;
+        }
+    } else if (instrumentId != product->leader) {
+        if (Beats(*product, instrumentId, product->leader)) {
+            Roll(*product, instrumentId, pDepthMarketData, roll);
+            rolled = true;
+        }
+    } else {
+        // The leader itself changed, any other contract may be ahead now.
+        std::string best = product->leader;
+        for (auto &kv : product->contracts) {
+            if (kv.first != best && Beats(*product, kv.first, best)) {
+                best = kv.first;
+            }
+        }
+        if (best != product->leader) {
+            Roll(*product, best, pDepthMarketData, roll);
+            rolled = true;
+        }
+    }
+
+    if (instrumentId != product->leader) return false;
+
+    memcpy(&main, pDepthMarketData, sizeof *pDepthMarketData);
+    memset(main.InstrumentID, 0, sizeof main.InstrumentID);
+    strncpy(main.InstrumentID, product->mainId.c_str(), sizeof main.InstrumentID - 1);
+    main.SymbolId = product->mainSymbolId;
+    main.Volume += product->volumeOffset;
+    main.Turnover += product->turnoverOffset;
+    if (product->adjust && product->priceOffset != 0.0) {
+        for (auto field : ADJUSTED_PRICES) {
+            if (IsValidPrice(main.*field)) {
+                main.*field += product->priceOffset;
+            }
+        }
+    }
+    return true;
+}
+
+bool MainContractResolver::IsMainId(const std::string &instrumentId) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (auto &kv : _products) {
+        if (kv.second.mainId == instrumentId) return true;
+    }
+    return false;
+}
+
+std::string MainContractResolver::GetLeader(const std::string &productId) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto iter = _products.find(productId);
+    return iter == _products.end() ? std::string() : iter->second.leader;
+}
+
+std::vector<std::tuple<std::string, double, int>> MainContractResolver::GetRanking(const std::string &productId) const
+{
+    std::vector<std::tuple<std::string, double, int>> v;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto iter = _products.find(productId);
+        if (iter == _products.end()) return v;
+
+        for (auto &kv : iter->second.contracts) {
+            v.emplace_back(kv.first, kv.second.OpenInterest, kv.second.Volume);
+        }
+    }
+
+    std::sort(v.begin(), v.end(), [](const std::tuple<std::string, double, int> &a, const std::tuple<std::string, double, int> &b) {
+        if (std::get<1>(a) != std::get<1>(b)) return std::get<1>(a) > std::get<1>(b);
+        return std::get<2>(a) > std::get<2>(b);
+    });
+    return v;
+}
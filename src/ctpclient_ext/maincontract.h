@@ -0,0 +1,101 @@
+/*
+ * Copyright 2019 Holmes Conan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <tuple>
+#include <string>
+#include <vector>
+#include <functional>
+#include <unordered_map>
+#include "ThostFtdcUserApiStruct.h"
+#include "bar.h"
+
+struct MainContractRoll {
+    TThostFtdcInstrumentIDType ProductID;
+    TThostFtdcInstrumentIDType InstrumentID;
+    TThostFtdcInstrumentIDType OldInstrumentID;
+    TThostFtdcInstrumentIDType NewInstrumentID;
+    TThostFtdcDateType TradingDay;
+    TThostFtdcTimeType UpdateTime;
+    TThostFtdcPriceType PriceGap;
+};
+
+/*
+ * Ranks the contracts of each tracked product by open interest (then volume)
+ * from the live depth stream and synthesizes a continuous main contract.
+ *
+ * The continuous contract is a copy of the leader's depth record renamed to
+ * `MainID`. Its cumulative Volume/Turnover carry an offset that is rebased at
+ * each roll, so 1 minute bars built from it stay exact across rolls. With
+ * `adjust`, prices also carry the accumulated roll gaps so the series has no
+ * jump at rolls.
+ */
+class MainContractResolver
+{
+public:
+    using ProductOf = std::function<std::string(const std::string&)>;
+
+private:
+    struct Contract {
+        TThostFtdcLargeVolumeType OpenInterest = 0;
+        TThostFtdcVolumeType Volume = 0;
+        TThostFtdcMoneyType Turnover = 0;
+        TThostFtdcPriceType LastPrice = 0;
+    };
+
+    struct Product {
+        std::string productId;
+        std::string mainId;
+        uint32_t mainSymbolId = 0;
+        bool adjust = false;
+        double threshold = 1.0;
+        std::string leader;
+        std::string tradingDay;
+        std::map<std::string, Contract> contracts;
+        TThostFtdcPriceType priceOffset = 0;
+        TThostFtdcVolumeType volumeOffset = 0;
+        TThostFtdcMoneyType turnoverOffset = 0;
+    };
+
+    mutable std::mutex _mutex;
+    std::atomic_bool _enabled{false};
+    std::map<std::string, Product> _products;
+    // instrument -> product, nullptr for instruments of untracked products
+    std::unordered_map<std::string, Product*> _instruments;
+    ProductOf _productOf;
+
+    Product* Find(const char *instrumentId);
+    bool Beats(const Product &product, const std::string &challenger, const std::string &leader) const;
+    void Roll(Product &product, const std::string &leader, const CThostFtdcDepthMarketDataField *pDepthMarketData, MainContractRoll &roll);
+
+public:
+    MainContractResolver() = default;
+    MainContractResolver(const MainContractResolver&) = delete;
+    MainContractResolver& operator=(const MainContractResolver&) = delete;
+
+    inline void SetProductOf(ProductOf productOf) { _productOf = productOf; }
+
+    void Add(const std::string &productId, const std::string &mainId, const std::string &leader, bool adjust, double threshold);
+    // Returns true when `pDepthMarketData` belongs to the leader; `main` is then the continuous
+    // contract's record, with the symbol id interned by Add. `rolled` is set when the leader changed on this update.
+    bool Update(const CThostFtdcDepthMarketDataField *pDepthMarketData, MarketDataEvent &main, MainContractRoll &roll, bool &rolled);
+
+    bool IsMainId(const std::string &instrumentId) const;
+    std::string GetLeader(const std::string &productId) const;
+    std::vector<std::tuple<std::string, double, int>> GetRanking(const std::string &productId) const;
+};
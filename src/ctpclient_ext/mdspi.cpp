@@ -14,12 +14,17 @@
  * limitations under the License.
  */
 #include <iostream>
+#include <algorithm>
 #include "mdspi.h"
 #include "ctpclient.h"
 
 MdSpi::MdSpi(CtpClient *client) : _client(client)
 {
-    //
+    _m1.SetSinks([this](const M1Bar &bar) {
+        _client->Enqueue(CtpClient::ResponseType::On1Min, &bar);
+    }, [this](const MarketDataRecovery &recovery) {
+        _client->Enqueue(CtpClient::ResponseType::OnMarketDataRecovery, &recovery);
+    });
 }
 
 MdSpi::~MdSpi()
@@ -29,6 +34,8 @@ MdSpi::~MdSpi()
 
 void MdSpi::OnFrontConnected()
 {
+    _client->_arbiter.SetConnected(0, true);
+
     CtpClient::Response r;
     memset(&r, 0, sizeof r);
     r.type = CtpClient::ResponseType::OnMdFrontConnected;
@@ -37,6 +44,12 @@ void MdSpi::OnFrontConnected()
 
 void MdSpi::OnFrontDisconnected(int nReason)
 {
+    _client->_arbiter.SetConnected(0, false);
+    // 冗余前置仍在推送时没有缺口
+    if (!_client->_arbiter.IsAnyConnected()) {
+        MarkStale();
+    }
+
     CtpClient::Response r;
     memset(&r, 0, sizeof r);
     r.type = CtpClient::ResponseType::OnMdFrontDisconnected;
@@ -66,73 +79,258 @@ void MdSpi::OnRspUnSubMarketData(CThostFtdcSpecificInstrumentField *pSpecificIns
 
 void MdSpi::OnRtnDepthMarketData(CThostFtdcDepthMarketDataField *pDepthMarketData)
 {
-    _client->Enqueue(CtpClient::ResponseType::OnRtnMarketData, pDepthMarketData, nullptr, 0, true);
+    OnDepth(pDepthMarketData, 0);
+}
+
+void MdSpi::OnDepth(CThostFtdcDepthMarketDataField *pDepthMarketData, size_t front)
+{
+    LatencyStats::Entry entry(_client->_latency);
+
+    // 多个前置同时推送时，去重和发布在同一把锁内完成，保持分钟线等状态的顺序
+    std::unique_lock<std::mutex> lock(_publishMutex, std::defer_lock);
+    if (_client->_arbiter.IsEnabled()) {
+        lock.lock();
+    }
+    // 每笔行情只查一次合约编号，随事件传递；订阅时已加入符号表，这里是无锁查找
+    uint32_t symbolId = SymbolTable::Instance().Intern(pDepthMarketData->InstrumentID);
+    if (_client->_arbiter.IsEnabled()) {
+        if (!_client->_arbiter.Accept(pDepthMarketData, symbolId, front)) return;
+    }
+    _client->_feed.Update(pDepthMarketData);
+
+    Publish(pDepthMarketData, symbolId);
+    Derive(pDepthMarketData);
+
+    // 主力连续合约
+    MarketDataEvent main;
+    MainContractRoll roll;
+    bool rolled = false;
+    bool isMain = _client->_mainContracts.Update(pDepthMarketData, main, roll, rolled);
+    if (rolled) {
+        _client->Enqueue(CtpClient::ResponseType::OnMainContractRoll, &roll);
+    }
+    if (isMain) {
+        // 排名和换月照常跟踪，主力连续合约的行情随掩码发布
+        if (_client->GetEventMask() & EM_All) {
+            Publish(&main, main.SymbolId);
+        }
+        Derive(&main);
+    }
+}
+
+void MdSpi::Derive(const CThostFtdcDepthMarketDataField *pDepthMarketData)
+{
+    // 合成合约只通过行情事件发布，掩码中没有行情事件时不必合成
+    if (_client->GetEventMask() & EM_All) {
+        _client->_composites.Update(pDepthMarketData, _composed);
+        for (auto &composed : _composed) {
+            Publish(&composed, composed.SymbolId);
+        }
+    }
+
+    _client->_spreads.Update(pDepthMarketData, _quotes);
+    for (auto &quote : _quotes) {
+        _client->Enqueue(CtpClient::ResponseType::OnSpreadQuote, &quote);
+    }
+}
+
+void MdSpi::Publish(const CThostFtdcDepthMarketDataField *pDepthMarketData, uint32_t symbolId)
+{
+    // 只构造用户需要的事件
+    uint32_t mask = _client->GetEventMask();
+    if ((mask & EM_All) == 0) return;
+
+    // 合并模式下只保留每个合约的最新状态，由 Join 统一取走
+    bool conflate = _client->_conflator.IsEnabled();
+    FlowControl::Slot *slot = nullptr, *quoteSlot = nullptr;
+    uint64_t seq = 0, quoteSeq = 0;
+    if (!conflate) {
+        // 紧凑行情有自己的队列和序号，任一队列已满时这笔行情整体转入合并槽
+        // 不限长度（默认）时不需要序号
+        auto &flow = _client->_flow;
+        if (flow.GetLimit() > 0) {
+            bool overflow = false;
+            if (mask & (EM_MarketData | EM_Tick | EM_1MinTick | EM_DepthTicks)) {
+                slot = flow.Find(pDepthMarketData->InstrumentID);
+                seq = flow.Next(*slot, overflow);
+                conflate = overflow;
+            }
+            if (mask & EM_Quote) {
+                quoteSlot = flow.Find(pDepthMarketData->InstrumentID, FlowControl::Quotes);
+                quoteSeq = flow.Next(*quoteSlot, overflow);
+                conflate = conflate || overflow;
+            }
+            // 槽中还有未取走的行情时后续行情也进入槽中，保持先后顺序
+            if (!conflate) {
+                conflate = _client->_conflator.IsPending(pDepthMarketData->InstrumentID);
+            }
+            if (!conflate) {
+                if (slot) flow.OnQueued(*slot, seq);
+                if (quoteSlot) flow.OnQueued(*quoteSlot, quoteSeq);
+            }
+        }
+    }
+    if (!conflate && (mask & EM_MarketData)) {
+        _client->EnqueueMarketData(pDepthMarketData, symbolId, slot, seq);
+    }
+
+    if (mask & EM_Quote) {
+        Quote quote;
+        ToQuote(pDepthMarketData, symbolId, quote);
+        _client->_quoteBook.Update(quote);
+        if (!conflate) {
+            _client->EnqueueQuote(quote, quoteSlot, quoteSeq);
+        }
+    }
+
+    // 定点价格
+    auto &scale = _client->_tickScale;
+    double tick = scale.IsEnabled() ? scale.Get(symbolId) : 0.0;
+    if (!conflate && tick > 0.0 && (mask & EM_DepthTicks)) {
+        DepthTicks depthTicks;
+        ToTicks(pDepthMarketData, symbolId, tick, depthTicks);
+        _client->EnqueueMarketData(CtpClient::ResponseType::OnDepthTicks, &depthTicks, slot, seq);
+    }
 
     TickBar tickBar;
     memset(&tickBar, 0, sizeof tickBar);
-    snprintf(tickBar.UpdateTime, 16, "%s.%03d", pDepthMarketData->UpdateTime, pDepthMarketData->UpdateMillisec);
-    strncpy(tickBar.TradingDay, pDepthMarketData->TradingDay, sizeof tickBar.TradingDay);
-    strncpy(tickBar.ActionDay, pDepthMarketData->ActionDay, sizeof tickBar.ActionDay);
-    strncpy(tickBar.InstrumentID, pDepthMarketData->InstrumentID, sizeof tickBar.InstrumentID);
-    tickBar.Price = pDepthMarketData->LastPrice;
-    tickBar.Volume = pDepthMarketData->Volume;
-    tickBar.Turnover = pDepthMarketData->Turnover;
-    tickBar.Position = pDepthMarketData->OpenInterest;
-    _client->Enqueue(CtpClient::ResponseType::OnTick, &tickBar);
+    if (mask & EM_Tick) {
+        snprintf(tickBar.UpdateTime, 16, "%s.%03d", pDepthMarketData->UpdateTime, pDepthMarketData->UpdateMillisec);
+        strncpy(tickBar.TradingDay, pDepthMarketData->TradingDay, sizeof tickBar.TradingDay);
+        strncpy(tickBar.ActionDay, pDepthMarketData->ActionDay, sizeof tickBar.ActionDay);
+        strncpy(tickBar.InstrumentID, pDepthMarketData->InstrumentID, sizeof tickBar.InstrumentID);
+        tickBar.SymbolId = symbolId;
+        tickBar.Price = pDepthMarketData->LastPrice;
+        tickBar.Volume = pDepthMarketData->Volume;
+        tickBar.Turnover = pDepthMarketData->Turnover;
+        tickBar.Position = pDepthMarketData->OpenInterest;
+        ToTicks(tickBar, tick);
+        if (!conflate) {
+            _client->EnqueueMarketData(CtpClient::ResponseType::OnTick, &tickBar, slot, seq);
+        }
+    }
 
     M1Bar m1Bar;
     memset(&m1Bar, 0, sizeof m1Bar);
-    memcpy(m1Bar.InstrumentID, pDepthMarketData->InstrumentID, sizeof m1Bar.InstrumentID);
-    memcpy(m1Bar.TradingDay, pDepthMarketData->TradingDay, sizeof m1Bar.TradingDay);
-    memcpy(m1Bar.ActionDay, pDepthMarketData->ActionDay, sizeof m1Bar.ActionDay);
-    memcpy(m1Bar.UpdateTime, pDepthMarketData->UpdateTime, 5);
-
-    std::string m1Now(m1Bar.UpdateTime);
-    std::string instrumentId(pDepthMarketData->InstrumentID);
-    auto price = pDepthMarketData->LastPrice;
-
-    auto iter = _m1Bars.find(instrumentId);
-    if (iter == _m1Bars.end()) {
-        m1Bar.OpenPrice = m1Bar.HighestPrice = m1Bar.LowestPrice = m1Bar.ClosePrice = price;
-        m1Bar.BaseVolume = pDepthMarketData->Volume;
-        m1Bar.BaseTurnover = pDepthMarketData->Turnover;
-        m1Bar.TickVolume = pDepthMarketData->Volume;
-        m1Bar.TickTurnover = pDepthMarketData->Turnover;
-        m1Bar.Volume = pDepthMarketData->Volume;
-        m1Bar.Turnover = pDepthMarketData->Turnover;
-        m1Bar.Position = pDepthMarketData->OpenInterest;
-        _m1Bars[instrumentId] = m1Bar;
-    } else {
-        auto &prev = iter->second;
-        if (m1Now == prev.UpdateTime) {
-            m1Bar.OpenPrice = prev.OpenPrice;
-            m1Bar.HighestPrice = price > prev.HighestPrice ? price : prev.HighestPrice;
-            m1Bar.LowestPrice = price < prev.LowestPrice ? price : prev.LowestPrice;
-            m1Bar.ClosePrice = price;
-            m1Bar.BaseVolume = prev.BaseVolume;
-            m1Bar.BaseTurnover = prev.BaseTurnover;
-        } else {
-            m1Bar.OpenPrice = m1Bar.HighestPrice = m1Bar.LowestPrice = m1Bar.ClosePrice = price;
-            m1Bar.BaseVolume = prev.TickVolume;
-            m1Bar.BaseTurnover = prev.TickTurnover;
-
-            _client->Enqueue(CtpClient::ResponseType::On1Min, &prev);
+    if (mask & (EM_1Min | EM_1MinTick)) {
+        _m1.Update(pDepthMarketData, symbolId, tick, m1Bar, (mask & EM_1Min) != 0);
+        if (!conflate && (mask & EM_1MinTick)) {
+            _client->EnqueueMarketData(CtpClient::ResponseType::On1MinTick, &m1Bar, slot, seq);
         }
+    }
 
-        m1Bar.TickVolume = pDepthMarketData->Volume;
-        m1Bar.TickTurnover = pDepthMarketData->Turnover;
-        m1Bar.Position = pDepthMarketData->OpenInterest;
-        m1Bar.Volume = m1Bar.TickVolume >= m1Bar.BaseVolume ? m1Bar.TickVolume - m1Bar.BaseVolume : m1Bar.TickVolume;
-        m1Bar.Turnover = m1Bar.TickTurnover >= m1Bar.BaseTurnover ? m1Bar.TickTurnover - m1Bar.BaseTurnover : m1Bar.TickTurnover;
-
-        memcpy(&prev, &m1Bar, sizeof m1Bar);
+    if (conflate) {
+        int64_t tsEntry = 0, tsEnqueue = 0;
+        _client->_latency.Stamp(tsEntry, tsEnqueue);
+        _client->_conflator.Update(pDepthMarketData, symbolId, tickBar, m1Bar, tsEntry, tsEnqueue);
     }
+}
+
+void MdSpi::MarkStale()
+{
+    _m1.MarkStale();
+}
+
+void MdSpi::Recover(const CThostFtdcDepthMarketDataField *pDepthMarketData)
+{
+    uint32_t mask = _client->GetEventMask();
+    if ((mask & (EM_1Min | EM_1MinTick)) == 0) return;
 
-    memcpy(m1Bar.UpdateTime, pDepthMarketData->UpdateTime, sizeof m1Bar.UpdateTime);
-    _client->Enqueue(CtpClient::ResponseType::On1MinTick, &m1Bar);
+    if (GetStaleCount() == 0) return;
+
+    uint32_t symbolId = SymbolTable::Instance().Intern(pDepthMarketData->InstrumentID);
+    auto &scale = _client->_tickScale;
+    double tick = scale.IsEnabled() ? scale.Get(symbolId) : 0.0;
+    _m1.Recover(pDepthMarketData, symbolId, tick, (mask & EM_1Min) != 0);
+}
+
+void MdSpi::FinishRecovery()
+{
+    _m1.FinishRecovery((_client->GetEventMask() & EM_1Min) != 0);
 }
 
 void MdSpi::OnRspError(CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
 {
     _client->Enqueue(CtpClient::ResponseType::OnMdError, pRspInfo, nRequestID, bIsLast);    
 }
+
+MdMirrorSpi::MdMirrorSpi(CtpClient *client, size_t front, const std::string &address)
+: _client(client), _front(front), _address(address)
+{
+    //
+}
+
+MdMirrorSpi::~MdMirrorSpi()
+{
+    if (_api) {
+        _api->RegisterSpi(nullptr);
+        _api->Release();
+    }
+}
+
+void MdMirrorSpi::Start(const std::string &flowPath)
+{
+    _api = CThostFtdcMdApi::CreateFtdcMdApi(flowPath.c_str(), /*using udp*/false, /*multicast*/false);
+    _api->RegisterSpi(this);
+    _api->RegisterFront(const_cast<char*>(_address.c_str()));
+    _api->Init();
+}
+
+void MdMirrorSpi::Send(const std::vector<std::string> &instrumentIds, bool subscribe)
+{
+    if (!_loggedIn) return;
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    size_t chunkSize = _client->GetSubscribeChunkSize();
+    for (size_t begin = 0; begin < instrumentIds.size(); begin += chunkSize) {
+        size_t end = std::min(begin + chunkSize, instrumentIds.size());
+        _instrumentIdBuffer.clear();
+        for (size_t i = begin; i < end; i++) {
+            _instrumentIdBuffer.push_back(const_cast<char*>(instrumentIds[i].c_str()));
+        }
+
+        // 冗余前置的订阅失败不影响主前置，断线重连后会重新订阅
+        if (subscribe) {
+            _api->SubscribeMarketData(_instrumentIdBuffer.data(), static_cast<int>(_instrumentIdBuffer.size()));
+        } else {
+            _api->UnSubscribeMarketData(_instrumentIdBuffer.data(), static_cast<int>(_instrumentIdBuffer.size()));
+        }
+    }
+}
+
+void MdMirrorSpi::OnFrontConnected()
+{
+    _client->_arbiter.SetConnected(_front, true);
+
+    CThostFtdcReqUserLoginField req;
+    memset(&req, 0, sizeof req);
+    strncpy(req.BrokerID, _client->_brokerId.c_str(), sizeof req.BrokerID);
+    strncpy(req.UserID, _client->_userId.c_str(), sizeof req.UserID);
+    strncpy(req.Password, _client->_password.c_str(), sizeof req.Password);
+    _api->ReqUserLogin(&req, 0);
+}
+
+void MdMirrorSpi::OnFrontDisconnected(int nReason)
+{
+    _loggedIn = false;
+    _client->_arbiter.SetConnected(_front, false);
+    if (!_client->_arbiter.IsAnyConnected()) {
+        _client->_mdSpi->MarkStale();
+    }
+}
+
+void MdMirrorSpi::OnRspUserLogin(CThostFtdcRspUserLoginField *pRspUserLogin, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
+{
+    if (pRspInfo && pRspInfo->ErrorID != 0) {
+        _client->Enqueue(CtpClient::ResponseType::OnMdError, pRspInfo, nRequestID, bIsLast);
+        return;
+    }
+
+    _loggedIn = true;
+    Send(_client->_subscriptions.GetDesired(), true);
+}
+
+void MdMirrorSpi::OnRtnDepthMarketData(CThostFtdcDepthMarketDataField *pDepthMarketData)
+{
+    _client->_mdSpi->OnDepth(pDepthMarketData, _front);
+}
@@ -15,17 +15,30 @@
  */
 #pragma once
 #include <map>
+#include <mutex>
+#include <atomic>
 #include <string>
+#include <vector>
 #include "ThostFtdcMdApi.h"
 #include "ThostFtdcUserApiStruct.h"
 #include "ThostFtdcUserApiDataType.h"
 #include "bar.h"
+#include "spread.h"
+#include "aggregator.h"
 
 class CtpClient;
 class MdSpi : public CThostFtdcMdSpi
 {
     CtpClient *_client;
-	std::map<std::string, M1Bar> _m1Bars;
+    M1Aggregator _m1;
+    std::vector<MarketDataEvent> _composed;
+    std::vector<SpreadQuote> _quotes;
+    std::mutex _publishMutex;
+
+    // Enqueues the depth record and the tick/1 minute bars built from it.
+    void Publish(const CThostFtdcDepthMarketDataField *pDepthMarketData, uint32_t symbolId);
+    // Publishes the composites and spread quotes which have `pDepthMarketData` as a leg.
+    void Derive(const CThostFtdcDepthMarketDataField *pDepthMarketData);
 public:
     MdSpi(CtpClient *client);
     MdSpi(const MdSpi&) = delete;
@@ -34,6 +47,16 @@ public:
     MdSpi& operator=(MdSpi&&) = delete;
     virtual ~MdSpi();
 
+    // Depth update from front `front`, 0 for the primary front.
+    void OnDepth(CThostFtdcDepthMarketDataField *pDepthMarketData, size_t front);
+    // Marks the bars of all instruments as stale after the feed was lost.
+    void MarkStale();
+    // Realigns a stale bar with a ReqQryDepthMarketData snapshot, called from the dispatch thread.
+    void Recover(const CThostFtdcDepthMarketDataField *pDepthMarketData);
+    // Last snapshot record received, the bars it did not realign start afresh.
+    void FinishRecovery();
+    inline size_t GetStaleCount() const { return _m1.GetStaleCount(); }
+
 public:
 	void OnFrontConnected() override;
 	void OnFrontDisconnected(int nReason) override;
@@ -44,4 +67,35 @@ public:
 	void OnRtnDepthMarketData(CThostFtdcDepthMarketDataField *pDepthMarketData) override;
 	void OnRspError(CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast) override;
 
-};
\ No newline at end of file
+};
+
+/*
+ * Redundant MD front. It logs in and follows the client's subscriptions on
+ * its own, and hands its depth updates to the primary front's MdSpi, which
+ * forwards the first arrival of each update.
+ */
+class MdMirrorSpi : public CThostFtdcMdSpi
+{
+    CtpClient *_client;
+    size_t _front;
+    std::string _address;
+    CThostFtdcMdApi *_api = nullptr;
+    std::atomic_bool _loggedIn{false};
+    std::mutex _mutex;
+    std::vector<char*> _instrumentIdBuffer;
+
+public:
+    MdMirrorSpi(CtpClient *client, size_t front, const std::string &address);
+    MdMirrorSpi(const MdMirrorSpi&) = delete;
+    MdMirrorSpi& operator=(const MdMirrorSpi&) = delete;
+    virtual ~MdMirrorSpi();
+
+    void Start(const std::string &flowPath);
+    void Send(const std::vector<std::string> &instrumentIds, bool subscribe);
+
+public:
+    void OnFrontConnected() override;
+    void OnFrontDisconnected(int nReason) override;
+    void OnRspUserLogin(CThostFtdcRspUserLoginField *pRspUserLogin, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast) override;
+    void OnRtnDepthMarketData(CThostFtdcDepthMarketDataField *pDepthMarketData) override;
+};
@@ -0,0 +1,166 @@
+/*
+ * Copyright 2019 Holmes Conan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+#include <new>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <cstddef>
+
+/*
+ * Free list of fixed size blocks. Blocks released by the last owner go back
+ * to the list, so once warmed up dispatching an event does not touch the
+ * heap. At most `MAX_FREE` blocks are kept to give memory back after bursts.
+ *
+ * Each thread keeps up to `LOCAL_MAX` blocks of its own and trades them with
+ * the shared list `BATCH` at a time, so the mutex is taken once per batch
+ * rather than per event. This also covers blocks allocated by the dispatch
+ * thread and released by another: they pile up locally and are handed back.
+ *
+ * The pools are never destroyed: Python may release events after static
+ * destruction has started.
+ */
+template<size_t Size>
+class BlockPool
+{
+    static const size_t MAX_FREE = 4096;
+    static const size_t LOCAL_MAX = 256;
+    static const size_t BATCH = LOCAL_MAX / 2;
+
+    struct Cache {
+        void *blocks[LOCAL_MAX];
+        size_t count = 0;
+    };
+
+    std::mutex _mutex;
+    std::vector<void*> _free;
+
+    BlockPool() { _free.reserve(MAX_FREE); }
+
+    // nullptr once the calling thread has started to exit.
+    static Cache* LocalCache() {
+        static thread_local bool exited = false;
+        struct Holder {
+            Cache cache;
+            ~Holder() {
+                exited = true;
+                Instance().Spill(cache, cache.count);
+            }
+        };
+        static thread_local Holder holder;
+        return exited ? nullptr : &holder.cache;
+    }
+
+    void Refill(Cache &cache) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        while (cache.count < BATCH && !_free.empty()) {
+            cache.blocks[cache.count++] = _free.back();
+            _free.pop_back();
+        }
+    }
+
+    // 共享链表已满的部分直接还给堆
+    void Spill(Cache &cache, size_t n) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        for (; n > 0; --n) {
+            void *p = cache.blocks[--cache.count];
+            if (_free.size() < MAX_FREE) {
+                _free.push_back(p);
+            } else {
+                ::operator delete(p);
+            }
+        }
+    }
+
+public:
+    BlockPool(const BlockPool&) = delete;
+    BlockPool& operator=(const BlockPool&) = delete;
+
+    static BlockPool& Instance() {
+        static BlockPool *pool = new BlockPool();
+        return *pool;
+    }
+
+    void* Allocate() {
+        Cache *cache = LocalCache();
+        if (cache) {
+            if (cache->count == 0) Refill(*cache);
+            if (cache->count > 0) return cache->blocks[--cache->count];
+        } else {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (!_free.empty()) {
+                void *p = _free.back();
+                _free.pop_back();
+                return p;
+            }
+        }
+        return ::operator new(Size);
+    }
+
+    void Deallocate(void *p) {
+        Cache *cache = LocalCache();
+        if (cache) {
+            if (cache->count == LOCAL_MAX) Spill(*cache, BATCH);
+            cache->blocks[cache->count++] = p;
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (_free.size() < MAX_FREE) {
+                _free.push_back(p);
+                return;
+            }
+        }
+        ::operator delete(p);
+    }
+
+};
+
+// Allocator for `std::allocate_shared`: the object and its control block share one pooled block.
+template<class T>
+struct PoolAllocator
+{
+    using value_type = T;
+
+    PoolAllocator() = default;
+    template<class U>
+    PoolAllocator(const PoolAllocator<U>&) {}
+
+    T* allocate(size_t n) {
+        if (n != 1) return static_cast<T*>(::operator new(n * sizeof(T)));
+        return static_cast<T*>(BlockPool<sizeof(T)>::Instance().Allocate());
+    }
+
+    void deallocate(T *p, size_t n) {
+        if (n != 1) {
+            ::operator delete(p);
+        } else {
+            BlockPool<sizeof(T)>::Instance().Deallocate(p);
+        }
+    }
+
+    template<class U>
+    bool operator==(const PoolAllocator<U>&) const { return true; }
+    template<class U>
+    bool operator!=(const PoolAllocator<U>&) const { return false; }
+};
+
+// Copy of a POD event handed to Python, allocated from the pool.
+template<class T>
+inline std::shared_ptr<T> MakeEvent(const T &event)
+{
+    return std::allocate_shared<T>(PoolAllocator<T>(), event);
+}
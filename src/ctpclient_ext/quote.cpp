@@ -0,0 +1,73 @@
+/*
+ * Copyright 2019 Holmes Conan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <cstdlib>
+#include <cstring>
+#include "quote.h"
+#include "bar.h"
+
+void ToQuote(const CThostFtdcDepthMarketDataField *p, uint32_t symbolId, Quote &quote)
+{
+    quote.SymbolId = symbolId;
+    quote.TradingDay = atoi(p->TradingDay);
+    quote.UpdateTime = ParseUpdateTime(p->UpdateTime, p->UpdateMillisec);
+    quote.Volume = p->Volume;
+    quote.LastPrice = p->LastPrice;
+    quote.Turnover = p->Turnover;
+    quote.OpenInterest = p->OpenInterest;
+    quote.UpperLimitPrice = p->UpperLimitPrice;
+    quote.LowerLimitPrice = p->LowerLimitPrice;
+
+    quote.BidPrice[0] = p->BidPrice1;
+    quote.BidPrice[1] = p->BidPrice2;
+    quote.BidPrice[2] = p->BidPrice3;
+    quote.BidPrice[3] = p->BidPrice4;
+    quote.BidPrice[4] = p->BidPrice5;
+    quote.AskPrice[0] = p->AskPrice1;
+    quote.AskPrice[1] = p->AskPrice2;
+    quote.AskPrice[2] = p->AskPrice3;
+    quote.AskPrice[3] = p->AskPrice4;
+    quote.AskPrice[4] = p->AskPrice5;
+    quote.BidVolume[0] = p->BidVolume1;
+    quote.BidVolume[1] = p->BidVolume2;
+    quote.BidVolume[2] = p->BidVolume3;
+    quote.BidVolume[3] = p->BidVolume4;
+    quote.BidVolume[4] = p->BidVolume5;
+    quote.AskVolume[0] = p->AskVolume1;
+    quote.AskVolume[1] = p->AskVolume2;
+    quote.AskVolume[2] = p->AskVolume3;
+    quote.AskVolume[3] = p->AskVolume4;
+    quote.AskVolume[4] = p->AskVolume5;
+}
+
+void QuoteBook::Update(const Quote &quote)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (quote.SymbolId >= _quotes.size()) {
+        Quote empty;
+        memset(&empty, 0, sizeof empty);
+        _quotes.resize(quote.SymbolId + 1, empty);
+    }
+    _quotes[quote.SymbolId] = quote;
+}
+
+bool QuoteBook::Get(uint32_t symbolId, Quote &quote) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (symbolId == 0 || symbolId >= _quotes.size() || _quotes[symbolId].SymbolId == 0) return false;
+
+    quote = _quotes[symbolId];
+    return true;
+}
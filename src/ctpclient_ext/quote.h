@@ -0,0 +1,62 @@
+/*
+ * Copyright 2019 Holmes Conan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+#include <mutex>
+#include <vector>
+#include <cstdint>
+#include "ThostFtdcUserApiStruct.h"
+
+/*
+ * Hot fields of a depth record in three cache lines, instead of the several
+ * hundred bytes of CThostFtdcDepthMarketDataField. The instrument is its
+ * symbol id, times are integers and empty levels keep CTP's DBL_MAX price.
+ */
+struct alignas(64) Quote {
+    uint32_t SymbolId;
+    int32_t TradingDay;         // yyyymmdd
+    int32_t UpdateTime;         // 当天的毫秒数
+    TThostFtdcVolumeType Volume;
+    TThostFtdcPriceType LastPrice;
+    TThostFtdcMoneyType Turnover;
+    TThostFtdcLargeVolumeType OpenInterest;
+    TThostFtdcPriceType UpperLimitPrice;
+    TThostFtdcPriceType LowerLimitPrice;
+    TThostFtdcPriceType BidPrice[5];
+    TThostFtdcPriceType AskPrice[5];
+    TThostFtdcVolumeType BidVolume[5];
+    TThostFtdcVolumeType AskVolume[5];
+};
+
+static_assert(sizeof(Quote) == 192, "Quote should fill exactly three cache lines");
+
+void ToQuote(const CThostFtdcDepthMarketDataField *pDepthMarketData, uint32_t symbolId, Quote &quote);
+
+/*
+ * Latest quote of each symbol, indexed by symbol id.
+ */
+class QuoteBook
+{
+    mutable std::mutex _mutex;
+    std::vector<Quote> _quotes;
+
+public:
+    QuoteBook() = default;
+    QuoteBook(const QuoteBook&) = delete;
+    QuoteBook& operator=(const QuoteBook&) = delete;
+
+    void Update(const Quote &quote);
+    bool Get(uint32_t symbolId, Quote &quote) const;
+};
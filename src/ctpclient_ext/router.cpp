@@ -0,0 +1,268 @@
+/*
+ * Copyright 2019 Holmes Conan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include "router.h"
+#include "ctpclient.h"
+
+AccountSession::AccountSession(CtpClient *client, const Account &account)
+: _client(client), _account(account)
+{
+    //
+}
+
+AccountSession::~AccountSession()
+{
+    if (_api) {
+        _api->RegisterSpi(nullptr);
+        _api->Release();
+    }
+}
+
+void AccountSession::Start(const std::string &flowPath)
+{
+    _api = CThostFtdcTraderApi::CreateFtdcTraderApi(flowPath.c_str());
+    _api->RegisterSpi(this);
+    _api->SubscribePrivateTopic(THOST_TERT_QUICK);
+    _api->SubscribePublicTopic(THOST_TERT_QUICK);
+    _api->RegisterFront(const_cast<char*>(_account.tdAddr.c_str()));
+    _api->Init();
+}
+
+void AccountSession::SetStatus(AccountStatus status, CThostFtdcRspInfoField *pRspInfo)
+{
+    _status.store(status, std::memory_order_release);
+
+    AccountEvent event;
+    memset(&event, 0, sizeof event);
+    strncpy(event.UserID, _account.userId.c_str(), sizeof event.UserID - 1);
+    event.Status = status;
+    _client->Enqueue(CtpClient::ResponseType::OnAccountStatus, &event, pRspInfo);
+}
+
+void AccountSession::Login()
+{
+    CThostFtdcReqUserLoginField req;
+    memset(&req, 0, sizeof req);
+    strncpy(req.BrokerID, _account.brokerId.c_str(), sizeof req.BrokerID);
+    strncpy(req.UserID, _account.userId.c_str(), sizeof req.UserID);
+    strncpy(req.Password, _account.password.c_str(), sizeof req.Password);
+    _api->ReqUserLogin(&req, 0);
+}
+
+int AccountSession::InsertOrder(CThostFtdcInputOrderField &req)
+{
+    if (GetStatus() != AccountStatus::Ready) return -5;
+
+    strncpy(req.BrokerID, _account.brokerId.c_str(), sizeof req.BrokerID);
+    strncpy(req.InvestorID, _account.userId.c_str(), sizeof req.InvestorID);
+    strncpy(req.UserID, _account.userId.c_str(), sizeof req.UserID);
+    snprintf(req.OrderRef, sizeof req.OrderRef, "%d", ++_orderRef);
+    return _api->ReqOrderInsert(&req, req.RequestID);
+}
+
+int AccountSession::OrderAction(CThostFtdcInputOrderActionField &req, int requestId)
+{
+    if (GetStatus() != AccountStatus::Ready) return -5;
+
+    strncpy(req.UserID, _account.userId.c_str(), sizeof req.UserID);
+    return _api->ReqOrderAction(&req, requestId);
+}
+
+void AccountSession::OnFrontConnected()
+{
+    SetStatus(AccountStatus::Connected);
+    if (_account.authCode.empty()) {
+        Login();
+        return;
+    }
+
+    CThostFtdcReqAuthenticateField req;
+    memset(&req, 0, sizeof req);
+    strncpy(req.BrokerID, _account.brokerId.c_str(), sizeof req.BrokerID);
+    strncpy(req.UserID, _account.userId.c_str(), sizeof req.UserID);
+    strncpy(req.AuthCode, _account.authCode.c_str(), sizeof req.AuthCode);
+    strncpy(req.AppID, _account.appId.c_str(), sizeof req.AppID);
+    _api->ReqAuthenticate(&req, 0);
+}
+
+void AccountSession::OnFrontDisconnected(int nReason)
+{
+    SetStatus(AccountStatus::Disconnected);
+}
+
+void AccountSession::OnRspAuthenticate(CThostFtdcRspAuthenticateField *pRspAuthenticateField, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
+{
+    if (pRspInfo && pRspInfo->ErrorID != 0) {
+        SetStatus(AccountStatus::Connected, pRspInfo);
+        return;
+    }
+    SetStatus(AccountStatus::Authenticated);
+    Login();
+}
+
+void AccountSession::OnRspUserLogin(CThostFtdcRspUserLoginField *pRspUserLogin, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
+{
+    if ((pRspInfo && pRspInfo->ErrorID != 0) || pRspUserLogin == nullptr) {
+        SetStatus(GetStatus(), pRspInfo);
+        return;
+    }
+
+    // 本会话的报单引用从登录返回的最大值开始递增
+    _frontId = pRspUserLogin->FrontID;
+    _sessionId = pRspUserLogin->SessionID;
+    _orderRef.store(atoi(pRspUserLogin->MaxOrderRef));
+    SetStatus(AccountStatus::LoggedIn);
+
+    CThostFtdcSettlementInfoConfirmField req;
+    memset(&req, 0, sizeof req);
+    strncpy(req.BrokerID, _account.brokerId.c_str(), sizeof req.BrokerID);
+    strncpy(req.InvestorID, _account.userId.c_str(), sizeof req.InvestorID);
+    _api->ReqSettlementInfoConfirm(&req, 0);
+}
+
+void AccountSession::OnRspSettlementInfoConfirm(CThostFtdcSettlementInfoConfirmField *pSettlementInfoConfirm, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
+{
+    if (pRspInfo && pRspInfo->ErrorID != 0) {
+        SetStatus(AccountStatus::LoggedIn, pRspInfo);
+        return;
+    }
+    SetStatus(AccountStatus::Ready);
+}
+
+void AccountSession::OnRspOrderInsert(CThostFtdcInputOrderField *pInputOrder, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
+{
+    _client->Enqueue(CtpClient::ResponseType::OnRspOrderInsert, pInputOrder, pRspInfo, nRequestID, bIsLast);
+}
+
+void AccountSession::OnRspOrderAction(CThostFtdcInputOrderActionField *pInputOrderAction, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
+{
+    _client->Enqueue(CtpClient::ResponseType::OnRspOrderAction, pInputOrderAction, pRspInfo, nRequestID, bIsLast);
+}
+
+void AccountSession::OnErrRtnOrderInsert(CThostFtdcInputOrderField *pInputOrder, CThostFtdcRspInfoField *pRspInfo)
+{
+    _client->Enqueue(CtpClient::ResponseType::OnErrRtnOrderInsert, pInputOrder, pRspInfo);
+}
+
+void AccountSession::OnErrRtnOrderAction(CThostFtdcOrderActionField *pOrderAction, CThostFtdcRspInfoField *pRspInfo)
+{
+    _client->Enqueue(CtpClient::ResponseType::OnErrRtnOrderAction, pOrderAction, pRspInfo);
+}
+
+void AccountSession::OnRtnOrder(CThostFtdcOrderField *pOrder)
+{
+    LatencyStats::Entry entry(_client->_latency);
+    _client->Enqueue(CtpClient::ResponseType::OnRtnOrder, pOrder);
+}
+
+void AccountSession::OnRtnTrade(CThostFtdcTradeField *pTrade)
+{
+    LatencyStats::Entry entry(_client->_latency);
+    _client->Enqueue(CtpClient::ResponseType::OnRtnTrade, pTrade);
+}
+
+void AccountSession::OnRspError(CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
+{
+    _client->Enqueue(CtpClient::ResponseType::OnTdError, pRspInfo, nRequestID, bIsLast);
+}
+
+AccountSession* OrderRouter::Find(const std::string &userId) const
+{
+    auto iter = _sessions.find(userId);
+    return iter == _sessions.end() ? nullptr : iter->second.get();
+}
+
+void OrderRouter::Add(CtpClient *client, const Account &account)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_sessions.count(account.userId) > 0) {
+        throw std::runtime_error("Account " + account.userId + " is already added");
+    }
+
+    auto session = new AccountSession(client, account);
+    _sessions[account.userId].reset(session);
+    if (_started) {
+        session->Start(_flowPath + account.userId + "-");
+    }
+}
+
+void OrderRouter::Start(const std::string &flowPath)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _flowPath = flowPath;
+    _started = true;
+    for (auto &kv : _sessions) {
+        kv.second->Start(_flowPath + kv.first + "-");
+    }
+}
+
+void OrderRouter::Stop()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _sessions.clear();
+    _started = false;
+}
+
+std::vector<std::string> OrderRouter::GetUserIds() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::vector<std::string> v;
+    for (auto &kv : _sessions) {
+        v.push_back(kv.first);
+    }
+    return v;
+}
+
+AccountStatus OrderRouter::GetStatus(const std::string &userId) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto session = Find(userId);
+    return session ? session->GetStatus() : AccountStatus::Disconnected;
+}
+
+bool OrderRouter::Owns(const std::string &userId) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return Find(userId) != nullptr;
+}
+
+std::map<std::string, std::string> OrderRouter::Allocate(const CThostFtdcInputOrderField &req, const std::map<std::string, int> &volumes)
+{
+    std::map<std::string, std::string> orderRefs;
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (auto &kv : volumes) {
+        auto session = Find(kv.first);
+        if (session == nullptr || kv.second <= 0) continue;
+
+        // 每个会话的 ReqOrderInsert 只是放入该 API 的发送队列，各账户并行发出
+        CThostFtdcInputOrderField order = req;
+        order.VolumeTotalOriginal = kv.second;
+        if (session->InsertOrder(order) == 0) {
+            orderRefs[kv.first] = order.OrderRef;
+        }
+    }
+    return orderRefs;
+}
+
+int OrderRouter::OrderAction(CThostFtdcInputOrderActionField &req, int requestId)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto session = Find(req.InvestorID);
+    return session ? session->OrderAction(req, requestId) : -5;
+}
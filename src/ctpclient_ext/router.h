@@ -0,0 +1,127 @@
+/*
+ * Copyright 2019 Holmes Conan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include "ThostFtdcTraderApi.h"
+#include "ThostFtdcUserApiStruct.h"
+
+class CtpClient;
+
+enum class AccountStatus {
+    Disconnected,
+    Connected,
+    Authenticated,
+    LoggedIn,
+    Ready           // 结算单已确认，可以报单
+};
+
+struct AccountEvent {
+    TThostFtdcInvestorIDType UserID;
+    AccountStatus Status;
+};
+
+struct Account {
+    std::string brokerId;
+    std::string userId;
+    std::string password;
+    std::string appId;
+    std::string authCode;
+    std::string tdAddr;
+};
+
+/*
+ * Trader session of one account of the order router. It authenticates, logs
+ * in and confirms the settlement info natively, and forwards its order/trade
+ * events to the client's trader lane, where they are told apart by InvestorID.
+ */
+class AccountSession : public CThostFtdcTraderSpi
+{
+    CtpClient *_client;
+    Account _account;
+    CThostFtdcTraderApi *_api = nullptr;
+    std::atomic<AccountStatus> _status{AccountStatus::Disconnected};
+    std::atomic<int> _orderRef{0};
+    TThostFtdcFrontIDType _frontId = 0;
+    TThostFtdcSessionIDType _sessionId = 0;
+
+    void SetStatus(AccountStatus status, CThostFtdcRspInfoField *pRspInfo = nullptr);
+    void Login();
+
+public:
+    AccountSession(CtpClient *client, const Account &account);
+    AccountSession(const AccountSession&) = delete;
+    AccountSession& operator=(const AccountSession&) = delete;
+    virtual ~AccountSession();
+
+    void Start(const std::string &flowPath);
+    inline AccountStatus GetStatus() const { return _status.load(std::memory_order_acquire); }
+    inline const Account& GetAccount() const { return _account; }
+
+    // Fills account and OrderRef of `req`; returns the API result, -5 if the session is not ready.
+    int InsertOrder(CThostFtdcInputOrderField &req);
+    int OrderAction(CThostFtdcInputOrderActionField &req, int requestId);
+
+public:
+    void OnFrontConnected() override;
+    void OnFrontDisconnected(int nReason) override;
+    void OnRspAuthenticate(CThostFtdcRspAuthenticateField *pRspAuthenticateField, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast) override;
+    void OnRspUserLogin(CThostFtdcRspUserLoginField *pRspUserLogin, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast) override;
+    void OnRspSettlementInfoConfirm(CThostFtdcSettlementInfoConfirmField *pSettlementInfoConfirm, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast) override;
+    void OnRspOrderInsert(CThostFtdcInputOrderField *pInputOrder, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast) override;
+    void OnRspOrderAction(CThostFtdcInputOrderActionField *pInputOrderAction, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast) override;
+    void OnErrRtnOrderInsert(CThostFtdcInputOrderField *pInputOrder, CThostFtdcRspInfoField *pRspInfo) override;
+    void OnErrRtnOrderAction(CThostFtdcOrderActionField *pOrderAction, CThostFtdcRspInfoField *pRspInfo) override;
+    void OnRtnOrder(CThostFtdcOrderField *pOrder) override;
+    void OnRtnTrade(CThostFtdcTradeField *pTrade) override;
+    void OnRspError(CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast) override;
+};
+
+/*
+ * Pool of trader sessions, one per account, keyed by user id. One allocation
+ * is sent to all its accounts from native code.
+ */
+class OrderRouter
+{
+    mutable std::mutex _mutex;
+    std::map<std::string, std::unique_ptr<AccountSession>> _sessions;
+    std::string _flowPath;
+    bool _started = false;
+
+    AccountSession* Find(const std::string &userId) const;
+
+public:
+    OrderRouter() = default;
+    OrderRouter(const OrderRouter&) = delete;
+    OrderRouter& operator=(const OrderRouter&) = delete;
+
+    // Sessions added before `Start` are connected by it, later ones right away.
+    void Add(CtpClient *client, const Account &account);
+    void Start(const std::string &flowPath);
+    void Stop();
+
+    std::vector<std::string> GetUserIds() const;
+    AccountStatus GetStatus(const std::string &userId) const;
+    bool Owns(const std::string &userId) const;
+
+    // Sends `req` with the volume of each account; returns the OrderRef per account it was sent to.
+    std::map<std::string, std::string> Allocate(const CThostFtdcInputOrderField &req, const std::map<std::string, int> &volumes);
+    int OrderAction(CThostFtdcInputOrderActionField &req, int requestId);
+};
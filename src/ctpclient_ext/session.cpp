@@ -0,0 +1,55 @@
+/*
+ * Copyright 2019 Holmes Conan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "session.h"
+
+void SessionMachine::Set(SessionState state)
+{
+    _pending = false;
+    _attempt = 0;
+    _state.store(state, std::memory_order_release);
+}
+
+void SessionMachine::Begin(SessionState step)
+{
+    _pending = true;
+    _attempt = 1;
+    _deadline = Clock::now() + std::chrono::milliseconds(_timeout);
+    _state.store(step, std::memory_order_release);
+}
+
+void SessionMachine::Fail()
+{
+    if (!_pending) return;
+    _deadline = Clock::now() + std::chrono::milliseconds(_retryDelay);
+}
+
+bool SessionMachine::IsDue() const
+{
+    return _pending && Clock::now() >= _deadline;
+}
+
+bool SessionMachine::Retry()
+{
+    if (_attempt >= _maxAttempts) {
+        _pending = false;
+        _state.store(SessionState::Failed, std::memory_order_release);
+        return false;
+    }
+
+    _attempt++;
+    _deadline = Clock::now() + std::chrono::milliseconds(_timeout);
+    return true;
+}
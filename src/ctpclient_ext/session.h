@@ -0,0 +1,75 @@
+/*
+ * Copyright 2019 Holmes Conan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+#include <atomic>
+#include <chrono>
+
+enum class SessionState {
+    Disconnected,
+    Connected,
+    Authenticating,     // 已发送认证请求
+    LoggingIn,          // 已发送登录请求
+    Confirming,         // 已发送结算单确认
+    Syncing,            // 查询报单和持仓
+    Ready,
+    Failed              // 重试次数用尽，等待下次重连
+};
+
+/*
+ * Progress of one front's session through connect, authenticate, login,
+ * settlement confirm and initial sync. Each step is resent when its response
+ * is an error (after `retryDelay`) or does not arrive within `timeout`, at
+ * most `maxAttempts` times; the session then stays `Failed` until the front
+ * reconnects. Driven from the dispatch thread only, the state may be read
+ * from anywhere.
+ */
+class SessionMachine
+{
+    using Clock = std::chrono::steady_clock;
+
+    std::atomic<SessionState> _state{SessionState::Disconnected};
+    int _attempt = 0;
+    bool _pending = false;
+    Clock::time_point _deadline;
+    int _timeout = 10000;
+    int _retryDelay = 1000;
+    int _maxAttempts = 3;
+
+public:
+    SessionMachine() = default;
+    SessionMachine(const SessionMachine&) = delete;
+    SessionMachine& operator=(const SessionMachine&) = delete;
+
+    inline SessionState GetState() const { return _state.load(std::memory_order_acquire); }
+    inline int GetAttempt() const { return _attempt; }
+    inline int GetTimeout() const { return _timeout; }
+    inline void SetTimeout(int ms) { _timeout = ms > 0 ? ms : 1; }
+    inline int GetRetryDelay() const { return _retryDelay; }
+    inline void SetRetryDelay(int ms) { _retryDelay = ms > 0 ? ms : 0; }
+    inline int GetMaxAttempts() const { return _maxAttempts; }
+    inline void SetMaxAttempts(int n) { _maxAttempts = n > 0 ? n : 1; }
+
+    // Enters a state without a request in flight (Disconnected, Connected, Ready).
+    void Set(SessionState state);
+    // Enters a step whose request was just sent.
+    void Begin(SessionState step);
+    // The step's response was an error; it is resent once the retry delay has passed.
+    void Fail();
+    // True when the pending step is due to be resent.
+    bool IsDue() const;
+    // Counts an attempt of the pending step; false (and Failed) when none are left.
+    bool Retry();
+};
@@ -0,0 +1,176 @@
+/*
+ * Copyright 2019 Holmes Conan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <cfloat>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include "spread.h"
+#include "bar.h"
+
+namespace {
+
+const int MILLISECONDS_PER_DAY = 24 * 60 * 60 * 1000;
+
+// 夜盘跨越午夜时按较短的一边计算
+int Distance(int a, int b)
+{
+    int d = std::abs(a - b);
+    return std::min(d, MILLISECONDS_PER_DAY - d);
+}
+
+}
+
+void SpreadMonitor::Add(const std::string &spreadId, const std::vector<std::pair<std::string, double>> &legs, int maxSkew)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto &spread = _spreads[spreadId];
+    spread = Spread();
+    spread.spreadId = spreadId;
+    spread.maxSkew = maxSkew;
+    for (auto &leg : legs) {
+        spread.legs[leg.first].ratio = leg.second;
+    }
+    spread.pending = spread.legs.size();
+
+    Index();
+    _enabled.store(!_spreads.empty(), std::memory_order_release);
+}
+
+void SpreadMonitor::Remove(const std::string &spreadId)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _spreads.erase(spreadId);
+
+    Index();
+    _enabled.store(!_spreads.empty(), std::memory_order_release);
+}
+
+void SpreadMonitor::Index()
+{
+    _legs.clear();
+    for (auto &kv : _spreads) {
+        for (auto &leg : kv.second.legs) {
+            _legs[leg.first].emplace_back(&kv.second, &leg.second);
+        }
+    }
+}
+
+void SpreadMonitor::Update(const CThostFtdcDepthMarketDataField *pDepthMarketData, std::vector<SpreadQuote> &out)
+{
+    out.clear();
+    if (!_enabled.load(std::memory_order_acquire)) return;
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto iter = _legs.find(pDepthMarketData->InstrumentID);
+    if (iter == _legs.end()) return;
+
+    int time = ParseUpdateTime(pDepthMarketData->UpdateTime, pDepthMarketData->UpdateMillisec);
+    for (auto &ref : iter->second) {
+        auto &spread = *ref.first;
+        auto &leg = *ref.second;
+        if (!leg.ready) {
+            leg.ready = true;
+            spread.pending--;
+        }
+
+        leg.lastPrice = pDepthMarketData->LastPrice;
+        leg.bidPrice = pDepthMarketData->BidPrice1;
+        leg.askPrice = pDepthMarketData->AskPrice1;
+        leg.bidVolume = pDepthMarketData->BidVolume1;
+        leg.askVolume = pDepthMarketData->AskVolume1;
+        leg.time = time;
+
+        if (spread.pending > 0) continue;
+
+        Quote(spread, pDepthMarketData);
+        out.push_back(spread.quote);
+    }
+}
+
+void SpreadMonitor::Quote(Spread &spread, const CThostFtdcDepthMarketDataField *pDepthMarketData)
+{
+    auto &q = spread.quote;
+    memset(&q, 0, sizeof q);
+    strncpy(q.SpreadID, spread.spreadId.c_str(), sizeof q.SpreadID - 1);
+    memcpy(q.InstrumentID, pDepthMarketData->InstrumentID, sizeof q.InstrumentID);
+    memcpy(q.TradingDay, pDepthMarketData->TradingDay, sizeof q.TradingDay);
+    memcpy(q.UpdateTime, pDepthMarketData->UpdateTime, sizeof q.UpdateTime);
+    q.UpdateMillisec = pDepthMarketData->UpdateMillisec;
+
+    bool lastValid = true, bidValid = true, askValid = true;
+    double bidVolume = DBL_MAX, askVolume = DBL_MAX;
+    for (auto &kv : spread.legs) {
+        auto &leg = kv.second;
+        double ratio = std::abs(leg.ratio);
+        if (ratio == 0) continue;
+
+        lastValid = lastValid && IsValidPrice(leg.lastPrice);
+        q.LastPrice += leg.ratio * leg.lastPrice;
+
+        // 卖出价差：多头腿按买价卖出，空头腿按卖价买入
+        double sellPrice = leg.ratio > 0 ? leg.bidPrice : leg.askPrice;
+        int sellVolume = leg.ratio > 0 ? leg.bidVolume : leg.askVolume;
+        double buyPrice = leg.ratio > 0 ? leg.askPrice : leg.bidPrice;
+        int buyVolume = leg.ratio > 0 ? leg.askVolume : leg.bidVolume;
+
+        bidValid = bidValid && IsValidPrice(sellPrice);
+        askValid = askValid && IsValidPrice(buyPrice);
+        q.BidPrice += leg.ratio * sellPrice;
+        q.AskPrice += leg.ratio * buyPrice;
+        bidVolume = std::min(bidVolume, sellVolume / ratio);
+        askVolume = std::min(askVolume, buyVolume / ratio);
+
+        for (auto &other : spread.legs) {
+            q.Skew = std::max(q.Skew, Distance(leg.time, other.second.time));
+        }
+    }
+
+    if (!lastValid) q.LastPrice = DBL_MAX;
+    if (bidValid && bidVolume < DBL_MAX) {
+        q.BidVolume = static_cast<int>(bidVolume);
+    } else {
+        q.BidPrice = DBL_MAX;
+    }
+    if (askValid && askVolume < DBL_MAX) {
+        q.AskVolume = static_cast<int>(askVolume);
+    } else {
+        q.AskPrice = DBL_MAX;
+    }
+    q.Stale = q.Skew > spread.maxSkew;
+    spread.quoted = true;
+}
+
+bool SpreadMonitor::GetQuote(const std::string &spreadId, SpreadQuote &quote) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto iter = _spreads.find(spreadId);
+    if (iter == _spreads.end() || !iter->second.quoted) return false;
+
+    quote = iter->second.quote;
+    return true;
+}
+
+std::vector<SpreadQuote> SpreadMonitor::GetQuotes() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::vector<SpreadQuote> v;
+    for (auto &kv : _spreads) {
+        if (kv.second.quoted) {
+            v.push_back(kv.second.quote);
+        }
+    }
+    return v;
+}
@@ -0,0 +1,94 @@
+/*
+ * Copyright 2019 Holmes Conan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <utility>
+#include <unordered_map>
+#include "ThostFtdcUserApiStruct.h"
+
+struct SpreadQuote {
+    TThostFtdcInstrumentIDType SpreadID;
+    // 触发本次更新的腿
+    TThostFtdcInstrumentIDType InstrumentID;
+    TThostFtdcDateType TradingDay;
+    TThostFtdcTimeType UpdateTime;
+    TThostFtdcMillisecType UpdateMillisec;
+    TThostFtdcPriceType LastPrice;
+    TThostFtdcPriceType BidPrice;
+    TThostFtdcVolumeType BidVolume;
+    TThostFtdcPriceType AskPrice;
+    TThostFtdcVolumeType AskVolume;
+    // 各腿交易所时间的最大差值（毫秒）
+    int Skew;
+    bool Stale;
+};
+
+/*
+ * Aligned snapshots of the legs of each spread. A positive ratio means the
+ * leg is bought when the spread is bought.
+ *
+ * On every leg update the implied spread bid (sell the spread: hit the bids of
+ * long legs, lift the asks of short legs) and ask are recomputed from the
+ * latest snapshot of every leg. Legs whose exchange timestamps are further
+ * apart than `maxSkew` milliseconds mark the quote as stale.
+ */
+class SpreadMonitor
+{
+    struct Leg {
+        double ratio = 1.0;
+        double lastPrice = 0;
+        double bidPrice = 0;
+        double askPrice = 0;
+        int bidVolume = 0;
+        int askVolume = 0;
+        int time = 0;
+        bool ready = false;
+    };
+
+    struct Spread {
+        std::string spreadId;
+        int maxSkew = 500;
+        std::map<std::string, Leg> legs;
+        size_t pending = 0;
+        SpreadQuote quote;
+        bool quoted = false;
+    };
+
+    mutable std::mutex _mutex;
+    std::atomic_bool _enabled{false};
+    std::map<std::string, Spread> _spreads;
+    std::unordered_map<std::string, std::vector<std::pair<Spread*, Leg*>>> _legs;
+
+    void Index();
+    void Quote(Spread &spread, const CThostFtdcDepthMarketDataField *pDepthMarketData);
+
+public:
+    SpreadMonitor() = default;
+    SpreadMonitor(const SpreadMonitor&) = delete;
+    SpreadMonitor& operator=(const SpreadMonitor&) = delete;
+
+    void Add(const std::string &spreadId, const std::vector<std::pair<std::string, double>> &legs, int maxSkew);
+    void Remove(const std::string &spreadId);
+    // Fills `out` with the quotes of spreads changed by this leg update.
+    void Update(const CThostFtdcDepthMarketDataField *pDepthMarketData, std::vector<SpreadQuote> &out);
+
+    bool GetQuote(const std::string &spreadId, SpreadQuote &quote) const;
+    std::vector<SpreadQuote> GetQuotes() const;
+};
@@ -0,0 +1,166 @@
+/*
+ * Copyright 2019 Holmes Conan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "subscription.h"
+#include "symbols.h"
+
+// 订阅时分配合约编号，行情到达前即可使用
+void SubscriptionSet::Intern(const std::vector<std::string> &instrumentIds)
+{
+    auto &symbols = SymbolTable::Instance();
+    for (auto &id : instrumentIds) {
+        symbols.Intern(id.c_str());
+    }
+}
+
+void SubscriptionSet::Add(const std::vector<std::string> &instrumentIds)
+{
+    Intern(instrumentIds);
+    std::lock_guard<std::mutex> lock(_mutex);
+    _desired.insert(instrumentIds.begin(), instrumentIds.end());
+}
+
+void SubscriptionSet::Remove(const std::vector<std::string> &instrumentIds)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (auto &id : instrumentIds) {
+        _desired.erase(id);
+    }
+}
+
+void SubscriptionSet::Assign(const std::vector<std::string> &instrumentIds)
+{
+    Intern(instrumentIds);
+    std::lock_guard<std::mutex> lock(_mutex);
+    _desired.clear();
+    _desired.insert(instrumentIds.begin(), instrumentIds.end());
+}
+
+void SubscriptionSet::Diff(std::vector<std::string> &toSubscribe, std::vector<std::string> &toUnsubscribe)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    for (auto &id : _desired) {
+        auto iter = _states.find(id);
+        if (iter == _states.end()) {
+            _states.emplace(id, State::Pending);
+            toSubscribe.push_back(id);
+        } else if (iter->second == State::Failed) {
+            iter->second = State::Pending;
+            toSubscribe.push_back(id);
+        }
+        // Unsubscribing: resubscribed after the unsubscribe response.
+    }
+
+    for (auto iter = _states.begin(); iter != _states.end(); ) {
+        if (_desired.count(iter->first) > 0) {
+            ++iter;
+            continue;
+        }
+
+        switch (iter->second) {
+        case State::Active:
+            iter->second = State::Unsubscribing;
+            toUnsubscribe.push_back(iter->first);
+            ++iter;
+            break;
+        case State::Failed:
+            iter = _states.erase(iter);
+            break;
+        default:
+            // Pending: unsubscribed after the subscribe response.
+            ++iter;
+            break;
+        }
+    }
+}
+
+void SubscriptionSet::Revert(const std::vector<std::string> &instrumentIds)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (auto &id : instrumentIds) {
+        auto iter = _states.find(id);
+        if (iter == _states.end()) continue;
+
+        if (iter->second == State::Pending) {
+            _states.erase(iter);
+        } else if (iter->second == State::Unsubscribing) {
+            iter->second = State::Active;
+        }
+    }
+}
+
+bool SubscriptionSet::OnSubscribed(const std::string &instrumentId, bool succeeded)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto iter = _states.find(instrumentId);
+    if (iter == _states.end()) {
+        // Subscribed outside of the set, e.g. acknowledged after a reset.
+        if (!succeeded) return false;
+        _states.emplace(instrumentId, State::Active);
+    } else if (iter->second == State::Pending) {
+        iter->second = succeeded ? State::Active : State::Failed;
+        if (!succeeded) return false;
+    } else {
+        return false;
+    }
+
+    return _desired.count(instrumentId) == 0;
+}
+
+bool SubscriptionSet::OnUnsubscribed(const std::string &instrumentId, bool succeeded)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto iter = _states.find(instrumentId);
+    if (iter == _states.end() || iter->second != State::Unsubscribing) return false;
+
+    if (succeeded) {
+        _states.erase(iter);
+        return _desired.count(instrumentId) > 0;
+    }
+
+    iter->second = State::Active;
+    return false;
+}
+
+void SubscriptionSet::Reset()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _states.clear();
+}
+
+bool SubscriptionSet::IsDesired(const std::string &instrumentId) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _desired.count(instrumentId) > 0;
+}
+
+std::vector<std::string> SubscriptionSet::GetDesired() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return std::vector<std::string>(_desired.begin(), _desired.end());
+}
+
+std::vector<std::string> SubscriptionSet::Get(State state) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::vector<std::string> v;
+    for (auto &kv : _states) {
+        if (kv.second == state) {
+            v.push_back(kv.first);
+        }
+    }
+    return v;
+}
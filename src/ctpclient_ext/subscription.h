@@ -0,0 +1,68 @@
+/*
+ * Copyright 2019 Holmes Conan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+#include <map>
+#include <set>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/*
+ * Market data subscriptions: the set of instruments the user wants, and what
+ * the MD front has actually acknowledged. `Diff` computes the requests needed
+ * to bring the front in line with the desired set.
+ */
+class SubscriptionSet
+{
+public:
+    enum class State {
+        Pending,        // 已发送订阅请求，等待应答
+        Active,         // 订阅成功
+        Failed,         // 订阅被拒绝
+        Unsubscribing   // 已发送退订请求，等待应答
+    };
+
+private:
+    mutable std::mutex _mutex;
+    std::set<std::string> _desired;
+    std::map<std::string, State> _states;
+
+    static void Intern(const std::vector<std::string> &instrumentIds);
+
+public:
+    SubscriptionSet() = default;
+    SubscriptionSet(const SubscriptionSet&) = delete;
+    SubscriptionSet& operator=(const SubscriptionSet&) = delete;
+
+    void Add(const std::vector<std::string> &instrumentIds);
+    void Remove(const std::vector<std::string> &instrumentIds);
+    void Assign(const std::vector<std::string> &instrumentIds);
+
+    // Collect instruments to (un)subscribe and mark them as in flight.
+    void Diff(std::vector<std::string> &toSubscribe, std::vector<std::string> &toUnsubscribe);
+    // Forget in-flight requests which could not be sent, so the next `Diff` retries them.
+    void Revert(const std::vector<std::string> &instrumentIds);
+
+    // Both return true if the desired set changed while the request was in flight.
+    bool OnSubscribed(const std::string &instrumentId, bool succeeded);
+    bool OnUnsubscribed(const std::string &instrumentId, bool succeeded);
+    // The front drops all subscriptions when the connection is lost.
+    void Reset();
+
+    bool IsDesired(const std::string &instrumentId) const;
+    std::vector<std::string> GetDesired() const;
+    std::vector<std::string> Get(State state) const;
+};
@@ -0,0 +1,107 @@
+/*
+ * Copyright 2019 Holmes Conan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <cstring>
+#include <stdexcept>
+#include "symbols.h"
+
+SymbolTable& SymbolTable::Instance()
+{
+    // 不析构，Python 退出时可能仍在使用
+    static SymbolTable *table = new SymbolTable();
+    return *table;
+}
+
+SymbolTable::SymbolTable()
+{
+    _indexes.emplace_back(new Index(INITIAL_SLOTS));
+    _index.store(_indexes.back().get(), std::memory_order_release);
+}
+
+size_t SymbolTable::Hash(const char *name)
+{
+    // FNV-1a
+    size_t h = 14695981039346656037ull;
+    while (*name) {
+        h = (h ^ static_cast<unsigned char>(*name++)) * 1099511628211ull;
+    }
+    return h;
+}
+
+void SymbolTable::Insert(Index &index, const char *name, uint32_t id)
+{
+    size_t i = Hash(name) & index.mask;
+    while (index.slots[i].load(std::memory_order_relaxed) != 0) {
+        i = (i + 1) & index.mask;
+    }
+    index.slots[i].store(id, std::memory_order_release);
+}
+
+uint32_t SymbolTable::Intern(const char *name)
+{
+    uint32_t id = Find(name);
+    if (id != 0) return id;
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    id = Find(name);
+    if (id != 0) return id;
+
+    id = _count.load(std::memory_order_relaxed);
+    if ((id >> CHUNK_BITS) >= MAX_CHUNKS) {
+        throw std::length_error("too many symbols.");
+    }
+    auto &chunk = _chunks[id >> CHUNK_BITS];
+    if (!chunk) {
+        chunk.reset(new std::string[CHUNK_SIZE]);
+    }
+    chunk[id & (CHUNK_SIZE - 1)] = name;
+    // 名字写好之后才对无锁的读者可见
+    _count.store(id + 1, std::memory_order_release);
+
+    // 索引最多半满，满了换成两倍大的新索引
+    auto *index = _index.load(std::memory_order_relaxed);
+    if (size_t(id) * 2 > index->mask) {
+        _indexes.emplace_back(new Index((index->mask + 1) * 2));
+        index = _indexes.back().get();
+        for (uint32_t i = 1; i <= id; i++) {
+            Insert(*index, GetName(i), i);
+        }
+        _index.store(index, std::memory_order_release);
+    } else {
+        Insert(*index, name, id);
+    }
+    return id;
+}
+
+uint32_t SymbolTable::Find(const char *name) const
+{
+    auto *index = _index.load(std::memory_order_acquire);
+    for (size_t i = Hash(name) & index->mask; ; i = (i + 1) & index->mask) {
+        uint32_t id = index->slots[i].load(std::memory_order_acquire);
+        if (id == 0) return 0;
+        if (strcmp(GetName(id), name) == 0) return id;
+    }
+}
+
+const char* SymbolTable::GetName(uint32_t id) const
+{
+    if (id == 0 || id >= _count.load(std::memory_order_acquire)) return "";
+    return _chunks[id >> CHUNK_BITS][id & (CHUNK_SIZE - 1)].c_str();
+}
+
+size_t SymbolTable::GetCount() const
+{
+    return _count.load(std::memory_order_acquire) - 1;
+}
@@ -0,0 +1,72 @@
+/*
+ * Copyright 2019 Holmes Conan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+/*
+ * Process-wide table of instrument ids. Every id gets a dense number on first
+ * use which stays valid for the life of the process; 0 is never assigned.
+ *
+ * Names are stored in append-only chunks that never move, so id -> name
+ * lookups read them without locking. name -> id lookups probe an open
+ * addressing index of atomic ids, also without locking; only adding a name
+ * takes the mutex. The index is replaced by a larger copy when it fills up,
+ * the old ones are kept since readers may still be probing them.
+ */
+class SymbolTable
+{
+    static const size_t CHUNK_BITS = 12;
+    static const size_t CHUNK_SIZE = size_t(1) << CHUNK_BITS;
+    static const size_t MAX_CHUNKS = 1024;
+    static const size_t INITIAL_SLOTS = 1024;
+
+    struct Index {
+        explicit Index(size_t size) : mask(size - 1), slots(new std::atomic<uint32_t>[size]()) {}
+        size_t mask;
+        std::unique_ptr<std::atomic<uint32_t>[]> slots;
+    };
+
+    mutable std::mutex _mutex;
+    std::unique_ptr<std::string[]> _chunks[MAX_CHUNKS];
+    std::atomic<uint32_t> _count{1};
+    std::atomic<Index*> _index{nullptr};
+    std::vector<std::unique_ptr<Index>> _indexes;
+
+    SymbolTable();
+
+    static size_t Hash(const char *name);
+    static void Insert(Index &index, const char *name, uint32_t id);
+
+public:
+    SymbolTable(const SymbolTable&) = delete;
+    SymbolTable& operator=(const SymbolTable&) = delete;
+
+    static SymbolTable& Instance();
+
+    // Lock free if `name` was interned before.
+    uint32_t Intern(const char *name);
+    // Lock free, 0 if `name` was never interned.
+    uint32_t Find(const char *name) const;
+    inline uint32_t Find(const std::string &name) const { return Find(name.c_str()); }
+    // Lock free, "" for an unknown id; the name lives as long as the table.
+    const char* GetName(uint32_t id) const;
+    size_t GetCount() const;
+};
@@ -0,0 +1,148 @@
+/*
+ * Copyright 2019 Holmes Conan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <cstring>
+#include "ticks.h"
+#include "symbols.h"
+
+void ToTicks(const CThostFtdcDepthMarketDataField *p, uint32_t symbolId, double tick, DepthTicks &depth)
+{
+    memset(&depth, 0, sizeof depth);
+    memcpy(depth.InstrumentID, p->InstrumentID, sizeof depth.InstrumentID - 1);
+    depth.SymbolId = symbolId;
+    memcpy(depth.TradingDay, p->TradingDay, sizeof depth.TradingDay - 1);
+    memcpy(depth.UpdateTime, p->UpdateTime, sizeof depth.UpdateTime - 1);
+    depth.UpdateMillisec = p->UpdateMillisec;
+    depth.PriceTick = tick;
+
+    depth.LastPrice = ToTicks(p->LastPrice, tick);
+    depth.UpperLimitPrice = ToTicks(p->UpperLimitPrice, tick);
+    depth.LowerLimitPrice = ToTicks(p->LowerLimitPrice, tick);
+    // 空档位的价格为 DBL_MAX，数量为 0
+    depth.BidPrice1 = p->BidVolume1 > 0 ? ToTicks(p->BidPrice1, tick) : PRICE_ABSENT;
+    depth.BidPrice2 = p->BidVolume2 > 0 ? ToTicks(p->BidPrice2, tick) : PRICE_ABSENT;
+    depth.BidPrice3 = p->BidVolume3 > 0 ? ToTicks(p->BidPrice3, tick) : PRICE_ABSENT;
+    depth.BidPrice4 = p->BidVolume4 > 0 ? ToTicks(p->BidPrice4, tick) : PRICE_ABSENT;
+    depth.BidPrice5 = p->BidVolume5 > 0 ? ToTicks(p->BidPrice5, tick) : PRICE_ABSENT;
+    depth.AskPrice1 = p->AskVolume1 > 0 ? ToTicks(p->AskPrice1, tick) : PRICE_ABSENT;
+    depth.AskPrice2 = p->AskVolume2 > 0 ? ToTicks(p->AskPrice2, tick) : PRICE_ABSENT;
+    depth.AskPrice3 = p->AskVolume3 > 0 ? ToTicks(p->AskPrice3, tick) : PRICE_ABSENT;
+    depth.AskPrice4 = p->AskVolume4 > 0 ? ToTicks(p->AskPrice4, tick) : PRICE_ABSENT;
+    depth.AskPrice5 = p->AskVolume5 > 0 ? ToTicks(p->AskPrice5, tick) : PRICE_ABSENT;
+    depth.BidVolume1 = p->BidVolume1;
+    depth.BidVolume2 = p->BidVolume2;
+    depth.BidVolume3 = p->BidVolume3;
+    depth.BidVolume4 = p->BidVolume4;
+    depth.BidVolume5 = p->BidVolume5;
+    depth.AskVolume1 = p->AskVolume1;
+    depth.AskVolume2 = p->AskVolume2;
+    depth.AskVolume3 = p->AskVolume3;
+    depth.AskVolume4 = p->AskVolume4;
+    depth.AskVolume5 = p->AskVolume5;
+    depth.Volume = p->Volume;
+    depth.OpenInterest = p->OpenInterest;
+}
+
+void ToTicks(TickBar &bar, double tick)
+{
+    bar.PriceTick = tick;
+    bar.PriceTicks = ToTicks(bar.Price, tick);
+}
+
+void ToTicks(M1Bar &bar, double tick)
+{
+    bar.PriceTick = tick;
+    bar.OpenTicks = ToTicks(bar.OpenPrice, tick);
+    bar.HighestTicks = ToTicks(bar.HighestPrice, tick);
+    bar.LowestTicks = ToTicks(bar.LowestPrice, tick);
+    bar.CloseTicks = ToTicks(bar.ClosePrice, tick);
+}
+
+double TickScale::Get(uint32_t symbolId)
+{
+    if (symbolId == 0 || (symbolId >> CHUNK_BITS) >= MAX_CHUNKS) return 0.0;
+    auto *chunk = _chunks[symbolId >> CHUNK_BITS].load(std::memory_order_acquire);
+    if (chunk) {
+        double tick = chunk[symbolId & (CHUNK_SIZE - 1)].load(std::memory_order_relaxed);
+        if (tick != UNRESOLVED) return tick;
+    }
+    return Resolve(symbolId);
+}
+
+double TickScale::Get(const char *instrumentId)
+{
+    return Get(SymbolTable::Instance().Intern(instrumentId));
+}
+
+double TickScale::Resolve(uint32_t symbolId)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    size_t index = symbolId >> CHUNK_BITS;
+    auto *chunk = _chunks[index].load(std::memory_order_relaxed);
+    if (!chunk) {
+        _owned[index].reset(new std::atomic<double>[CHUNK_SIZE]);
+        chunk = _owned[index].get();
+        for (size_t i = 0; i < CHUNK_SIZE; ++i) {
+            chunk[i].store(UNRESOLVED, std::memory_order_relaxed);
+        }
+        _chunks[index].store(chunk, std::memory_order_release);
+    }
+
+    // 加锁后再确认一次，Set/Invalidate 只在锁内清除缓存项
+    auto &slot = chunk[symbolId & (CHUNK_SIZE - 1)];
+    double tick = slot.load(std::memory_order_relaxed);
+    if (tick != UNRESOLVED) return tick;
+
+    std::string instrumentId = SymbolTable::Instance().GetName(symbolId);
+    auto iter = _explicit.find(instrumentId);
+    if (iter != _explicit.end()) {
+        tick = iter->second;
+    } else {
+        tick = _tickSizeOf ? _tickSizeOf(instrumentId) : 0.0;
+    }
+    slot.store(tick, std::memory_order_relaxed);
+    return tick;
+}
+
+void TickScale::Forget(uint32_t symbolId)
+{
+    if (symbolId == 0 || (symbolId >> CHUNK_BITS) >= MAX_CHUNKS) return;
+    auto *chunk = _chunks[symbolId >> CHUNK_BITS].load(std::memory_order_relaxed);
+    if (chunk) {
+        chunk[symbolId & (CHUNK_SIZE - 1)].store(UNRESOLVED, std::memory_order_relaxed);
+    }
+}
+
+void TickScale::Set(const std::string &instrumentId, double tick)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (tick > 0.0) {
+        _explicit[instrumentId] = tick;
+    } else {
+        _explicit.erase(instrumentId);
+    }
+    Forget(SymbolTable::Instance().Find(instrumentId));
+}
+
+void TickScale::Invalidate()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (auto &owned : _owned) {
+        if (!owned) continue;
+        for (size_t i = 0; i < CHUNK_SIZE; ++i) {
+            owned[i].store(UNRESOLVED, std::memory_order_relaxed);
+        }
+    }
+}
@@ -0,0 +1,129 @@
+/*
+ * Copyright 2019 Holmes Conan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+#include <cmath>
+#include <cfloat>
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include "ThostFtdcUserApiStruct.h"
+#include "bar.h"
+
+// 以最小变动价位为单位的整数价格，CTP 的 DBL_MAX 空档位映射为 PRICE_ABSENT
+const int64_t PRICE_ABSENT = INT64_MIN;
+
+inline int64_t ToTicks(double price, double tick)
+{
+    if (tick <= 0.0 || price >= DBL_MAX || price <= -DBL_MAX) return PRICE_ABSENT;
+    return std::llround(price / tick);
+}
+
+inline double FromTicks(int64_t ticks, double tick)
+{
+    return ticks == PRICE_ABSENT ? DBL_MAX : ticks * tick;
+}
+
+// Price fields of a depth record as tick counts.
+struct DepthTicks {
+    TThostFtdcInstrumentIDType InstrumentID;
+    uint32_t SymbolId;
+    TThostFtdcDateType TradingDay;
+    TThostFtdcTimeType UpdateTime;
+    TThostFtdcMillisecType UpdateMillisec;
+    TThostFtdcPriceType PriceTick;
+    int64_t LastPrice;
+    int64_t UpperLimitPrice;
+    int64_t LowerLimitPrice;
+    int64_t BidPrice1;
+    int64_t BidPrice2;
+    int64_t BidPrice3;
+    int64_t BidPrice4;
+    int64_t BidPrice5;
+    int64_t AskPrice1;
+    int64_t AskPrice2;
+    int64_t AskPrice3;
+    int64_t AskPrice4;
+    int64_t AskPrice5;
+    TThostFtdcVolumeType BidVolume1;
+    TThostFtdcVolumeType BidVolume2;
+    TThostFtdcVolumeType BidVolume3;
+    TThostFtdcVolumeType BidVolume4;
+    TThostFtdcVolumeType BidVolume5;
+    TThostFtdcVolumeType AskVolume1;
+    TThostFtdcVolumeType AskVolume2;
+    TThostFtdcVolumeType AskVolume3;
+    TThostFtdcVolumeType AskVolume4;
+    TThostFtdcVolumeType AskVolume5;
+    TThostFtdcVolumeType Volume;
+    TThostFtdcLargeVolumeType OpenInterest;
+};
+
+void ToTicks(const CThostFtdcDepthMarketDataField *pDepthMarketData, uint32_t symbolId, double tick, DepthTicks &depth);
+void ToTicks(TickBar &bar, double tick);
+void ToTicks(M1Bar &bar, double tick);
+
+/*
+ * Tick size of each instrument for the fixed-point price fields.
+ *
+ * Sizes come from the instrument catalog and are cached; `Set` overrides them,
+ * e.g. for composites or before the catalog is loaded. Instruments unknown to
+ * the catalog have no tick size and all their fixed-point prices are absent.
+ *
+ * The cache is indexed by symbol id in chunks that never move, so a cached
+ * size is read without locking; only a miss takes the mutex to resolve it.
+ */
+class TickScale
+{
+public:
+    using TickSizeOf = std::function<double(const std::string&)>;
+
+private:
+    static const size_t CHUNK_BITS = 12;
+    static const size_t CHUNK_SIZE = size_t(1) << CHUNK_BITS;
+    static const size_t MAX_CHUNKS = 1024;
+    // 尚未解析的缓存项
+    static constexpr double UNRESOLVED = -1.0;
+
+    mutable std::mutex _mutex;
+    std::atomic_bool _enabled{false};
+    std::unordered_map<std::string, double> _explicit;
+    std::atomic<std::atomic<double>*> _chunks[MAX_CHUNKS] = {};
+    std::unique_ptr<std::atomic<double>[]> _owned[MAX_CHUNKS];
+    TickSizeOf _tickSizeOf;
+
+    double Resolve(uint32_t symbolId);
+    void Forget(uint32_t symbolId);
+
+public:
+    TickScale() = default;
+    TickScale(const TickScale&) = delete;
+    TickScale& operator=(const TickScale&) = delete;
+
+    inline bool IsEnabled() const { return _enabled.load(std::memory_order_relaxed); }
+    inline void SetEnabled(bool enabled) { _enabled.store(enabled, std::memory_order_relaxed); }
+    inline void SetTickSizeOf(TickSizeOf tickSizeOf) { _tickSizeOf = tickSizeOf; }
+
+    // 0 when the tick size is unknown. Lock free once the size is cached.
+    double Get(uint32_t symbolId);
+    double Get(const char *instrumentId);
+    void Set(const std::string &instrumentId, double tick);
+    // Forget the cached catalog sizes after the catalog is reloaded.
+    void Invalidate();
+};
@@ -86,11 +86,13 @@ void TraderSpi::OnErrRtnOrderAction(CThostFtdcOrderActionField *pOrderAction, CT
 
 void TraderSpi::OnRtnOrder(CThostFtdcOrderField *pOrder)
 {
+    LatencyStats::Entry entry(_client->_latency);
     _client->Enqueue(CtpClient::ResponseType::OnRtnOrder, pOrder);
 }
 
 void TraderSpi::OnRtnTrade(CThostFtdcTradeField *pTrade)
 {
+    LatencyStats::Entry entry(_client->_latency);
     _client->Enqueue(CtpClient::ResponseType::OnRtnTrade, pTrade);
 }
 
@@ -129,3 +131,13 @@ void TraderSpi::OnRspQryInvestorPositionDetail(CThostFtdcInvestorPositionDetailF
 {
     _client->Enqueue(CtpClient::ResponseType::OnRspQryInvestorPositionDetail, pInvestorPositionDetail, pRspInfo, nRequestID, bIsLast);
 }
+
+void TraderSpi::OnRspQryProduct(CThostFtdcProductField *pProduct, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
+{
+    _client->Enqueue(CtpClient::ResponseType::OnRspQryProduct, pProduct, pRspInfo, nRequestID, bIsLast);
+}
+
+void TraderSpi::OnRspQryInstrument(CThostFtdcInstrumentField *pInstrument, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
+{
+    _client->Enqueue(CtpClient::ResponseType::OnRspQryInstrument, pInstrument, pRspInfo, nRequestID, bIsLast);
+}
\ No newline at end of file
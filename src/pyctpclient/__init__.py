@@ -17,19 +17,21 @@ import logging
 from tempfile import mkdtemp
 from shutil import rmtree
 from .ctpclient import CtpClient as _CtpClient
+from .ctpclient import symbol_id, symbol_name, intern_symbol
+from .ctpclient import Dispatcher
 
 # Data Structs
 from .ctpclient import (
     ResponseInfo, UserLoginInfo, UserLogoutInfo,
-    MarketData, TickBar, M1Bar,
-    SpecificInstrument,
+    MarketData, MarketDataEvent, TickBar, M1Bar, DepthTicks, Quote,
+    SpecificInstrument, Instrument, Product, MainContractRoll, SpreadQuote, MarketDataRecovery,
     SettlementInfo, SettlementInfoConfirm,
     TradingAccount, InvestorPosition, InvestorPositionDetail,
     InputOrder, InputOrderAction, Order, Trade, OrderAction
 )
 
 # Enums
-from .ctpclient import Direction, OffsetFlag, OrderStatus, OrderSubmitStatus, OrderActionStatus
+from .ctpclient import Direction, OffsetFlag, OrderStatus, OrderSubmitStatus, OrderActionStatus, OverflowPolicy, EventMask, AccountStatus, SessionState, IndicatorType
 D_BUY = Direction.BUY
 D_SELL = Direction.SELL
 
@@ -63,7 +65,44 @@ OAS_SUBMITTED = OrderActionStatus.SUBMITTED
 OAS_ACCEPTED = OrderActionStatus.ACCEPTED
 OAS_REJECTED = OrderActionStatus.REJECTED
 
-__version__ = "0.3.5rc1"
+OP_BLOCK = OverflowPolicy.BLOCK
+OP_DROP_OLDEST = OverflowPolicy.DROP_OLDEST
+OP_CONFLATE = OverflowPolicy.CONFLATE
+
+SS_DISCONNECTED = SessionState.DISCONNECTED
+SS_CONNECTED = SessionState.CONNECTED
+SS_AUTHENTICATING = SessionState.AUTHENTICATING
+SS_LOGGING_IN = SessionState.LOGGING_IN
+SS_CONFIRMING = SessionState.CONFIRMING
+SS_SYNCING = SessionState.SYNCING
+SS_READY = SessionState.READY
+SS_FAILED = SessionState.FAILED
+
+AS_DISCONNECTED = AccountStatus.DISCONNECTED
+AS_CONNECTED = AccountStatus.CONNECTED
+AS_AUTHENTICATED = AccountStatus.AUTHENTICATED
+AS_LOGGED_IN = AccountStatus.LOGGED_IN
+AS_READY = AccountStatus.READY
+
+IT_EMA = IndicatorType.EMA
+IT_ATR = IndicatorType.ATR
+IT_VWAP = IndicatorType.VWAP
+IT_BOLLINGER = IndicatorType.BOLLINGER
+IT_RSI = IndicatorType.RSI
+
+EM_MARKET_DATA = int(EventMask.MARKET_DATA)
+EM_TICK = int(EventMask.TICK)
+EM_1MIN = int(EventMask.ONE_MIN)
+EM_1MIN_TICK = int(EventMask.ONE_MIN_TICK)
+EM_DEPTH_TICKS = int(EventMask.DEPTH_TICKS)
+EM_QUOTE = int(EventMask.QUOTE)
+EM_ALL = int(EventMask.ALL)
+EM_AUTO = int(EventMask.AUTO)
+
+# Fixed-point price of an empty level or unknown tick size (INT64_MIN)
+PRICE_ABSENT = -(1 << 63)
+
+__version__ = "0.4.0a0"
 __author__ = "Holmes Conan"
 
 class CtpClient(_CtpClient):
@@ -96,22 +135,51 @@ class CtpClient(_CtpClient):
         if not os.path.exists(self.flow_path):
             os.makedirs(self.flow_path)
 
+        if self.event_mask & EM_AUTO:
+            self.event_mask = self.detect_event_mask()
+
         _CtpClient.init(self)
 
+    def detect_event_mask(self):
+        """Mask of the market data callbacks overridden by this class."""
+        mask = 0
+        for name, bit in (('on_rtn_market_data', EM_MARKET_DATA), ('on_tick', EM_TICK),
+                          ('on_1min', EM_1MIN), ('on_1min_tick', EM_1MIN_TICK),
+                          ('on_depth_ticks', EM_DEPTH_TICKS), ('on_quote', EM_QUOTE)):
+            if getattr(type(self), name) is not getattr(CtpClient, name):
+                mask |= bit
+        return mask
+
+    def join(self):
+        _CtpClient.join(self)
+        if self.latency_enabled:
+            self.dump_latency_stats()
+
+    def dump_latency_stats(self):
+        """Log the per-stage latency histograms in microseconds."""
+        stats = self.latency_stats()
+        for stage in ('spi', 'queue', 'gil', 'callback', 'total'):
+            s = stats[stage]
+            self.log.info("latency %-8s n=%d p50=%.1f p90=%.1f p99=%.1f p999=%.1f max=%.1f us negative=%d" % (
+                stage, s['count'], s['p50'] / 1e3, s['p90'] / 1e3, s['p99'] / 1e3, s['p999'] / 1e3, s['max'] / 1e3,
+                s['negative']))
+
     def remove_flow_path(self):
         rmtree(self.flow_path)
 
     def on_md_front_connected(self):
         self.log.info("MarketData front connected")
-        self.md_login()
+        if not self.auto_session:
+            self.md_login()
 
     def on_md_front_disconnected(self, reason: int):
         self.log.info("MarketData front disconnected: %d" % reason)
 
     def on_md_user_login(self, user_login_info: UserLoginInfo, rsp_info: ResponseInfo):
-        if rsp_info.error_id == 0 and len(self.instrument_ids) > 0:
+        # `instrument_ids` and everything passed to `subscribe_market_data` are
+        # (re)subscribed natively after each login.
+        if rsp_info.error_id == 0:
             self.log.info("MarketData user logged in")
-            self.subscribe_market_data(self.instrument_ids)
         else:
             self.log.error("MarketData login failed: %d" % rsp_info.error_id)
 
@@ -138,9 +206,28 @@ class CtpClient(_CtpClient):
     def on_1min_tick(self, data: M1Bar):
         pass
 
+    def on_depth_ticks(self, data: DepthTicks):
+        pass
+
+    def on_quote(self, quote: Quote):
+        pass
+
+    def on_main_contract_roll(self, roll: MainContractRoll):
+        self.log.info("Main contract %s rolled from %s to %s" % (roll.instrument_id, roll.old_instrument_id, roll.new_instrument_id))
+
+    def on_spread_quote(self, quote: SpreadQuote):
+        pass
+
+    def on_market_data_recovery(self, recovery: MarketDataRecovery):
+        self.log.warning("Market data of %s missed from %s to %s, volume %d%s" % (
+            recovery.instrument_id, recovery.last_update_time, recovery.update_time, recovery.volume,
+            ", bar rebased" if recovery.rebased else ""))
+
     def on_td_front_connected(self):
         self.log.info("Trader front connected")
-        if self.auth_code != '':
+        if self.auto_session:
+            pass
+        elif self.auth_code != '':
             self.td_authenticate()
         else:
             self.td_login()
@@ -151,14 +238,16 @@ class CtpClient(_CtpClient):
     def on_td_authenticate(self, authenticate_info, rsp_info):
         if rsp_info.error_id == 0:
             self.log.info("Trader user authenticated.")
-            self.td_login()
+            if not self.auto_session:
+                self.td_login()
         else:
             self.log.error("Authenticate failed: %d", rsp_info.error_id)
 
     def on_td_user_login(self, user_login_info, rsp_info):
         if rsp_info.error_id == 0:
             self.log.info("Trader user logged in.")
-            self.confirm_settlement_info()
+            if not self.auto_session:
+                self.confirm_settlement_info()
         else:
             self.log.info("Trader user login failed.")
 
@@ -180,6 +269,12 @@ class CtpClient(_CtpClient):
     def on_rtn_trade(self, trade):
         pass
 
+    def on_account_status(self, user_id, status, rsp_info):
+        if rsp_info is not None and rsp_info.error_id != 0:
+            self.log.error("Account %s failed in %s: %d", user_id, status, rsp_info.error_id)
+        else:
+            self.log.info("Account %s %s", user_id, status)
+
     def on_err_order_insert(self, input_order, rsp_info):
         pass
 
@@ -204,9 +299,20 @@ class CtpClient(_CtpClient):
     def on_rsp_market_data(self, data, rsp_info, request_id, is_last):
         pass
 
+    def on_instruments_ready(self, count):
+        self.log.info("%d instruments loaded", count)
+
     def on_idle(self):
         pass
 
+    def on_session_state(self, session, state, attempt):
+        if state == SS_FAILED:
+            self.log.error("Session %s failed after %d attempts", session, attempt)
+        elif attempt > 1:
+            self.log.warning("Session %s %s, attempt %d", session, state, attempt)
+        else:
+            self.log.info("Session %s %s", session, state)
+
     def on_exception(self, message):
         self.log.error("Exception: %s", message)
 
@@ -225,5 +331,20 @@ class CtpClient(_CtpClient):
 
         _CtpClient.insert_order(self, instrument_id, direction, offset_flag, price, volume, **kwargs)
 
+    def allocate(self, instrument_id: str, direction, offset_flag, price: float, volumes: dict, **kwargs):
+        if isinstance(direction, str):
+            if direction.lower() in self.direction_dict:
+                direction = self.direction_dict[direction.lower()]
+            else:
+                raise ValueError("Invalid direction: %s" % direction)
+
+        if isinstance(offset_flag, str):
+            if offset_flag.lower() in self.offset_flag_dict:
+                offset_flag = self.offset_flag_dict[offset_flag.lower()]
+            else:
+                raise ValueError("Invalid offset_flag: %s" % offset_flag)
+
+        return _CtpClient.allocate(self, instrument_id, direction, offset_flag, price, volumes, **kwargs)
+
     def delete_order(self, order, request_id=0):
         _CtpClient.delete_order(self, order, request_id)
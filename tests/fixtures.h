@@ -0,0 +1,55 @@
+/*
+ * Copyright 2019 Holmes Conan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+#include <cstring>
+#include "ThostFtdcUserApiStruct.h"
+#include "bar.h"
+#include "symbols.h"
+
+// Depth record of `instrumentId` at `updateTime`, the fields a test does not pass are 0.
+inline CThostFtdcDepthMarketDataField MakeDepth(const char *updateTime, double price, int volume, double turnover = 0,
+    const char *tradingDay = "20190603", const char *instrumentId = "IF1906")
+{
+    CThostFtdcDepthMarketDataField depth;
+    memset(&depth, 0, sizeof depth);
+    strcpy(depth.InstrumentID, instrumentId);
+    strcpy(depth.TradingDay, tradingDay);
+    strcpy(depth.ActionDay, tradingDay);
+    strcpy(depth.UpdateTime, updateTime);
+    depth.LastPrice = price;
+    depth.Volume = volume;
+    depth.Turnover = turnover;
+    return depth;
+}
+
+// Completed 1 minute bar of `instrumentId` opening at its close.
+inline M1Bar MakeBar(const char *updateTime, double high, double low, double close, int volume = 0,
+    const char *tradingDay = "20190603", const char *instrumentId = "IF1906")
+{
+    M1Bar bar;
+    memset(&bar, 0, sizeof bar);
+    strcpy(bar.InstrumentID, instrumentId);
+    bar.SymbolId = SymbolTable::Instance().Intern(instrumentId);
+    strcpy(bar.TradingDay, tradingDay);
+    strcpy(bar.ActionDay, tradingDay);
+    strcpy(bar.UpdateTime, updateTime);
+    bar.OpenPrice = close;
+    bar.HighestPrice = high;
+    bar.LowestPrice = low;
+    bar.ClosePrice = close;
+    bar.Volume = volume;
+    return bar;
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright 2019 Holmes Conan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <cstdio>
+#include <cstring>
+#include <gtest/gtest.h>
+#include "arbiter.h"
+#include "fixtures.h"
+
+TEST(FrontArbiter, ForwardsFirstArrivalOnly)
+{
+    FrontArbiter arbiter;
+    arbiter.SetFronts({"tcp://primary", "tcp://mirror"});
+    ASSERT_TRUE(arbiter.IsEnabled());
+
+    auto a = MakeDepth("09:30:00", 0, 100);
+    auto b = MakeDepth("09:30:00", 0, 120);
+    b.UpdateMillisec = 500;
+    EXPECT_TRUE(arbiter.Accept(&a, 1, 1));
+    EXPECT_FALSE(arbiter.Accept(&a, 1, 0));
+    EXPECT_TRUE(arbiter.Accept(&b, 1, 0));
+    EXPECT_FALSE(arbiter.Accept(&b, 1, 1));
+
+    auto stats = arbiter.GetStats();
+    EXPECT_EQ(stats["tcp://primary"]["received"], 2);
+    EXPECT_EQ(stats["tcp://primary"]["wins"], 1);
+    EXPECT_EQ(stats["tcp://mirror"]["wins"], 1);
+    EXPECT_DOUBLE_EQ(stats["tcp://mirror"]["win_rate"], 0.5);
+}
+
+TEST(FrontArbiter, DropsUpdatesBehindTheForwardedOne)
+{
+    FrontArbiter arbiter;
+    arbiter.SetFronts({"tcp://primary", "tcp://mirror"});
+
+    auto older = MakeDepth("09:30:00", 0, 100);
+    auto newer = MakeDepth("09:30:00", 0, 120);
+    newer.UpdateMillisec = 500;
+    EXPECT_TRUE(arbiter.Accept(&newer, 1, 0));
+    // 落后前置的旧行情，没有出现过但成交量更小
+    EXPECT_FALSE(arbiter.Accept(&older, 1, 1));
+
+    // 新交易日成交量从头开始
+    auto nextDay = MakeDepth("21:00:00", 0, 5, 0, "20190604");
+    EXPECT_TRUE(arbiter.Accept(&nextDay, 1, 1));
+}
+
+TEST(FrontArbiter, InstrumentsAreIndependent)
+{
+    FrontArbiter arbiter;
+    arbiter.SetFronts({"tcp://primary", "tcp://mirror"});
+
+    auto depth = MakeDepth("09:30:00", 0, 100);
+    EXPECT_TRUE(arbiter.Accept(&depth, 1, 0));
+    EXPECT_TRUE(arbiter.Accept(&depth, 2, 0));
+    EXPECT_FALSE(arbiter.Accept(&depth, 2, 1));
+}
+
+TEST(FrontArbiter, TracksConnectedFronts)
+{
+    FrontArbiter arbiter;
+    arbiter.SetFronts({"tcp://primary"});
+    EXPECT_FALSE(arbiter.IsEnabled());
+    EXPECT_FALSE(arbiter.IsAnyConnected());
+
+    arbiter.SetFronts({"tcp://primary", "tcp://mirror"});
+    arbiter.SetConnected(1, true);
+    EXPECT_TRUE(arbiter.IsAnyConnected());
+    arbiter.SetConnected(1, false);
+    EXPECT_FALSE(arbiter.IsAnyConnected());
+    EXPECT_EQ(arbiter.GetStats()["tcp://mirror"]["connected"], 0);
+}
@@ -0,0 +1,203 @@
+/*
+ * Copyright 2019 Holmes Conan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <vector>
+#include <cstring>
+#include <gtest/gtest.h>
+#include "aggregator.h"
+#include "fixtures.h"
+
+namespace {
+
+struct Recorder {
+    M1Aggregator aggregator;
+    std::vector<M1Bar> completed;
+    std::vector<MarketDataRecovery> recoveries;
+
+    Recorder()
+    {
+        aggregator.SetSinks([this](const M1Bar &bar) { completed.push_back(bar); },
+            [this](const MarketDataRecovery &recovery) { recoveries.push_back(recovery); });
+    }
+
+    M1Bar Update(const char *updateTime, double price, int volume, double turnover)
+    {
+        auto depth = MakeDepth(updateTime, price, volume, turnover);
+        M1Bar bar;
+        aggregator.Update(&depth, 1, 0.0, bar, true);
+        return bar;
+    }
+};
+
+}
+
+TEST(M1Aggregator, CompletesTheBarWhenTheMinuteRolls)
+{
+    Recorder r;
+    auto first = r.Update("09:30:00", 3000, 100, 1000);
+    EXPECT_TRUE(first.Partial);
+    EXPECT_STREQ(first.UpdateTime, "09:30:00");
+    r.Update("09:30:30", 3002, 110, 1100);
+    r.Update("09:31:00", 3001, 125, 1250);
+    auto bar = r.Update("09:31:40", 2999, 130, 1300);
+
+    ASSERT_EQ(r.completed.size(), 1u);
+    EXPECT_STREQ(r.completed[0].UpdateTime, "09:30");
+    EXPECT_TRUE(r.completed[0].Partial);
+    EXPECT_DOUBLE_EQ(r.completed[0].HighestPrice, 3002);
+    EXPECT_FALSE(bar.Partial);
+    EXPECT_EQ(bar.Volume, 20);
+    EXPECT_DOUBLE_EQ(bar.Turnover, 200);
+    EXPECT_DOUBLE_EQ(bar.OpenPrice, 3001);
+    EXPECT_DOUBLE_EQ(bar.LowestPrice, 2999);
+}
+
+TEST(M1Aggregator, GapInsideTheMinuteContinuesTheBar)
+{
+    Recorder r;
+    r.Update("09:30:00", 3000, 100, 1000);
+    r.Update("09:31:00", 3000, 110, 1100);
+    r.aggregator.MarkStale();
+    EXPECT_EQ(r.aggregator.GetStaleCount(), 1u);
+
+    auto bar = r.Update("09:31:50", 3003, 140, 1400);
+    EXPECT_EQ(r.aggregator.GetStaleCount(), 0u);
+    ASSERT_EQ(r.recoveries.size(), 1u);
+    EXPECT_FALSE(r.recoveries[0].Rebased);
+    EXPECT_EQ(r.recoveries[0].Volume, 30);
+    EXPECT_EQ(r.completed.size(), 1u);
+    // 缺口中的成交仍属于这根K线
+    EXPECT_EQ(bar.Volume, 40);
+    EXPECT_FALSE(bar.Partial);
+}
+
+TEST(M1Aggregator, DisconnectSnapshotTick)
+{
+    Recorder r;
+    r.Update("09:30:00", 3000, 100, 1000);
+    r.Update("09:31:00", 3000, 110, 1100);
+    r.aggregator.MarkStale();
+
+    // 快照在新的分钟：上一根K线结束，新K线以快照的累计量为基准
+    auto snapshot = MakeDepth("09:35:10", 3010, 200, 2000);
+    r.aggregator.Recover(&snapshot, 1, 0.0, true);
+    r.aggregator.FinishRecovery(true);
+    EXPECT_EQ(r.aggregator.GetStaleCount(), 0u);
+    ASSERT_EQ(r.recoveries.size(), 1u);
+    EXPECT_TRUE(r.recoveries[0].Snapshot);
+    EXPECT_TRUE(r.recoveries[0].Rebased);
+    EXPECT_EQ(r.recoveries[0].Volume, 90);
+    ASSERT_EQ(r.completed.size(), 2u);
+    EXPECT_STREQ(r.completed[1].UpdateTime, "09:31");
+    EXPECT_EQ(r.completed[1].Volume, 10);
+
+    // 缺口中的成交不计入新K线
+    auto bar = r.Update("09:35:20", 3012, 205, 2050);
+    EXPECT_TRUE(bar.Partial);
+    EXPECT_EQ(bar.BaseVolume, 200);
+    EXPECT_EQ(bar.Volume, 5);
+    EXPECT_DOUBLE_EQ(bar.Turnover, 50);
+    EXPECT_DOUBLE_EQ(bar.OpenPrice, 3010);
+    EXPECT_DOUBLE_EQ(bar.HighestPrice, 3012);
+
+    // 重复的快照不再改动K线
+    r.aggregator.Recover(&snapshot, 1, 0.0, true);
+    EXPECT_EQ(r.recoveries.size(), 1u);
+
+    r.Update("09:36:00", 3011, 215, 2150);
+    ASSERT_EQ(r.completed.size(), 3u);
+    EXPECT_TRUE(r.completed[2].Partial);
+    EXPECT_EQ(r.completed[2].Volume, 5);
+}
+
+TEST(M1Aggregator, LiveTickAfterGapStartsFromZero)
+{
+    Recorder r;
+    r.Update("09:30:00", 3000, 100, 1000);
+    r.aggregator.MarkStale();
+
+    auto bar = r.Update("09:40:00", 3005, 300, 3000);
+    ASSERT_EQ(r.recoveries.size(), 1u);
+    EXPECT_FALSE(r.recoveries[0].Snapshot);
+    EXPECT_TRUE(r.recoveries[0].Rebased);
+    EXPECT_EQ(bar.Volume, 0);
+    EXPECT_DOUBLE_EQ(bar.Turnover, 0);
+    EXPECT_TRUE(bar.Partial);
+
+    // 重连后先到的行情已完成对齐，较旧的快照被忽略
+    auto snapshot = MakeDepth("09:39:50", 3004, 290, 2900);
+    r.aggregator.Recover(&snapshot, 1, 0.0, true);
+    EXPECT_EQ(r.recoveries.size(), 1u);
+}
+
+TEST(M1Aggregator, RebasedBarStartingMidMinuteCountsOnlyLaterVolume)
+{
+    Recorder r;
+    r.Update("09:30:00", 3000, 100, 1000);
+    r.Update("09:31:00", 3000, 110, 1100);
+    r.aggregator.MarkStale();
+
+    // 缺口后第一笔在 09:35 的中间，缺口中成交的 190 手只在恢复事件中报告
+    auto first = r.Update("09:35:40", 3005, 300, 3000);
+    ASSERT_EQ(r.recoveries.size(), 1u);
+    EXPECT_EQ(r.recoveries[0].Volume, 190);
+    EXPECT_EQ(first.BaseVolume, 300);
+    EXPECT_EQ(first.Volume, 0);
+
+    auto bar = r.Update("09:35:50", 3007, 320, 3200);
+    EXPECT_EQ(bar.Volume, 20);
+    EXPECT_DOUBLE_EQ(bar.Turnover, 200);
+    EXPECT_TRUE(bar.Partial);
+
+    bar = r.Update("09:36:05", 3006, 330, 3300);
+    ASSERT_EQ(r.completed.size(), 3u);
+    EXPECT_STREQ(r.completed[2].UpdateTime, "09:35");
+    EXPECT_TRUE(r.completed[2].Partial);
+    EXPECT_EQ(r.completed[2].Volume, 20);
+    EXPECT_DOUBLE_EQ(r.completed[2].Turnover, 200);
+    EXPECT_DOUBLE_EQ(r.completed[2].OpenPrice, 3005);
+    EXPECT_DOUBLE_EQ(r.completed[2].HighestPrice, 3007);
+
+    // 之后的K线照常以上一根的最后累计量为基准
+    EXPECT_FALSE(bar.Partial);
+    EXPECT_EQ(bar.BaseVolume, 320);
+    EXPECT_EQ(bar.Volume, 10);
+}
+
+TEST(M1Aggregator, FinishRecoveryClearsBarsMissingFromTheSnapshot)
+{
+    Recorder r;
+    r.Update("09:30:00", 3000, 100, 1000);
+    r.aggregator.MarkStale();
+    EXPECT_EQ(r.aggregator.GetStaleCount(), 1u);
+
+    r.aggregator.FinishRecovery(true);
+    EXPECT_EQ(r.aggregator.GetStaleCount(), 0u);
+    ASSERT_EQ(r.completed.size(), 1u);
+    EXPECT_STREQ(r.completed[0].UpdateTime, "09:30");
+
+    auto bar = r.Update("09:30:40", 3001, 150, 1500);
+    EXPECT_TRUE(bar.Partial);
+    EXPECT_EQ(bar.Volume, 0);
+    EXPECT_EQ(r.completed.size(), 1u);
+    bar = r.Update("09:30:50", 3002, 160, 1600);
+    EXPECT_EQ(bar.BaseVolume, 150);
+    EXPECT_EQ(bar.Volume, 10);
+    EXPECT_DOUBLE_EQ(bar.Turnover, 100);
+
+    // 等待重新开始的K线不再标记为过期
+    r.aggregator.MarkStale();
+    EXPECT_EQ(r.aggregator.GetStaleCount(), 1u);
+}
@@ -0,0 +1,179 @@
+/*
+ * Copyright 2019 Holmes Conan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <gtest/gtest.h>
+#include "catalog.h"
+
+namespace {
+
+CThostFtdcInstrumentField MakeInstrument(const char *instrumentId, const char *productId, double priceTick, int multiple)
+{
+    CThostFtdcInstrumentField instrument;
+    memset(&instrument, 0, sizeof instrument);
+    strncpy(instrument.InstrumentID, instrumentId, sizeof instrument.InstrumentID - 1);
+    strncpy(instrument.ProductID, productId, sizeof instrument.ProductID - 1);
+    strncpy(instrument.ExchangeID, "CFFEX", sizeof instrument.ExchangeID - 1);
+    instrument.PriceTick = priceTick;
+    instrument.VolumeMultiple = multiple;
+    return instrument;
+}
+
+CThostFtdcProductField MakeProduct(const char *productId)
+{
+    CThostFtdcProductField product;
+    memset(&product, 0, sizeof product);
+    strncpy(product.ProductID, productId, sizeof product.ProductID - 1);
+    strncpy(product.ExchangeID, "CFFEX", sizeof product.ExchangeID - 1);
+    return product;
+}
+
+void Fill(InstrumentCatalog &catalog, const std::string &tradingDay)
+{
+    catalog.Begin(tradingDay);
+    catalog.Add(MakeProduct("IF"));
+    catalog.Add(MakeProduct("IC"));
+    catalog.Add(MakeInstrument("IF1906", "IF", 0.2, 300));
+    catalog.Add(MakeInstrument("IF1907", "IF", 0.2, 300));
+    catalog.Add(MakeInstrument("IC1906", "IC", 0.2, 200));
+}
+
+}
+
+TEST(InstrumentCatalog, CommitPublishesStaging)
+{
+    InstrumentCatalog catalog;
+    Fill(catalog, "20190603");
+    EXPECT_EQ(catalog.GetInstrumentCount(), 0u);
+
+    ASSERT_TRUE(catalog.Commit());
+    EXPECT_EQ(catalog.GetInstrumentCount(), 3u);
+    EXPECT_EQ(catalog.GetTradingDay(), "20190603");
+    EXPECT_DOUBLE_EQ(catalog.GetPriceTick("IC1906"), 0.2);
+    EXPECT_EQ(catalog.GetVolumeMultiple("IF1907"), 300);
+    EXPECT_EQ(catalog.GetProductId("IC1906"), "IC");
+    EXPECT_EQ(catalog.GetInstrumentIds("IF").size(), 2u);
+    EXPECT_EQ(catalog.GetProductIds().size(), 2u);
+}
+
+TEST(InstrumentCatalog, EmptyCommitKeepsCatalog)
+{
+    InstrumentCatalog catalog;
+    Fill(catalog, "20190603");
+    ASSERT_TRUE(catalog.Commit());
+
+    catalog.Begin("20190604");
+    catalog.Add(MakeProduct("IF"));
+    EXPECT_FALSE(catalog.Commit());
+    EXPECT_EQ(catalog.GetInstrumentCount(), 3u);
+    EXPECT_EQ(catalog.GetTradingDay(), "20190603");
+}
+
+TEST(InstrumentCatalog, AbortIgnoresRemainingPages)
+{
+    InstrumentCatalog catalog;
+    Fill(catalog, "20190603");
+    ASSERT_TRUE(catalog.Commit());
+
+    catalog.Begin("20190604");
+    catalog.Add(MakeInstrument("IF1908", "IF", 0.2, 300));
+    catalog.Abort();
+    catalog.Add(MakeInstrument("IF1909", "IF", 0.2, 300));
+    EXPECT_FALSE(catalog.Commit());
+    EXPECT_EQ(catalog.GetTradingDay(), "20190603");
+
+    CThostFtdcInstrumentField instrument;
+    EXPECT_FALSE(catalog.FindInstrument("IF1909", instrument));
+
+    // 下一次加载不受影响
+    Fill(catalog, "20190604");
+    EXPECT_TRUE(catalog.Commit());
+    EXPECT_EQ(catalog.GetTradingDay(), "20190604");
+}
+
+TEST(InstrumentCatalog, RejectsSecondLoadInFlight)
+{
+    InstrumentCatalog catalog;
+    EXPECT_FALSE(catalog.IsLoading());
+    ASSERT_TRUE(catalog.Begin("20190603"));
+    EXPECT_TRUE(catalog.IsLoading());
+    catalog.Add(MakeInstrument("IF1906", "IF", 0.2, 300));
+
+    // 第二次加载不能清掉正在填充的快照
+    EXPECT_FALSE(catalog.Begin("20190604"));
+    catalog.Add(MakeInstrument("IF1907", "IF", 0.2, 300));
+    ASSERT_TRUE(catalog.Commit());
+    EXPECT_FALSE(catalog.IsLoading());
+    EXPECT_EQ(catalog.GetInstrumentCount(), 2u);
+    EXPECT_EQ(catalog.GetTradingDay(), "20190603");
+
+    // 提交失败同样结束加载
+    ASSERT_TRUE(catalog.Begin("20190604"));
+    catalog.Abort();
+    EXPECT_TRUE(catalog.IsLoading());
+    EXPECT_FALSE(catalog.Commit());
+    EXPECT_FALSE(catalog.IsLoading());
+    EXPECT_TRUE(catalog.Begin("20190604"));
+}
+
+TEST(InstrumentCatalog, CancelEndsLoad)
+{
+    InstrumentCatalog catalog;
+    Fill(catalog, "20190603");
+    ASSERT_TRUE(catalog.Commit());
+
+    ASSERT_TRUE(catalog.Begin("20190604"));
+    catalog.Add(MakeInstrument("IF1908", "IF", 0.2, 300));
+    catalog.Cancel();
+    EXPECT_FALSE(catalog.IsLoading());
+    EXPECT_EQ(catalog.GetTradingDay(), "20190603");
+
+    Fill(catalog, "20190604");
+    EXPECT_TRUE(catalog.Commit());
+    EXPECT_EQ(catalog.GetTradingDay(), "20190604");
+    CThostFtdcInstrumentField instrument;
+    EXPECT_FALSE(catalog.FindInstrument("IF1908", instrument));
+}
+
+TEST(InstrumentCatalog, SaveLoadRoundTrip)
+{
+    InstrumentCatalog catalog;
+    Fill(catalog, "20190603");
+    ASSERT_TRUE(catalog.Commit());
+
+    auto dir = testing::TempDir();
+    if (!dir.empty() && (dir.back() == '/' || dir.back() == '\\')) dir.pop_back();
+    auto path = InstrumentCatalog::CacheFile(dir, "20190603");
+    ASSERT_TRUE(catalog.Save(path));
+
+    InstrumentCatalog loaded;
+    EXPECT_FALSE(loaded.Load(path, "20190604"));
+    ASSERT_TRUE(loaded.Load(path, "20190603"));
+    EXPECT_EQ(loaded.GetInstrumentCount(), 3u);
+    EXPECT_EQ(loaded.GetTradingDay(), "20190603");
+
+    CThostFtdcInstrumentField instrument;
+    ASSERT_TRUE(loaded.FindInstrument("IF1906", instrument));
+    EXPECT_STREQ(instrument.ProductID, "IF");
+    EXPECT_DOUBLE_EQ(instrument.PriceTick, 0.2);
+    EXPECT_EQ(instrument.VolumeMultiple, 300);
+
+    CThostFtdcProductField product;
+    EXPECT_TRUE(loaded.FindProduct("IC", product));
+
+    std::remove(path.c_str());
+}
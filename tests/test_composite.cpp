@@ -0,0 +1,145 @@
+/*
+ * Copyright 2019 Holmes Conan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <cfloat>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+#include "fixtures.h"
+#include "composite.h"
+
+namespace {
+
+CThostFtdcDepthMarketDataField Leg(const char *instrumentId, double price, int volume, double openInterest = 0)
+{
+    auto depth = MakeDepth("09:30:00", price, volume, volume * price, "20190603", instrumentId);
+    depth.OpenInterest = openInterest;
+    return depth;
+}
+
+}
+
+TEST(CompositeEngine, EqualWeightsKeepRunningSums)
+{
+    CompositeEngine engine;
+    engine.Add("IF-IC", {{"IF1906", 1.0}, {"IC1906", -1.0}}, false);
+
+    std::vector<MarketDataEvent> out;
+    auto leg = Leg("IF1906", 4000, 10, 100);
+    engine.Update(&leg, out);
+    // 所有腿都有价格后才输出
+    EXPECT_TRUE(out.empty());
+
+    leg = Leg("IC1906", 5000, 20, 200);
+    engine.Update(&leg, out);
+    ASSERT_EQ(out.size(), 1u);
+    EXPECT_STREQ(out[0].InstrumentID, "IF-IC");
+    EXPECT_EQ(out[0].SymbolId, SymbolTable::Instance().Find("IF-IC"));
+    EXPECT_DOUBLE_EQ(out[0].LastPrice, -1000);
+    EXPECT_EQ(out[0].Volume, 30);
+    EXPECT_DOUBLE_EQ(out[0].Turnover, 4000 * 10 + 5000 * 20);
+    EXPECT_DOUBLE_EQ(out[0].OpenInterest, 300);
+    EXPECT_EQ(out[0].BidPrice1, DBL_MAX);
+
+    // 同一条腿的新行情替换它上一次的贡献
+    leg = Leg("IF1906", 4010, 15, 110);
+    engine.Update(&leg, out);
+    ASSERT_EQ(out.size(), 1u);
+    EXPECT_DOUBLE_EQ(out[0].LastPrice, -990);
+    EXPECT_EQ(out[0].Volume, 35);
+    EXPECT_DOUBLE_EQ(out[0].OpenInterest, 310);
+    EXPECT_DOUBLE_EQ(out[0].OpenPrice, -1000);
+    EXPECT_DOUBLE_EQ(out[0].HighestPrice, -990);
+    EXPECT_DOUBLE_EQ(out[0].LowestPrice, -1000);
+
+    // 无效价格不改变合成合约
+    leg = Leg("IC1906", DBL_MAX, 25, 200);
+    engine.Update(&leg, out);
+    EXPECT_TRUE(out.empty());
+    leg = Leg("IF1906", 4010, 15, 110);
+    engine.Update(&leg, out);
+    ASSERT_EQ(out.size(), 1u);
+    EXPECT_DOUBLE_EQ(out[0].LastPrice, -990);
+    EXPECT_EQ(out[0].Volume, 35);
+}
+
+TEST(CompositeEngine, WeightsByOpenInterest)
+{
+    CompositeEngine engine;
+    engine.Add("IF000", {{"IF1906", 1.0}, {"IF1907", 1.0}}, true);
+
+    std::vector<MarketDataEvent> out;
+    auto leg = Leg("IF1906", 4000, 10, 300);
+    engine.Update(&leg, out);
+    leg = Leg("IF1907", 4010, 10, 100);
+    engine.Update(&leg, out);
+    ASSERT_EQ(out.size(), 1u);
+    EXPECT_DOUBLE_EQ(out[0].LastPrice, (4000 * 300 + 4010 * 100) / 400.0);
+
+    leg = Leg("IF1906", 4000, 20, 100);
+    engine.Update(&leg, out);
+    ASSERT_EQ(out.size(), 1u);
+    EXPECT_DOUBLE_EQ(out[0].LastPrice, 4005);
+    EXPECT_DOUBLE_EQ(out[0].OpenInterest, 200);
+
+    // 总持仓为零时没有加权价格
+    leg = Leg("IF1906", 4000, 20, 0);
+    engine.Update(&leg, out);
+    leg = Leg("IF1907", 4010, 10, 0);
+    engine.Update(&leg, out);
+    EXPECT_TRUE(out.empty());
+}
+
+TEST(CompositeEngine, RemovingALegRestartsTheComposite)
+{
+    CompositeEngine engine;
+    engine.Add("IF-IC", {{"IF1906", 1.0}, {"IC1906", -1.0}}, false);
+    engine.Add("IF-IH", {{"IF1906", 1.0}, {"IH1906", -1.0}}, false);
+
+    std::vector<MarketDataEvent> out;
+    auto leg = Leg("IF1906", 4000, 10);
+    engine.Update(&leg, out);
+    leg = Leg("IC1906", 5000, 20);
+    engine.Update(&leg, out);
+    ASSERT_EQ(out.size(), 1u);
+
+    // 重新定义去掉 IC1906 这条腿，累计值从头开始
+    engine.Add("IF-IC", {{"IF1906", 1.0}}, false);
+    EXPECT_EQ(engine.GetLegs("IF-IC").size(), 1u);
+    leg = Leg("IC1906", 5010, 25);
+    engine.Update(&leg, out);
+    EXPECT_TRUE(out.empty());
+
+    leg = Leg("IF1906", 4010, 15);
+    engine.Update(&leg, out);
+    ASSERT_EQ(out.size(), 1u);
+    EXPECT_STREQ(out[0].InstrumentID, "IF-IC");
+    EXPECT_DOUBLE_EQ(out[0].LastPrice, 4010);
+    EXPECT_EQ(out[0].Volume, 15);
+
+    // 删除一个合成合约不影响共用腿的另一个
+    engine.Remove("IF-IC");
+    EXPECT_EQ(engine.GetInstrumentIds(), std::vector<std::string>{"IF-IH"});
+    leg = Leg("IH1906", 3000, 5);
+    engine.Update(&leg, out);
+    ASSERT_EQ(out.size(), 1u);
+    EXPECT_STREQ(out[0].InstrumentID, "IF-IH");
+    EXPECT_DOUBLE_EQ(out[0].LastPrice, 1010);
+
+    engine.Remove("IF-IH");
+    leg = Leg("IF1906", 4020, 20);
+    engine.Update(&leg, out);
+    EXPECT_TRUE(out.empty());
+}
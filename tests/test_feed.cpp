@@ -0,0 +1,130 @@
+/*
+ * Copyright 2019 Holmes Conan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <gtest/gtest.h>
+#include "feed.h"
+#include "fixtures.h"
+
+namespace {
+
+// Depth record stamped with the current wall clock shifted by `offset` minutes.
+CThostFtdcDepthMarketDataField WallClockDepth(int offset)
+{
+    auto wall = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    const int64_t day = 24 * 60 * 60 * 1000;
+    // 非负且不足一天，时分秒都是两位数
+    uint32_t ms = uint32_t(((wall + int64_t(offset) * 60000) % day + day) % day);
+
+    auto depth = MakeDepth("", 0, 0);
+    strcpy(depth.ExchangeID, "CFFEX");
+    snprintf(depth.UpdateTime, sizeof depth.UpdateTime, "%02u:%02u:%02u",
+        ms / 3600000, ms / 60000 % 60, ms / 1000 % 60);
+    depth.UpdateMillisec = int(ms % 1000);
+    return depth;
+}
+
+void SetTimezone(const char *tz)
+{
+#ifdef WIN32
+    _putenv_s("TZ", tz);
+    _tzset();
+#else
+    setenv("TZ", tz, 1);
+    tzset();
+#endif
+}
+
+}
+
+TEST(FeedMonitor, ExchangeTimeIsBeijingTime)
+{
+    SetTimezone("EST5EDT");
+
+    FeedMonitor feed;
+    EXPECT_EQ(feed.GetUtcOffset(), 8 * 60);
+    feed.SetEnabled(true);
+    auto depth = WallClockDepth(8 * 60);
+    feed.Update(&depth);
+
+    auto stats = feed.GetInstrumentStats("IF1906");
+    EXPECT_LT(std::abs(stats["last"]), 2000.0);
+    EXPECT_EQ(feed.GetExchangeStats().count("CFFEX"), 1u);
+}
+
+TEST(FeedMonitor, ConfigurableUtcOffset)
+{
+    FeedMonitor feed;
+    feed.SetEnabled(true);
+    feed.SetUtcOffset(0);
+    EXPECT_EQ(feed.GetUtcOffset(), 0);
+
+    // UTC+8 的时间戳按 UTC 比较时领先 8 小时
+    auto depth = WallClockDepth(8 * 60);
+    feed.Update(&depth);
+    auto stats = feed.GetInstrumentStats("IF1906");
+    EXPECT_NEAR(stats["last"], -8.0 * 3600 * 1000, 2000.0);
+}
+
+TEST(FeedMonitor, DisabledRecordsNothing)
+{
+    FeedMonitor feed;
+    auto depth = WallClockDepth(8 * 60);
+    feed.Update(&depth);
+    EXPECT_TRUE(feed.GetInstrumentStats("IF1906").empty());
+}
+
+TEST(FeedMonitor, SessionBreaksAreNotGaps)
+{
+    // 休市前最后一笔和休市后第一笔
+    const char *breaks[][3] = {
+        {"IF1906", "11:29:59", "13:00:00"},
+        {"IF1907", "15:00:00", "09:30:00"},
+        {"rb1910", "10:15:00", "10:30:00"},
+        {"rb1911", "14:59:59", "21:00:00"},
+        {"rb1912", "23:00:00", "09:00:00"},
+        {"au1912", "02:30:00", "09:00:00"},
+        {"T1909", "15:15:00", "09:15:00"}
+    };
+    FeedMonitor feed;
+    feed.SetEnabled(true);
+    for (auto &b : breaks) {
+        for (int i = 1; i <= 2; i++) {
+            auto depth = MakeDepth(b[i], 0, 0, 0, "20190603", b[0]);
+            feed.Update(&depth);
+        }
+        auto stats = feed.GetInstrumentStats(b[0]);
+        EXPECT_EQ(stats["gaps"], 0) << b[0];
+        EXPECT_EQ(stats["out_of_order"], 0) << b[0];
+    }
+}
+
+TEST(FeedMonitor, CountsGapsAndOutOfOrderUpdates)
+{
+    FeedMonitor feed;
+    feed.SetEnabled(true);
+    for (auto time : {"09:30:00", "09:31:00", "09:30:59", "10:00:00", "10:10:00"}) {
+        auto depth = MakeDepth(time, 0, 0);
+        feed.Update(&depth);
+    }
+    auto stats = feed.GetInstrumentStats("IF1906");
+    EXPECT_EQ(stats["gaps"], 3);
+    EXPECT_EQ(stats["max_gap"], (29 * 60 + 1) * 1000);
+    EXPECT_EQ(stats["out_of_order"], 1);
+}
@@ -0,0 +1,268 @@
+/*
+ * Copyright 2019 Holmes Conan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+#include "flowcontrol.h"
+#include "conflator.h"
+
+using namespace std::chrono_literals;
+
+TEST(FlowControl, UnboundedNeverOverflows)
+{
+    FlowControl flow;
+    auto slot = flow.Find("IF1906");
+    bool overflow = true;
+    for (uint64_t i = 1; i <= 100; i++) {
+        EXPECT_EQ(flow.Next(*slot, overflow), i);
+        EXPECT_FALSE(overflow);
+        flow.OnEnqueued();
+    }
+    EXPECT_EQ(flow.GetStats()["depth"], 100);
+    EXPECT_EQ(flow.GetStats()["high_water"], 100);
+}
+
+TEST(FlowControl, ConflateSkipsQueuedUpdates)
+{
+    FlowControl flow;
+    flow.SetLimit(2);
+    flow.SetPolicy(OverflowPolicy::Conflate);
+    auto slot = flow.Find("IF1906");
+    auto other = flow.Find("IC1906");
+
+    bool overflow;
+    uint64_t seq1 = flow.Next(*slot, overflow);
+    flow.OnEnqueued();
+    uint64_t otherSeq = flow.Next(*other, overflow);
+    flow.OnEnqueued();
+
+    // 队列已满，新的行情不再入队
+    uint64_t seq2 = flow.Next(*slot, overflow);
+    EXPECT_TRUE(overflow);
+    EXPECT_EQ(seq2, seq1 + 1);
+
+    EXPECT_FALSE(flow.OnDequeued(slot, seq1));
+    EXPECT_TRUE(flow.OnDequeued(other, otherSeq));
+
+    auto stats = flow.GetStats();
+    EXPECT_EQ(stats["depth"], 0);
+    EXPECT_EQ(stats["high_water"], 2);
+    EXPECT_EQ(stats["dropped"], 1);
+    EXPECT_EQ(stats["overflowed"], 1);
+
+    flow.Next(*slot, overflow);
+    EXPECT_FALSE(overflow);
+}
+
+namespace {
+
+// 入队 `count` 笔行情，队列满时溢出，返回每笔出队时是否分发
+std::vector<bool> Deliver(OverflowPolicy policy, size_t limit, int count)
+{
+    FlowControl flow;
+    flow.SetLimit(limit);
+    flow.SetPolicy(policy);
+    auto slot = flow.Find("IF1906");
+
+    std::vector<uint64_t> queued;
+    for (int i = 0; i < count; i++) {
+        bool overflow;
+        uint64_t seq = flow.Next(*slot, overflow);
+        if (!overflow) {
+            flow.OnQueued(*slot, seq);
+            flow.OnEnqueued();
+            queued.push_back(seq);
+        }
+    }
+    std::vector<bool> delivered;
+    for (auto seq : queued) {
+        delivered.push_back(flow.OnDequeued(slot, seq));
+    }
+    return delivered;
+}
+
+}
+
+TEST(FlowControl, DropOldestSkipsOneQueuedUpdatePerOverflow)
+{
+    // 3 笔入队，2 笔溢出：跳过最旧的两笔
+    EXPECT_EQ(Deliver(OverflowPolicy::DropOldest, 3, 5), (std::vector<bool>{false, false, true}));
+    // 溢出多于已入队的，全部跳过
+    EXPECT_EQ(Deliver(OverflowPolicy::DropOldest, 3, 10), (std::vector<bool>{false, false, false}));
+    // Conflate 一次溢出就跳过全部
+    EXPECT_EQ(Deliver(OverflowPolicy::Conflate, 3, 4), (std::vector<bool>{false, false, false}));
+    EXPECT_EQ(Deliver(OverflowPolicy::DropOldest, 3, 4), (std::vector<bool>{false, true, true}));
+}
+
+TEST(FlowControl, DropOldestCountsDrops)
+{
+    FlowControl flow;
+    flow.SetLimit(2);
+    flow.SetPolicy(OverflowPolicy::DropOldest);
+    auto slot = flow.Find("IF1906");
+    auto other = flow.Find("IC1906");
+
+    bool overflow;
+    uint64_t seq1 = flow.Next(*slot, overflow);
+    flow.OnQueued(*slot, seq1);
+    flow.OnEnqueued();
+    uint64_t seq2 = flow.Next(*slot, overflow);
+    flow.OnQueued(*slot, seq2);
+    flow.OnEnqueued();
+
+    // 其他合约没有入队的行情，溢出时没有可跳过的
+    flow.Next(*other, overflow);
+    EXPECT_TRUE(overflow);
+    flow.Next(*slot, overflow);
+    EXPECT_TRUE(overflow);
+    EXPECT_EQ(flow.GetStats()["depth"], 2);
+
+    EXPECT_FALSE(flow.OnDequeued(slot, seq1));
+    EXPECT_TRUE(flow.OnDequeued(slot, seq2));
+    auto stats = flow.GetStats();
+    EXPECT_EQ(stats["overflowed"], 2);
+    EXPECT_EQ(stats["dropped"], 1);
+
+    // 合并槽取走后新入队的行情不受之前跳过的序号影响
+    uint64_t seq4 = flow.Next(*slot, overflow);
+    EXPECT_FALSE(overflow);
+    flow.OnQueued(*slot, seq4);
+    flow.OnEnqueued();
+    flow.Next(*slot, overflow);
+    flow.OnQueued(*slot, seq4 + 1);
+    flow.OnEnqueued();
+    flow.Next(*slot, overflow);
+    EXPECT_TRUE(overflow);
+    EXPECT_FALSE(flow.OnDequeued(slot, seq4));
+    EXPECT_TRUE(flow.OnDequeued(slot, seq4 + 1));
+}
+
+TEST(FlowControl, BlockWaitsForRoom)
+{
+    FlowControl flow;
+    flow.SetLimit(1);
+    flow.SetPolicy(OverflowPolicy::Block);
+    auto slot = flow.Find("IF1906");
+
+    bool overflow;
+    uint64_t seq1 = flow.Next(*slot, overflow);
+    flow.OnEnqueued();
+
+    std::atomic_bool done{false};
+    std::thread producer([&] {
+        bool overflow;
+        flow.Next(*slot, overflow);
+        EXPECT_FALSE(overflow);
+        done = true;
+    });
+
+    std::this_thread::sleep_for(20ms);
+    EXPECT_FALSE(done);
+    EXPECT_TRUE(flow.OnDequeued(slot, seq1));
+    producer.join();
+    EXPECT_TRUE(done);
+    EXPECT_EQ(flow.GetStats()["blocked"], 1);
+}
+
+TEST(FlowControl, CloseReleasesBlockedProducer)
+{
+    FlowControl flow;
+    flow.SetLimit(1);
+    flow.SetPolicy(OverflowPolicy::Block);
+    auto slot = flow.Find("IF1906");
+
+    bool overflow;
+    flow.Next(*slot, overflow);
+    flow.OnEnqueued();
+
+    std::thread producer([&] {
+        bool overflow;
+        flow.Next(*slot, overflow);
+    });
+    std::this_thread::sleep_for(5ms);
+    flow.Close();
+    producer.join();
+    EXPECT_EQ(flow.GetStats()["depth"], 1);
+}
+
+TEST(Conflator, KeepsNewestUpdateUntilDrained)
+{
+    Conflator conflator;
+    CThostFtdcDepthMarketDataField depth;
+    memset(&depth, 0, sizeof depth);
+    strcpy(depth.InstrumentID, "IF1906");
+    TickBar tick;
+    memset(&tick, 0, sizeof tick);
+    M1Bar m1;
+    memset(&m1, 0, sizeof m1);
+
+    EXPECT_FALSE(conflator.IsPending("IF1906"));
+    depth.Volume = 1;
+    conflator.Update(&depth, 7, tick, m1, 10, 11);
+    depth.Volume = 2;
+    conflator.Update(&depth, 7, tick, m1, 20, 21);
+    EXPECT_TRUE(conflator.IsPending("IF1906"));
+    EXPECT_EQ(conflator.GetConflated(), 1u);
+
+    uint32_t symbolId;
+    int64_t tsEntry, tsEnqueue;
+    ASSERT_TRUE(conflator.Drain(depth, symbolId, tick, m1, tsEntry, tsEnqueue));
+    EXPECT_EQ(depth.Volume, 2);
+    EXPECT_EQ(symbolId, 7u);
+    EXPECT_EQ(tsEntry, 20);
+    EXPECT_EQ(tsEnqueue, 21);
+    EXPECT_FALSE(conflator.IsPending("IF1906"));
+    EXPECT_FALSE(conflator.Drain(depth, symbolId, tick, m1, tsEntry, tsEnqueue));
+}
+
+TEST(FlowControl, QuotesAreAccountedSeparately)
+{
+    FlowControl flow;
+    flow.SetLimit(1);
+    flow.SetPolicy(OverflowPolicy::Conflate);
+    auto slot = flow.Find("IF1906");
+    auto quoteSlot = flow.Find("IF1906", FlowControl::Quotes);
+    EXPECT_NE(slot, quoteSlot);
+
+    // 同一笔行情各自入队一次
+    bool overflow;
+    uint64_t seq = flow.Next(*slot, overflow);
+    EXPECT_FALSE(overflow);
+    flow.OnEnqueued();
+    uint64_t quoteSeq = flow.Next(*quoteSlot, overflow);
+    EXPECT_FALSE(overflow);
+    flow.OnEnqueued(FlowControl::Quotes);
+
+    auto stats = flow.GetStats();
+    EXPECT_EQ(stats["depth"], 1);
+    EXPECT_EQ(stats["enqueued"], 1);
+    EXPECT_EQ(stats["quote_depth"], 1);
+    EXPECT_EQ(stats["quote_enqueued"], 1);
+
+    // 行情队列溢出只跳过行情队列中的旧事件
+    flow.Next(*slot, overflow);
+    EXPECT_TRUE(overflow);
+    EXPECT_FALSE(flow.OnDequeued(slot, seq));
+    EXPECT_TRUE(flow.OnDequeued(quoteSlot, quoteSeq, FlowControl::Quotes));
+
+    stats = flow.GetStats();
+    EXPECT_EQ(stats["depth"], 0);
+    EXPECT_EQ(stats["quote_depth"], 0);
+    EXPECT_EQ(stats["dropped"], 1);
+}
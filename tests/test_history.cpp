@@ -0,0 +1,153 @@
+/*
+ * Copyright 2019 Holmes Conan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+#include "history.h"
+#include "symbols.h"
+#include "fixtures.h"
+
+namespace {
+
+// 有夜盘的品种
+M1Bar NightBar(const char *tradingDay, const char *updateTime, double close)
+{
+    return MakeBar(updateTime, close, close, close, 1, tradingDay, "rb1910");
+}
+
+std::vector<double> LoadCloses(const std::string &path)
+{
+    std::vector<BarRecord> records;
+    std::vector<double> closes;
+    if (!HistoryStore::Load(path, 0, records)) return closes;
+    for (auto &record : records) {
+        closes.push_back(record.Close);
+    }
+    return closes;
+}
+
+}
+
+TEST(HistoryRing, LastEntriesStayContiguousAcrossWraparound)
+{
+    HistoryRing<int> ring;
+    ring.Reset(3);
+    EXPECT_EQ(ring.Back(), nullptr);
+
+    for (int i = 1; i <= 20; i++) {
+        ring.Push(i);
+        size_t n = 0;
+        const int *last = ring.Last(n);
+        ASSERT_EQ(n, static_cast<size_t>(i < 3 ? i : 3));
+        for (size_t j = 0; j < n; j++) {
+            EXPECT_EQ(last[j], i - static_cast<int>(n) + 1 + static_cast<int>(j));
+        }
+        EXPECT_EQ(*ring.Back(), i);
+    }
+}
+
+TEST(HistoryRing, ViewIsNotTornByTheNextPushes)
+{
+    HistoryRing<int> ring;
+    ring.Reset(3);
+    for (int i = 1; i <= 4; i++) {
+        ring.Push(i);
+    }
+
+    // 容量满后再追加也不能让已取出的视图错位
+    size_t n = 0;
+    const int *view = ring.Last(n);
+    ASSERT_EQ(n, 3u);
+    for (int i = 5; i <= 7; i++) {
+        ring.Push(i);
+        EXPECT_EQ(view[0], 2);
+        EXPECT_EQ(view[1], 3);
+        EXPECT_EQ(view[2], 4);
+    }
+
+    n = 2;
+    const int *last = ring.Last(n);
+    EXPECT_EQ(last[0], 6);
+    EXPECT_EQ(last[1], 7);
+}
+
+TEST(HistoryStore, SkipsPartialAndOlderBars)
+{
+    HistoryStore store;
+    store.Track("rb1910", 0, 10);
+
+    auto partial = NightBar("20190603", "21:00", 1);
+    partial.Partial = true;
+    store.Append(partial);
+    store.Append(NightBar("20190603", "21:01", 2));
+    // 夜盘属于下一交易日，排在同一交易日的日盘之前
+    store.Append(NightBar("20190603", "09:00", 3));
+    store.Append(NightBar("20190603", "01:00", 4));
+    store.Append(NightBar("20190603", "21:01", 5));
+
+    size_t n = 0;
+    const BarRecord *bars = store.GetBars("rb1910", n);
+    ASSERT_EQ(n, 2u);
+    EXPECT_DOUBLE_EQ(bars[0].Close, 2);
+    EXPECT_DOUBLE_EQ(bars[1].Close, 3);
+}
+
+TEST(HistoryStore, SaveAppendsOnlyNewerBars)
+{
+    std::string path = HistoryStore::ArchiveFile(testing::TempDir(), "rb1910");
+    std::remove(path.c_str());
+
+    HistoryStore store;
+    store.Track("rb1910", 0, 3);
+    store.Append(NightBar("20190603", "09:00", 1));
+    store.Append(NightBar("20190603", "09:01", 2));
+    ASSERT_TRUE(store.Save(path, "rb1910"));
+    EXPECT_EQ(LoadCloses(path), (std::vector<double>{1, 2}));
+
+    // 没有新K线时不改动归档
+    ASSERT_TRUE(store.Save(path, "rb1910"));
+    EXPECT_EQ(LoadCloses(path), (std::vector<double>{1, 2}));
+
+    // 归档的最后一根已经移出环形缓冲区，只追加更新的部分
+    for (int i = 2; i < 6; i++) {
+        char time[6];
+        snprintf(time, sizeof time, "09:%02d", i);
+        store.Append(NightBar("20190603", time, i + 1));
+    }
+    ASSERT_TRUE(store.Save(path, "rb1910"));
+    EXPECT_EQ(LoadCloses(path), (std::vector<double>{1, 2, 4, 5, 6}));
+
+    std::vector<BarRecord> records;
+    ASSERT_TRUE(HistoryStore::Load(path, 2, records));
+    ASSERT_EQ(records.size(), 2u);
+    EXPECT_DOUBLE_EQ(records[0].Close, 5);
+
+    M1Bar bar;
+    HistoryStore::ToBar(records[1], "rb1910", 7, bar);
+    EXPECT_STREQ(bar.TradingDay, "20190603");
+    EXPECT_STREQ(bar.UpdateTime, "09:05");
+    EXPECT_FALSE(bar.Partial);
+
+    // 归档比内存中的K线新时不追加
+    HistoryStore older;
+    older.Track("rb1910", 0, 3);
+    older.Append(NightBar("20190603", "09:01", 9));
+    ASSERT_TRUE(older.Save(path, "rb1910"));
+    EXPECT_EQ(LoadCloses(path).size(), 5u);
+    std::remove(path.c_str());
+}
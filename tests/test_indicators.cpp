@@ -0,0 +1,115 @@
+/*
+ * Copyright 2019 Holmes Conan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <cmath>
+#include <cstring>
+#include <gtest/gtest.h>
+#include "indicators.h"
+#include "symbols.h"
+#include "fixtures.h"
+
+namespace {
+
+double Commit(Indicator &indicator, const M1Bar &bar)
+{
+    double values[3];
+    indicator.Update(bar, true, values);
+    return values[0];
+}
+
+}
+
+TEST(Indicator, EMA)
+{
+    Indicator ema(IndicatorType::EMA, 3, 0);
+    EXPECT_TRUE(std::isnan(Commit(ema, MakeBar("09:30", 1, 1, 1))));
+    EXPECT_TRUE(std::isnan(Commit(ema, MakeBar("09:31", 2, 2, 2))));
+    EXPECT_DOUBLE_EQ(Commit(ema, MakeBar("09:32", 3, 3, 3)), 2.25);
+
+    // 未完成的K线只计算，不改变状态
+    double values[1];
+    ema.Update(MakeBar("09:33", 5, 5, 5), false, values);
+    EXPECT_DOUBLE_EQ(values[0], 3.625);
+    EXPECT_DOUBLE_EQ(Commit(ema, MakeBar("09:33", 4, 4, 4)), 3.125);
+}
+
+TEST(Indicator, ATR)
+{
+    Indicator atr(IndicatorType::ATR, 2, 0);
+    EXPECT_TRUE(std::isnan(Commit(atr, MakeBar("09:30", 10, 8, 9))));
+    EXPECT_DOUBLE_EQ(Commit(atr, MakeBar("09:31", 11, 9, 10)), 2.0);
+    EXPECT_DOUBLE_EQ(Commit(atr, MakeBar("09:32", 14, 10, 13)), 3.0);
+}
+
+TEST(Indicator, VWAPResetsOnNewTradingDay)
+{
+    Indicator vwap(IndicatorType::VWAP, 0, 0);
+    EXPECT_DOUBLE_EQ(Commit(vwap, MakeBar("09:30", 10, 10, 10, 10)), 10.0);
+    EXPECT_DOUBLE_EQ(Commit(vwap, MakeBar("09:31", 20, 20, 20, 30)), 17.5);
+    EXPECT_DOUBLE_EQ(Commit(vwap, MakeBar("21:00", 30, 30, 30, 5, "20190604")), 30.0);
+}
+
+TEST(Indicator, Bollinger)
+{
+    Indicator bollinger(IndicatorType::Bollinger, 2, 2);
+    double values[3];
+    bollinger.Update(MakeBar("09:30", 1, 1, 1), true, values);
+    EXPECT_TRUE(std::isnan(values[0]));
+    bollinger.Update(MakeBar("09:31", 3, 3, 3), true, values);
+    EXPECT_DOUBLE_EQ(values[0], 2.0);
+    EXPECT_DOUBLE_EQ(values[1], 4.0);
+    EXPECT_DOUBLE_EQ(values[2], 0.0);
+    bollinger.Update(MakeBar("09:32", 5, 5, 5), true, values);
+    EXPECT_DOUBLE_EQ(values[0], 4.0);
+    EXPECT_DOUBLE_EQ(values[1], 6.0);
+    EXPECT_DOUBLE_EQ(values[2], 2.0);
+}
+
+TEST(Indicator, RSI)
+{
+    Indicator rsi(IndicatorType::RSI, 2, 0);
+    EXPECT_TRUE(std::isnan(Commit(rsi, MakeBar("09:30", 1, 1, 1))));
+    EXPECT_TRUE(std::isnan(Commit(rsi, MakeBar("09:31", 2, 2, 2))));
+    EXPECT_DOUBLE_EQ(Commit(rsi, MakeBar("09:32", 1, 1, 1)), 50.0);
+    EXPECT_NEAR(Commit(rsi, MakeBar("09:33", 3, 3, 3)), 100.0 - 100.0 / 6.0, 1e-9);
+}
+
+TEST(IndicatorEngine, SkipsPartialAndRepeatedBars)
+{
+    IndicatorEngine engine;
+    engine.Add("IF1906", "vwap", IndicatorType::VWAP, 0, 0);
+    ASSERT_TRUE(engine.IsEnabled());
+
+    // 启动后的第一根K线带着全天累计量，不能计入 VWAP
+    auto partial = MakeBar("09:30", 50, 50, 50, 100000);
+    partial.Partial = true;
+    engine.Update(partial, true);
+    EXPECT_TRUE(std::isnan(engine.GetValues("IF1906")["vwap"]));
+
+    engine.Update(MakeBar("09:31", 10, 10, 10, 10), true);
+    engine.Update(MakeBar("09:31", 10, 10, 10, 10), true);
+    engine.Update(MakeBar("09:32", 20, 20, 20, 30), true);
+    EXPECT_DOUBLE_EQ(engine.GetValues("IF1906")["vwap"], 17.5);
+
+    size_t width = 0;
+    const double *values = engine.GetBuffer("IF1906", width);
+    ASSERT_NE(values, nullptr);
+    EXPECT_EQ(width, 1u);
+    EXPECT_DOUBLE_EQ(values[0], 17.5);
+
+    engine.Remove("IF1906");
+    EXPECT_FALSE(engine.IsEnabled());
+    EXPECT_TRUE(std::isnan(values[0]));
+}
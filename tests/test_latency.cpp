@@ -0,0 +1,171 @@
+/*
+ * Copyright 2019 Holmes Conan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <cmath>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+#include "latency.h"
+
+TEST(Histogram, SmallValuesAreExact)
+{
+    Histogram histogram;
+    EXPECT_EQ(histogram.GetPercentile(50.0), 0);
+    EXPECT_EQ(histogram.GetMin(), 0);
+
+    for (int64_t v = 1; v <= 50; v++) {
+        histogram.Record(v);
+    }
+    EXPECT_EQ(histogram.GetCount(), 50u);
+    EXPECT_EQ(histogram.GetMin(), 1);
+    EXPECT_EQ(histogram.GetMax(), 50);
+    EXPECT_DOUBLE_EQ(histogram.GetMean(), 25.5);
+    EXPECT_EQ(histogram.GetPercentile(50.0), 25);
+    EXPECT_EQ(histogram.GetPercentile(90.0), 45);
+    EXPECT_EQ(histogram.GetPercentile(100.0), 50);
+}
+
+TEST(Histogram, LargeValuesStayWithinThePrecision)
+{
+    Histogram histogram;
+    for (int64_t v = 1000; v <= 1000000; v += 1000) {
+        histogram.Record(v);
+    }
+    // 每个 2 的幂分成 32 个桶，误差不超过约 3%
+    for (double p : {50.0, 90.0, 99.0, 99.9}) {
+        double expected = std::ceil(p / 100.0 * 1000) * 1000;
+        EXPECT_NEAR(double(histogram.GetPercentile(p)), expected, expected * 0.032) << p;
+    }
+    EXPECT_EQ(histogram.GetPercentile(100.0), 1000000);
+
+    // 超出范围的值落在最后一个桶
+    histogram.Reset();
+    EXPECT_EQ(histogram.GetCount(), 0u);
+    histogram.Record(10);
+    histogram.Record(int64_t(1) << 50);
+    EXPECT_EQ(histogram.GetMin(), 10);
+    EXPECT_EQ(histogram.GetMax(), int64_t(1) << 50);
+    EXPECT_EQ(histogram.GetPercentile(50.0), 10);
+}
+
+TEST(Histogram, NegativeValuesAreCountedApart)
+{
+    Histogram histogram;
+    histogram.Record(-5);
+    histogram.Record(-1);
+    histogram.Record(20);
+    histogram.Record(40);
+
+    // 负值不参与分布，不拉低最小值和分位数
+    EXPECT_EQ(histogram.GetCount(), 2u);
+    EXPECT_EQ(histogram.GetNegativeCount(), 2u);
+    EXPECT_EQ(histogram.GetMin(), 20);
+    EXPECT_DOUBLE_EQ(histogram.GetMean(), 30.0);
+    EXPECT_EQ(histogram.GetPercentile(50.0), 20);
+    EXPECT_EQ(histogram.GetSummary()["negative"], 2);
+
+    histogram.Reset();
+    EXPECT_EQ(histogram.GetNegativeCount(), 0u);
+}
+
+TEST(Histogram, RecordsFromSeveralThreads)
+{
+    Histogram histogram;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&histogram] {
+            for (int i = 0; i < 10000; i++) {
+                histogram.Record(i % 100);
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    auto summary = histogram.GetSummary();
+    EXPECT_EQ(summary["count"], 40000);
+    EXPECT_EQ(summary["max"], 99);
+    EXPECT_DOUBLE_EQ(summary["mean"], 49.5);
+}
+
+TEST(LatencyStats, RecordsEachStage)
+{
+    LatencyStats stats;
+    stats.Record(100, 150, 400, 410, 1000);
+    auto result = stats.GetStats();
+    EXPECT_EQ(result["spi"]["max"], 50);
+    EXPECT_EQ(result["queue"]["max"], 250);
+    EXPECT_EQ(result["gil"]["max"], 10);
+    EXPECT_EQ(result["callback"]["max"], 590);
+    EXPECT_EQ(result["total"]["max"], 900);
+
+    stats.Reset();
+    EXPECT_EQ(stats.GetStats()["total"]["count"], 0);
+}
+
+TEST(LatencyStats, ExplicitEntryIsCarriedWhenDisabled)
+{
+    LatencyStats stats;
+    int64_t entry = 0, enqueue = 0;
+    stats.Stamp(entry, enqueue);
+    EXPECT_EQ(entry, 0);
+    EXPECT_EQ(enqueue, 0);
+
+    {
+        LatencyStats::Entry injected(12345);
+        // SPI 内层的计时范围保留外层的注入时刻
+        LatencyStats::Entry spi(stats);
+        stats.Stamp(entry, enqueue);
+        EXPECT_EQ(entry, 12345);
+        EXPECT_EQ(enqueue, 0);
+    }
+
+    entry = 0;
+    stats.Stamp(entry, enqueue);
+    EXPECT_EQ(entry, 0);
+}
+
+TEST(LatencyStats, NestedEntryKeepsTheOuterOne)
+{
+    LatencyStats stats;
+    stats.SetEnabled(true);
+    int64_t entry = 0, enqueue = 0;
+    {
+        LatencyStats::Entry injected(1000);
+        {
+            LatencyStats::Entry spi(stats);
+            stats.Stamp(entry, enqueue);
+        }
+        EXPECT_EQ(entry, 1000);
+        EXPECT_GT(enqueue, 1000);
+    }
+
+    {
+        LatencyStats::Entry spi(stats);
+        stats.Stamp(entry, enqueue);
+        EXPECT_NE(entry, 1000);
+        EXPECT_LE(entry, enqueue);
+    }
+}
+
+TEST(LatencyStats, CauseIsScopedToTheDispatch)
+{
+    EXPECT_EQ(LatencyStats::GetCause(), 0);
+    {
+        LatencyStats::Cause cause(42);
+        EXPECT_EQ(LatencyStats::GetCause(), 42);
+    }
+    EXPECT_EQ(LatencyStats::GetCause(), 0);
+}
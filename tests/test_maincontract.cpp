@@ -0,0 +1,190 @@
+/*
+ * Copyright 2019 Holmes Conan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <cfloat>
+#include <cstring>
+#include <string>
+#include <gtest/gtest.h>
+#include "fixtures.h"
+#include "maincontract.h"
+
+namespace {
+
+CThostFtdcDepthMarketDataField Depth(const char *instrumentId, double price, double openInterest, int volume,
+    double turnover = 0, const char *tradingDay = "20190603")
+{
+    auto depth = MakeDepth("09:30:00", price, volume, turnover, tradingDay, instrumentId);
+    depth.OpenInterest = openInterest;
+    depth.BidPrice1 = price - 1;
+    depth.AskPrice1 = DBL_MAX;
+    return depth;
+}
+
+struct Result {
+    bool leader;
+    bool rolled;
+    MarketDataEvent main;
+    MainContractRoll roll;
+};
+
+Result Update(MainContractResolver &resolver, const CThostFtdcDepthMarketDataField &depth)
+{
+    Result r;
+    memset(&r, 0, sizeof r);
+    r.leader = resolver.Update(&depth, r.main, r.roll, r.rolled);
+    return r;
+}
+
+}
+
+TEST(MainContractResolver, RollsToHigherOpenInterest)
+{
+    MainContractResolver resolver;
+    resolver.Add("IF", "IF888", "", false, 1.0);
+
+    auto r = Update(resolver, Depth("IF1906", 4000, 100, 10));
+    ASSERT_TRUE(r.leader);
+    EXPECT_TRUE(r.rolled);
+    EXPECT_STREQ(r.main.InstrumentID, "IF888");
+    EXPECT_EQ(r.main.SymbolId, SymbolTable::Instance().Find("IF888"));
+    EXPECT_STREQ(r.roll.NewInstrumentID, "IF1906");
+
+    r = Update(resolver, Depth("IF1907", 4010, 90, 20));
+    EXPECT_FALSE(r.leader);
+    EXPECT_FALSE(r.rolled);
+
+    r = Update(resolver, Depth("IF1907", 4010, 120, 30));
+    ASSERT_TRUE(r.leader);
+    ASSERT_TRUE(r.rolled);
+    EXPECT_STREQ(r.roll.ProductID, "IF");
+    EXPECT_STREQ(r.roll.InstrumentID, "IF888");
+    EXPECT_STREQ(r.roll.OldInstrumentID, "IF1906");
+    EXPECT_STREQ(r.roll.NewInstrumentID, "IF1907");
+    EXPECT_DOUBLE_EQ(r.roll.PriceGap, 10);
+    EXPECT_EQ(resolver.GetLeader("IF"), "IF1907");
+    EXPECT_TRUE(resolver.IsMainId("IF888"));
+
+    // 旧主力合约不再输出主力连续行情
+    EXPECT_FALSE(Update(resolver, Depth("IF1906", 4000, 100, 40)).leader);
+}
+
+TEST(MainContractResolver, LeaderLosingInterestRollsToTheBestContract)
+{
+    MainContractResolver resolver;
+    resolver.Add("IF", "IF888", "IF1906", false, 1.0);
+
+    EXPECT_FALSE(Update(resolver, Depth("IF1907", 4010, 200, 10)).leader);
+    EXPECT_FALSE(Update(resolver, Depth("IF1908", 4020, 150, 10)).leader);
+    // 指定的主力合约在持仓量领先前一直是主力
+    auto r = Update(resolver, Depth("IF1906", 4000, 300, 10));
+    ASSERT_TRUE(r.leader);
+    EXPECT_FALSE(r.rolled);
+
+    r = Update(resolver, Depth("IF1906", 4000, 100, 20));
+    EXPECT_FALSE(r.leader);
+    ASSERT_TRUE(r.rolled);
+    EXPECT_STREQ(r.roll.NewInstrumentID, "IF1907");
+}
+
+TEST(MainContractResolver, ThresholdDelaysRoll)
+{
+    MainContractResolver resolver;
+    resolver.Add("IF", "IF888", "", false, 1.1);
+
+    ASSERT_TRUE(Update(resolver, Depth("IF1906", 4000, 100, 10)).leader);
+    EXPECT_FALSE(Update(resolver, Depth("IF1907", 4010, 105, 10)).rolled);
+    EXPECT_TRUE(Update(resolver, Depth("IF1907", 4010, 111, 10)).rolled);
+    EXPECT_EQ(resolver.GetLeader("IF"), "IF1907");
+}
+
+TEST(MainContractResolver, EqualOpenInterestTiesOnVolume)
+{
+    MainContractResolver resolver;
+    resolver.Add("IF", "IF888", "", false, 1.0);
+
+    ASSERT_TRUE(Update(resolver, Depth("IF1906", 4000, 100, 50)).leader);
+    EXPECT_FALSE(Update(resolver, Depth("IF1907", 4010, 100, 50)).rolled);
+    EXPECT_FALSE(Update(resolver, Depth("IF1908", 4020, 100, 40)).rolled);
+    EXPECT_EQ(resolver.GetLeader("IF"), "IF1906");
+
+    auto r = Update(resolver, Depth("IF1907", 4010, 100, 60));
+    ASSERT_TRUE(r.rolled);
+    EXPECT_STREQ(r.roll.NewInstrumentID, "IF1907");
+
+    auto ranking = resolver.GetRanking("IF");
+    ASSERT_EQ(ranking.size(), 3u);
+    EXPECT_EQ(std::get<0>(ranking[0]), "IF1907");
+    EXPECT_EQ(std::get<0>(ranking[1]), "IF1906");
+    EXPECT_EQ(std::get<0>(ranking[2]), "IF1908");
+}
+
+TEST(MainContractResolver, AdjustedPricesAndVolumesStayContinuousAcrossRoll)
+{
+    MainContractResolver resolver;
+    resolver.Add("IF", "IF888", "", true, 1.0);
+
+    auto r = Update(resolver, Depth("IF1906", 4000, 100, 1000, 1e6));
+    ASSERT_TRUE(r.leader);
+    EXPECT_DOUBLE_EQ(r.main.LastPrice, 4000);
+    EXPECT_EQ(r.main.Volume, 1000);
+
+    EXPECT_FALSE(Update(resolver, Depth("IF1907", 4010, 90, 200, 2e5)).leader);
+    r = Update(resolver, Depth("IF1907", 4010, 150, 300, 3e5));
+    ASSERT_TRUE(r.leader);
+    ASSERT_TRUE(r.rolled);
+    EXPECT_DOUBLE_EQ(r.roll.PriceGap, 10);
+    // 换月时价格扣除价差，累计成交量/成交额接续旧主力合约
+    EXPECT_DOUBLE_EQ(r.main.LastPrice, 4000);
+    EXPECT_DOUBLE_EQ(r.main.BidPrice1, 3999);
+    EXPECT_EQ(r.main.AskPrice1, DBL_MAX);
+    EXPECT_EQ(r.main.Volume, 1000);
+    EXPECT_DOUBLE_EQ(r.main.Turnover, 1e6);
+
+    r = Update(resolver, Depth("IF1907", 4020, 150, 310, 3.1e5));
+    ASSERT_TRUE(r.leader);
+    EXPECT_DOUBLE_EQ(r.main.LastPrice, 4010);
+    EXPECT_EQ(r.main.Volume, 1010);
+    EXPECT_DOUBLE_EQ(r.main.Turnover, 1.01e6);
+
+    // 新交易日成交量从零开始，价格调整保留
+    r = Update(resolver, Depth("IF1907", 4030, 150, 5, 5e3, "20190604"));
+    ASSERT_TRUE(r.leader);
+    EXPECT_EQ(r.main.Volume, 5);
+    EXPECT_DOUBLE_EQ(r.main.Turnover, 5e3);
+    EXPECT_DOUBLE_EQ(r.main.LastPrice, 4020);
+}
+
+TEST(MainContractResolver, UnadjustedPricesStillRebaseVolumes)
+{
+    MainContractResolver resolver;
+    resolver.Add("IF", "IF888", "", false, 1.0);
+
+    ASSERT_TRUE(Update(resolver, Depth("IF1906", 4000, 100, 1000, 1e6)).leader);
+    auto r = Update(resolver, Depth("IF1907", 4010, 150, 300, 3e5));
+    ASSERT_TRUE(r.rolled);
+    EXPECT_DOUBLE_EQ(r.main.LastPrice, 4010);
+    EXPECT_EQ(r.main.Volume, 1000);
+    EXPECT_DOUBLE_EQ(r.main.Turnover, 1e6);
+}
+
+TEST(MainContractResolver, IgnoresUntrackedProducts)
+{
+    MainContractResolver resolver;
+    resolver.Add("IF", "IF888", "", false, 1.0);
+
+    EXPECT_FALSE(Update(resolver, Depth("IC1906", 5000, 100, 10)).leader);
+    EXPECT_TRUE(resolver.GetRanking("IC").empty());
+    EXPECT_FALSE(resolver.IsMainId("IC888"));
+}
@@ -0,0 +1,86 @@
+/*
+ * Copyright 2019 Holmes Conan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <set>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+#include "pool.h"
+
+namespace {
+
+// 每个用例使用不同大小的块，互不共享池
+template<size_t Size>
+std::vector<void*> AllocateMany(size_t n)
+{
+    std::vector<void*> blocks;
+    for (size_t i = 0; i < n; ++i) {
+        blocks.push_back(BlockPool<Size>::Instance().Allocate());
+    }
+    return blocks;
+}
+
+}
+
+TEST(BlockPool, ReusesBlocksOnTheSameThread)
+{
+    auto &pool = BlockPool<1000>::Instance();
+    void *p = pool.Allocate();
+    pool.Deallocate(p);
+    EXPECT_EQ(p, pool.Allocate());
+    pool.Deallocate(p);
+}
+
+TEST(BlockPool, BlocksReleasedByAnotherThreadComeBack)
+{
+    auto blocks = AllocateMany<1001>(1000);
+    std::set<void*> allocated(blocks.begin(), blocks.end());
+
+    // 另一线程释放的块先留在该线程，超出本地上限或线程退出时交回共享链表
+    std::thread([&] {
+        for (auto p : blocks) {
+            BlockPool<1001>::Instance().Deallocate(p);
+        }
+    }).join();
+
+    size_t reused = 0;
+    for (auto p : AllocateMany<1001>(1000)) {
+        reused += allocated.count(p);
+    }
+    EXPECT_EQ(1000u, reused);
+}
+
+TEST(BlockPool, ConcurrentAllocateAndDeallocate)
+{
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([] {
+            auto &pool = BlockPool<1002>::Instance();
+            std::vector<void*> held;
+            for (int i = 0; i < 10000; ++i) {
+                held.push_back(pool.Allocate());
+                if (held.size() > 300) {
+                    for (auto p : held) pool.Deallocate(p);
+                    held.clear();
+                }
+            }
+            for (auto p : held) pool.Deallocate(p);
+        });
+    }
+    for (auto &thread : threads) thread.join();
+
+    auto blocks = AllocateMany<1002>(100);
+    EXPECT_EQ(100u, std::set<void*>(blocks.begin(), blocks.end()).size());
+}
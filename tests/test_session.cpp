@@ -0,0 +1,75 @@
+/*
+ * Copyright 2019 Holmes Conan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <chrono>
+#include <thread>
+#include <gtest/gtest.h>
+#include "session.h"
+
+TEST(SessionMachine, ErrorIsRetriedAfterTheDelayUntilAttemptsRunOut)
+{
+    SessionMachine session;
+    session.SetRetryDelay(0);
+    session.SetMaxAttempts(2);
+
+    session.Set(SessionState::Connected);
+    EXPECT_FALSE(session.IsDue());
+
+    session.Begin(SessionState::LoggingIn);
+    EXPECT_EQ(session.GetState(), SessionState::LoggingIn);
+    EXPECT_EQ(session.GetAttempt(), 1);
+    EXPECT_FALSE(session.IsDue());
+
+    session.Fail();
+    EXPECT_TRUE(session.IsDue());
+    EXPECT_TRUE(session.Retry());
+    EXPECT_EQ(session.GetAttempt(), 2);
+    EXPECT_FALSE(session.IsDue());
+
+    session.Fail();
+    EXPECT_TRUE(session.IsDue());
+    EXPECT_FALSE(session.Retry());
+    EXPECT_EQ(session.GetState(), SessionState::Failed);
+    EXPECT_FALSE(session.IsDue());
+}
+
+TEST(SessionMachine, MissingResponseIsDueAfterTheTimeout)
+{
+    SessionMachine session;
+    session.SetTimeout(1);
+    session.Begin(SessionState::Authenticating);
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    EXPECT_TRUE(session.IsDue());
+
+    // 应答到达后进入下一步，不再重发
+    session.Set(SessionState::Ready);
+    EXPECT_FALSE(session.IsDue());
+    EXPECT_EQ(session.GetAttempt(), 0);
+
+    // 没有等待中的请求时错误被忽略
+    session.Fail();
+    EXPECT_FALSE(session.IsDue());
+}
+
+TEST(SessionMachine, SettersClampTheirValues)
+{
+    SessionMachine session;
+    session.SetTimeout(0);
+    session.SetRetryDelay(-5);
+    session.SetMaxAttempts(0);
+    EXPECT_EQ(session.GetTimeout(), 1);
+    EXPECT_EQ(session.GetRetryDelay(), 0);
+    EXPECT_EQ(session.GetMaxAttempts(), 1);
+}
@@ -0,0 +1,167 @@
+/*
+ * Copyright 2019 Holmes Conan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <cfloat>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+#include "fixtures.h"
+#include "spread.h"
+
+namespace {
+
+CThostFtdcDepthMarketDataField Leg(const char *instrumentId, const char *updateTime, int millisec,
+    double bid, int bidVolume, double ask, int askVolume)
+{
+    auto depth = MakeDepth(updateTime, (bid + ask) / 2, 0, 0, "20190603", instrumentId);
+    depth.UpdateMillisec = millisec;
+    depth.BidPrice1 = bid;
+    depth.BidVolume1 = bidVolume;
+    depth.AskPrice1 = ask;
+    depth.AskVolume1 = askVolume;
+    return depth;
+}
+
+}
+
+TEST(SpreadMonitor, ImpliedBidAndAsk)
+{
+    SpreadMonitor monitor;
+    monitor.Add("IF-IC", {{"IF1906", 1.0}, {"IC1906", -1.0}}, 500);
+
+    std::vector<SpreadQuote> out;
+    auto leg = Leg("IF1906", "09:30:00", 0, 3999, 10, 4001, 5);
+    monitor.Update(&leg, out);
+    EXPECT_TRUE(out.empty());
+    SpreadQuote quote;
+    EXPECT_FALSE(monitor.GetQuote("IF-IC", quote));
+
+    leg = Leg("IC1906", "09:30:00", 0, 4999, 3, 5001, 8);
+    monitor.Update(&leg, out);
+    ASSERT_EQ(out.size(), 1u);
+    auto &q = out[0];
+    EXPECT_STREQ(q.SpreadID, "IF-IC");
+    EXPECT_STREQ(q.InstrumentID, "IC1906");
+    EXPECT_DOUBLE_EQ(q.LastPrice, -1000);
+    // 卖出价差：按 IF 买价卖出，按 IC 卖价买入
+    EXPECT_DOUBLE_EQ(q.BidPrice, 3999 - 5001);
+    EXPECT_EQ(q.BidVolume, 8);
+    EXPECT_DOUBLE_EQ(q.AskPrice, 4001 - 4999);
+    EXPECT_EQ(q.AskVolume, 3);
+    EXPECT_EQ(q.Skew, 0);
+    EXPECT_FALSE(q.Stale);
+
+    ASSERT_TRUE(monitor.GetQuote("IF-IC", quote));
+    EXPECT_DOUBLE_EQ(quote.BidPrice, q.BidPrice);
+}
+
+TEST(SpreadMonitor, RatiosScaleVolumes)
+{
+    SpreadMonitor monitor;
+    monitor.Add("butterfly", {{"rb1909", 1.0}, {"rb1910", -2.0}, {"rb1911", 1.0}}, 500);
+
+    std::vector<SpreadQuote> out;
+    auto leg = Leg("rb1909", "09:30:00", 0, 3500, 10, 3501, 10);
+    monitor.Update(&leg, out);
+    leg = Leg("rb1910", "09:30:00", 0, 3450, 9, 3451, 7);
+    monitor.Update(&leg, out);
+    leg = Leg("rb1911", "09:30:00", 0, 3400, 10, 3401, 10);
+    monitor.Update(&leg, out);
+    ASSERT_EQ(out.size(), 1u);
+    EXPECT_DOUBLE_EQ(out[0].BidPrice, 3500 - 2 * 3451 + 3400);
+    EXPECT_EQ(out[0].BidVolume, 3);
+    EXPECT_DOUBLE_EQ(out[0].AskPrice, 3501 - 2 * 3450 + 3401);
+    EXPECT_EQ(out[0].AskVolume, 4);
+}
+
+TEST(SpreadMonitor, EmptySideHasNoImpliedPrice)
+{
+    SpreadMonitor monitor;
+    monitor.Add("IF-IC", {{"IF1906", 1.0}, {"IC1906", -1.0}}, 500);
+
+    std::vector<SpreadQuote> out;
+    auto leg = Leg("IF1906", "09:30:00", 0, 3999, 10, 4001, 5);
+    monitor.Update(&leg, out);
+    // IC 卖一为空，价差没有买价
+    leg = Leg("IC1906", "09:30:00", 0, 4999, 3, DBL_MAX, 0);
+    monitor.Update(&leg, out);
+    ASSERT_EQ(out.size(), 1u);
+    EXPECT_EQ(out[0].BidPrice, DBL_MAX);
+    EXPECT_EQ(out[0].BidVolume, 0);
+    EXPECT_DOUBLE_EQ(out[0].AskPrice, 4001 - 4999);
+    EXPECT_EQ(out[0].AskVolume, 3);
+}
+
+TEST(SpreadMonitor, SkewBeyondMaxSkewIsStale)
+{
+    SpreadMonitor monitor;
+    monitor.Add("IF-IC", {{"IF1906", 1.0}, {"IC1906", -1.0}}, 500);
+
+    std::vector<SpreadQuote> out;
+    auto leg = Leg("IF1906", "09:30:00", 0, 3999, 10, 4001, 5);
+    monitor.Update(&leg, out);
+    leg = Leg("IC1906", "09:30:00", 400, 4999, 3, 5001, 8);
+    monitor.Update(&leg, out);
+    ASSERT_EQ(out.size(), 1u);
+    EXPECT_EQ(out[0].Skew, 400);
+    EXPECT_FALSE(out[0].Stale);
+
+    leg = Leg("IC1906", "09:30:00", 500, 4999, 3, 5001, 8);
+    monitor.Update(&leg, out);
+    ASSERT_EQ(out.size(), 1u);
+    EXPECT_EQ(out[0].Skew, 500);
+    EXPECT_FALSE(out[0].Stale);
+
+    leg = Leg("IC1906", "09:30:01", 0, 4999, 3, 5001, 8);
+    monitor.Update(&leg, out);
+    ASSERT_EQ(out.size(), 1u);
+    EXPECT_EQ(out[0].Skew, 1000);
+    EXPECT_TRUE(out[0].Stale);
+
+    // 滞后的腿更新后恢复
+    leg = Leg("IF1906", "09:30:01", 100, 3999, 10, 4001, 5);
+    monitor.Update(&leg, out);
+    ASSERT_EQ(out.size(), 1u);
+    EXPECT_EQ(out[0].Skew, 100);
+    EXPECT_FALSE(out[0].Stale);
+}
+
+TEST(SpreadMonitor, SkewAcrossMidnight)
+{
+    SpreadMonitor monitor;
+    monitor.Add("rb1910-rb2001", {{"rb1910", 1.0}, {"rb2001", -1.0}}, 500);
+
+    std::vector<SpreadQuote> out;
+    auto leg = Leg("rb1910", "23:59:59", 800, 3500, 1, 3501, 1);
+    monitor.Update(&leg, out);
+    leg = Leg("rb2001", "00:00:00", 100, 3400, 1, 3401, 1);
+    monitor.Update(&leg, out);
+    ASSERT_EQ(out.size(), 1u);
+    EXPECT_EQ(out[0].Skew, 300);
+    EXPECT_FALSE(out[0].Stale);
+}
+
+TEST(SpreadMonitor, RemovedSpreadIsNotQuoted)
+{
+    SpreadMonitor monitor;
+    monitor.Add("IF-IC", {{"IF1906", 1.0}, {"IC1906", -1.0}}, 500);
+    monitor.Remove("IF-IC");
+
+    std::vector<SpreadQuote> out;
+    auto leg = Leg("IF1906", "09:30:00", 0, 3999, 10, 4001, 5);
+    monitor.Update(&leg, out);
+    EXPECT_TRUE(out.empty());
+    EXPECT_TRUE(monitor.GetQuotes().empty());
+}
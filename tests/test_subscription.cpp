@@ -0,0 +1,117 @@
+/*
+ * Copyright 2019 Holmes Conan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+#include "subscription.h"
+
+using Ids = std::vector<std::string>;
+
+TEST(SubscriptionSet, DiffSubscribesDesiredOnce)
+{
+    SubscriptionSet set;
+    set.Add({"IF1906", "IH1906"});
+
+    Ids sub, unsub;
+    set.Diff(sub, unsub);
+    EXPECT_EQ(sub, (Ids{"IF1906", "IH1906"}));
+    EXPECT_TRUE(unsub.empty());
+    EXPECT_EQ(set.Get(SubscriptionSet::State::Pending).size(), 2u);
+
+    // 等待应答期间不重复发送
+    sub.clear();
+    set.Diff(sub, unsub);
+    EXPECT_TRUE(sub.empty());
+
+    EXPECT_FALSE(set.OnSubscribed("IF1906", true));
+    EXPECT_FALSE(set.OnSubscribed("IH1906", false));
+    EXPECT_EQ(set.Get(SubscriptionSet::State::Active), (Ids{"IF1906"}));
+    EXPECT_EQ(set.Get(SubscriptionSet::State::Failed), (Ids{"IH1906"}));
+
+    // 失败的合约在下一次 Diff 时重试
+    set.Diff(sub, unsub);
+    EXPECT_EQ(sub, (Ids{"IH1906"}));
+}
+
+TEST(SubscriptionSet, RemoveWhilePendingUnsubscribesAfterTheResponse)
+{
+    SubscriptionSet set;
+    set.Add({"IF1906"});
+    Ids sub, unsub;
+    set.Diff(sub, unsub);
+
+    set.Remove({"IF1906"});
+    sub.clear();
+    set.Diff(sub, unsub);
+    EXPECT_TRUE(sub.empty());
+    EXPECT_TRUE(unsub.empty());
+
+    // 应答到达时期望集合已变化，需要再同步一次
+    EXPECT_TRUE(set.OnSubscribed("IF1906", true));
+    set.Diff(sub, unsub);
+    EXPECT_EQ(unsub, (Ids{"IF1906"}));
+    EXPECT_EQ(set.Get(SubscriptionSet::State::Unsubscribing), (Ids{"IF1906"}));
+
+    EXPECT_FALSE(set.OnUnsubscribed("IF1906", true));
+    EXPECT_TRUE(set.Get(SubscriptionSet::State::Active).empty());
+    EXPECT_TRUE(set.Get(SubscriptionSet::State::Unsubscribing).empty());
+}
+
+TEST(SubscriptionSet, ReaddWhileUnsubscribingResubscribes)
+{
+    SubscriptionSet set;
+    set.Add({"IF1906"});
+    Ids sub, unsub;
+    set.Diff(sub, unsub);
+    set.OnSubscribed("IF1906", true);
+
+    set.Remove({"IF1906"});
+    set.Diff(sub, unsub);
+    set.Add({"IF1906"});
+    sub.clear();
+    set.Diff(sub, unsub);
+    EXPECT_TRUE(sub.empty());
+
+    EXPECT_TRUE(set.OnUnsubscribed("IF1906", true));
+    set.Diff(sub, unsub);
+    EXPECT_EQ(sub, (Ids{"IF1906"}));
+}
+
+TEST(SubscriptionSet, RevertAndReset)
+{
+    SubscriptionSet set;
+    set.Assign({"IF1906", "IH1906"});
+    Ids sub, unsub;
+    set.Diff(sub, unsub);
+
+    // 未能发送的请求在下一次 Diff 时重发
+    set.Revert({"IH1906"});
+    set.OnSubscribed("IF1906", true);
+    sub.clear();
+    set.Diff(sub, unsub);
+    EXPECT_EQ(sub, (Ids{"IH1906"}));
+
+    // 断线后前置丢弃全部订阅
+    set.Reset();
+    sub.clear();
+    set.Diff(sub, unsub);
+    EXPECT_EQ(sub, (Ids{"IF1906", "IH1906"}));
+
+    set.Assign({"IC1906"});
+    EXPECT_TRUE(set.IsDesired("IC1906"));
+    EXPECT_FALSE(set.IsDesired("IF1906"));
+    EXPECT_EQ(set.GetDesired(), (Ids{"IC1906"}));
+}
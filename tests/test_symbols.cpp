@@ -0,0 +1,106 @@
+/*
+ * Copyright 2019 Holmes Conan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <atomic>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+#include "symbols.h"
+
+TEST(SymbolTable, InternAssignsStableIds)
+{
+    auto &symbols = SymbolTable::Instance();
+    uint32_t id = symbols.Intern("SYMTEST1906");
+    EXPECT_NE(id, 0u);
+    EXPECT_EQ(symbols.Intern("SYMTEST1906"), id);
+    EXPECT_EQ(symbols.Find("SYMTEST1906"), id);
+    EXPECT_STREQ(symbols.GetName(id), "SYMTEST1906");
+
+    EXPECT_EQ(symbols.Find("SYMTEST-UNKNOWN"), 0u);
+    EXPECT_STREQ(symbols.GetName(0), "");
+    EXPECT_STREQ(symbols.GetName(0xffffffffu), "");
+}
+
+TEST(SymbolTable, NamesSurviveGrowth)
+{
+    auto &symbols = SymbolTable::Instance();
+    uint32_t first = symbols.Intern("SYMGROW0");
+    const char *name = symbols.GetName(first);
+
+    // 跨过多个分块，已返回的名字地址不变
+    for (int i = 1; i < 10000; i++) {
+        symbols.Intern(("SYMGROW" + std::to_string(i)).c_str());
+    }
+    EXPECT_EQ(symbols.GetName(first), name);
+    EXPECT_STREQ(name, "SYMGROW0");
+    uint32_t last = symbols.Find("SYMGROW9999");
+    EXPECT_STREQ(symbols.GetName(last), "SYMGROW9999");
+    EXPECT_GE(symbols.GetCount(), 10000u);
+}
+
+TEST(SymbolTable, ConcurrentReadersSeeCompleteNames)
+{
+    auto &symbols = SymbolTable::Instance();
+    std::atomic<uint32_t> published{0};
+    std::atomic_bool done{false};
+
+    std::thread writer([&] {
+        for (int i = 0; i < 5000; i++) {
+            published = symbols.Intern(("SYMRACE" + std::to_string(i)).c_str());
+            // 单核时也让读者有机会运行
+            if (i % 100 == 0) std::this_thread::yield();
+        }
+        done = true;
+    });
+
+    size_t checked = 0;
+    while (!done) {
+        uint32_t id = published.load();
+        if (id == 0) continue;
+        EXPECT_EQ(strncmp(symbols.GetName(id), "SYMRACE", 7), 0);
+        checked++;
+    }
+    writer.join();
+    EXPECT_GT(checked, 0u);
+}
+
+TEST(SymbolTable, ConcurrentFindWhileGrowing)
+{
+    auto &symbols = SymbolTable::Instance();
+    std::atomic<uint32_t> published{0};
+    std::atomic_bool done{false};
+
+    std::thread writer([&] {
+        for (int i = 0; i < 20000; i++) {
+            published = symbols.Intern(("SYMFIND" + std::to_string(i)).c_str());
+            if (i % 100 == 0) std::this_thread::yield();
+        }
+        done = true;
+    });
+
+    // 索引扩容期间，已加入的名字总能查到
+    size_t checked = 0;
+    while (!done) {
+        uint32_t id = published.load();
+        if (id == 0) continue;
+        EXPECT_EQ(symbols.Find(symbols.GetName(id)), id);
+        checked++;
+    }
+    writer.join();
+    EXPECT_GT(checked, 0u);
+    EXPECT_EQ(symbols.Find("SYMFIND19999"), published.load());
+}
@@ -0,0 +1,68 @@
+/*
+ * Copyright 2019 Holmes Conan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <gtest/gtest.h>
+#include "symbols.h"
+#include "ticks.h"
+
+TEST(TickScale, CachesSizesPerSymbolId)
+{
+    TickScale scale;
+    int lookups = 0;
+    double size = 0.2;
+    scale.SetTickSizeOf([&](const std::string &instrumentId) {
+        ++lookups;
+        return instrumentId == "IF1906" ? size : 0.0;
+    });
+
+    uint32_t id = SymbolTable::Instance().Intern("IF1906");
+    EXPECT_DOUBLE_EQ(0.2, scale.Get(id));
+    EXPECT_DOUBLE_EQ(0.2, scale.Get(id));
+    EXPECT_DOUBLE_EQ(0.2, scale.Get("IF1906"));
+    EXPECT_EQ(1, lookups);
+
+    // 未知合约也缓存为 0
+    EXPECT_DOUBLE_EQ(0.0, scale.Get("XX0000"));
+    EXPECT_DOUBLE_EQ(0.0, scale.Get("XX0000"));
+    EXPECT_EQ(2, lookups);
+    EXPECT_DOUBLE_EQ(0.0, scale.Get(uint32_t(0)));
+}
+
+TEST(TickScale, InvalidateRereadsTheCatalog)
+{
+    TickScale scale;
+    double size = 0.2;
+    scale.SetTickSizeOf([&](const std::string&) { return size; });
+
+    uint32_t id = SymbolTable::Instance().Intern("IF1907");
+    EXPECT_DOUBLE_EQ(0.2, scale.Get(id));
+    size = 0.5;
+    EXPECT_DOUBLE_EQ(0.2, scale.Get(id));
+    scale.Invalidate();
+    EXPECT_DOUBLE_EQ(0.5, scale.Get(id));
+}
+
+TEST(TickScale, SetOverridesTheCachedSize)
+{
+    TickScale scale;
+    scale.SetTickSizeOf([](const std::string&) { return 1.0; });
+
+    uint32_t id = SymbolTable::Instance().Intern("rb1910");
+    EXPECT_DOUBLE_EQ(1.0, scale.Get(id));
+    scale.Set("rb1910", 0.5);
+    EXPECT_DOUBLE_EQ(0.5, scale.Get(id));
+    scale.Set("rb1910", 0.0);
+    EXPECT_DOUBLE_EQ(1.0, scale.Get(id));
+}